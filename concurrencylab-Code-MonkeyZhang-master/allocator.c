@@ -0,0 +1,36 @@
+#include <stdlib.h>
+#include "allocator.h"
+
+static void *libc_alloc(void *ctx, size_t size)
+{
+    return malloc(size);
+}
+
+static void libc_free(void *ctx, void *ptr, size_t size)
+{
+    free(ptr);
+}
+
+static allocator_t default_allocator = {libc_alloc, libc_free, NULL};
+
+allocator_t allocator_default()
+{
+    return default_allocator;
+}
+
+void allocator_set_default(const allocator_t *allocator)
+{
+    if (allocator == NULL)
+    {
+        default_allocator = (allocator_t){libc_alloc, libc_free, NULL};
+    }
+    else
+    {
+        default_allocator = *allocator;
+    }
+}
+
+allocator_t allocator_or_default(const allocator_t *allocator)
+{
+    return allocator != NULL ? *allocator : default_allocator;
+}
@@ -0,0 +1,38 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+
+// Allocation hooks for the memory the channel library allocates internally: channels, their buffers,
+// lists and list nodes. Every object remembers the allocator it was created with, so objects created
+// with different allocators can be mixed freely.
+typedef struct
+{
+    // Returns size bytes aligned like malloc's, or NULL
+    void *(*alloc)(void *ctx, size_t size);
+    // Frees ptr, which alloc returned for size bytes
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} allocator_t;
+
+// Returns the allocator used by channel_create, buffer_create and list_create; libc malloc by default
+allocator_t allocator_default();
+
+// Replaces the default allocator, or restores malloc if allocator is NULL
+// Only objects created afterwards are affected; not safe to call while other threads create objects
+void allocator_set_default(const allocator_t *allocator);
+
+// Resolves an optional allocator argument: allocator itself, or the default if it is NULL
+allocator_t allocator_or_default(const allocator_t *allocator);
+
+static inline void *allocator_alloc(const allocator_t *allocator, size_t size)
+{
+    return allocator->alloc(allocator->ctx, size);
+}
+
+static inline void allocator_free(const allocator_t *allocator, void *ptr, size_t size)
+{
+    allocator->free(allocator->ctx, ptr, size);
+}
+
+#endif // ALLOCATOR_H
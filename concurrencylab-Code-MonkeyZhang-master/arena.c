@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "arena.h"
+
+#define ARENA_ALIGN sizeof(max_align_t)
+// Freed blocks up to this size are reused, one free list per multiple of ARENA_ALIGN
+#define ARENA_RECYCLE_MAX 256
+#define ARENA_CLASSES (ARENA_RECYCLE_MAX / ARENA_ALIGN)
+
+typedef struct arena_chunk
+{
+    struct arena_chunk *next;
+    max_align_t data[];
+} arena_chunk_t;
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+} arena_block_t;
+
+struct arena
+{
+    pthread_mutex_t mutex;
+    size_t chunk_size;
+    arena_chunk_t *chunks; // newest first; allocations are bumped out of the first one
+    char *top;             // next free byte of the newest chunk
+    char *end;
+    arena_block_t *free_blocks[ARENA_CLASSES];
+    arena_stats_t stats;
+};
+
+static size_t round_up(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+arena_t *arena_create(size_t chunk_size)
+{
+    arena_t *arena = malloc(sizeof(arena_t));
+    assert(arena != NULL);
+    pthread_mutex_init(&arena->mutex, NULL);
+    arena->chunk_size = round_up(chunk_size);
+    arena->chunks = NULL;
+    arena->top = NULL;
+    arena->end = NULL;
+    for (size_t i = 0; i < ARENA_CLASSES; i++)
+    {
+        arena->free_blocks[i] = NULL;
+    }
+    arena->stats = (arena_stats_t){0, 0, 0};
+    return arena;
+}
+
+// Mallocs a chunk of at least size bytes and links it in behind the current one if it is an oversized
+// block, so the rest of the current chunk is still used
+static void *arena_new_chunk(arena_t *arena, size_t size)
+{
+    size_t bytes = size > arena->chunk_size ? size : arena->chunk_size;
+    arena_chunk_t *chunk = malloc(sizeof(arena_chunk_t) + bytes);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+    arena->stats.chunks++;
+    arena->stats.reserved += bytes;
+    char *data = (char *)chunk->data;
+    if (size > arena->chunk_size && arena->chunks != NULL)
+    {
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+        return data;
+    }
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->top = data + size;
+    arena->end = data + bytes;
+    return data;
+}
+
+static void *arena_alloc(void *ctx, size_t size)
+{
+    arena_t *arena = ctx;
+    size = round_up(size == 0 ? 1 : size);
+    pthread_mutex_lock(&arena->mutex);
+    void *ptr;
+    size_t class = size / ARENA_ALIGN - 1;
+    if (size <= ARENA_RECYCLE_MAX && arena->free_blocks[class] != NULL)
+    {
+        arena_block_t *block = arena->free_blocks[class];
+        arena->free_blocks[class] = block->next;
+        ptr = block;
+    }
+    else if ((size_t)(arena->end - arena->top) >= size)
+    {
+        ptr = arena->top;
+        arena->top += size;
+    }
+    else
+    {
+        ptr = arena_new_chunk(arena, size);
+    }
+    if (ptr != NULL)
+    {
+        arena->stats.allocated += size;
+    }
+    pthread_mutex_unlock(&arena->mutex);
+    return ptr;
+}
+
+static void arena_free(void *ctx, void *ptr, size_t size)
+{
+    arena_t *arena = ctx;
+    if (ptr == NULL)
+    {
+        return;
+    }
+    size = round_up(size == 0 ? 1 : size);
+    pthread_mutex_lock(&arena->mutex);
+    arena->stats.allocated -= size;
+    if (size <= ARENA_RECYCLE_MAX)
+    {
+        size_t class = size / ARENA_ALIGN - 1;
+        arena_block_t *block = ptr;
+        block->next = arena->free_blocks[class];
+        arena->free_blocks[class] = block;
+    }
+    pthread_mutex_unlock(&arena->mutex);
+}
+
+allocator_t arena_allocator(arena_t *arena)
+{
+    return (allocator_t){arena_alloc, arena_free, arena};
+}
+
+void arena_stats(arena_t *arena, arena_stats_t *stats)
+{
+    pthread_mutex_lock(&arena->mutex);
+    *stats = arena->stats;
+    pthread_mutex_unlock(&arena->mutex);
+}
+
+void arena_destroy(arena_t *arena)
+{
+    while (arena->chunks != NULL)
+    {
+        arena_chunk_t *next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+    pthread_mutex_destroy(&arena->mutex);
+    free(arena);
+}
@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "allocator.h"
+
+// Bump arena for short-lived channel graphs: allocations are carved out of large chunks and all
+// released at once by arena_destroy, so building and tearing down a graph costs a few mallocs.
+// Small freed blocks (list nodes of blocking selects, mostly) are kept on free lists by size and
+// reused, so a long run does not grow the arena; larger freed blocks are only reclaimed at the end.
+typedef struct arena arena_t;
+
+typedef struct
+{
+    size_t chunks;    // chunks malloc'd so far
+    size_t allocated; // bytes handed out and not freed
+    size_t reserved;  // bytes in all chunks
+} arena_stats_t;
+
+// Creates an arena that grows by chunk_size bytes at a time
+arena_t *arena_create(size_t chunk_size);
+
+// Returns allocator hooks that allocate from arena; safe to use from several threads
+allocator_t arena_allocator(arena_t *arena);
+
+// Stores how much memory arena holds
+void arena_stats(arena_t *arena, arena_stats_t *stats);
+
+// Frees the arena and every allocation made from it
+// Objects allocated from the arena must not be used anymore
+void arena_destroy(arena_t *arena);
+
+#endif // ARENA_H
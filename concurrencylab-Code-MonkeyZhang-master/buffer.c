@@ -3,8 +3,16 @@
 // Creates a buffer with the given capacity
 buffer_t* buffer_create(size_t capacity)
 {
-    buffer_t* buffer = (buffer_t*) malloc(sizeof(buffer_t));
-    void** data  = (void**) malloc(capacity * sizeof(void*));
+    return buffer_create_with_allocator(capacity, NULL);
+}
+
+// Creates a buffer with the given capacity, allocated with allocator (the default allocator if NULL)
+buffer_t* buffer_create_with_allocator(size_t capacity, const allocator_t* allocator)
+{
+    allocator_t resolved = allocator_or_default(allocator);
+    buffer_t* buffer = (buffer_t*) allocator_alloc(&resolved, sizeof(buffer_t));
+    void** data  = (void**) allocator_alloc(&resolved, capacity * sizeof(void*));
+    buffer->allocator = resolved;
     buffer->size = 0;
     buffer->next = 0;
     buffer->capacity = capacity;
@@ -46,11 +54,24 @@ enum buffer_status buffer_remove(buffer_t* buffer, void **data)
     return BUFFER_ERROR;
 }
 
+// Stores the value buffer_remove would return next in data, without removing it
+// Returns BUFFER_SUCCESS if the buffer is not empty
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_peek_head(buffer_t* buffer, void** data)
+{
+    if (buffer->size > 0) {
+        *data = buffer->data[buffer->next];
+        return BUFFER_SUCCESS;
+    }
+    return BUFFER_ERROR;
+}
+
 // Frees the memory allocated to the buffer
 void buffer_free(buffer_t *buffer)
 {
-    free(buffer->data);
-    free(buffer);
+    allocator_t allocator = buffer->allocator;
+    allocator_free(&allocator, buffer->data, buffer->capacity * sizeof(void*));
+    allocator_free(&allocator, buffer, sizeof(buffer_t));
 }
 
 // Returns the total capacity of the buffer
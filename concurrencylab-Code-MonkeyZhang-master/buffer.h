@@ -2,12 +2,14 @@
 #define BUFFER_H
 
 #include <stdlib.h>
+#include "allocator.h"
 
 typedef struct {
     size_t size;
     size_t next;
     size_t capacity;
     void** data;
+    allocator_t allocator; // allocates the buffer and its data
 } buffer_t;
 
 enum buffer_status {
@@ -18,6 +20,9 @@ enum buffer_status {
 // Creates a buffer with the given capacity
 buffer_t* buffer_create(size_t capacity);
 
+// Creates a buffer with the given capacity, allocated with allocator (the default allocator if NULL)
+buffer_t* buffer_create_with_allocator(size_t capacity, const allocator_t* allocator);
+
 // Adds the value into the buffer
 // Returns BUFFER_SUCCESS if the buffer is not full and value was added
 // Returns BUFFER_ERROR otherwise
@@ -28,6 +33,11 @@ enum buffer_status buffer_add(buffer_t* buffer, void* data);
 // Returns BUFFER_ERROR otherwise
 enum buffer_status buffer_remove(buffer_t* buffer, void** data);
 
+// Stores the value buffer_remove would return next in data, without removing it
+// Returns BUFFER_SUCCESS if the buffer is not empty
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_peek_head(buffer_t* buffer, void** data);
+
 // Frees the memory allocated to the buffer
 void buffer_free(buffer_t* buffer);
 
@@ -1,15 +1,65 @@
+#include <math.h>
 #include "channel.h"
 
+// Every acquisition of channel->mutex goes through these macros so that
+// `make profile` can swap in the contention-counting versions from channel_profile.c
+#ifdef CHANNEL_PROFILE
+#define CHANNEL_LOCK(channel, site) channel_profile_lock(&(channel)->mutex, &(channel)->profile, site)
+#define CHANNEL_UNLOCK(channel) channel_profile_unlock(&(channel)->mutex, &(channel)->profile)
+#define CHANNEL_WAIT(channel, cond) channel_profile_wait(cond, &(channel)->mutex, &(channel)->profile)
+#else
+#define CHANNEL_LOCK(channel, site) pthread_mutex_lock(&(channel)->mutex)
+#define CHANNEL_UNLOCK(channel) pthread_mutex_unlock(&(channel)->mutex)
+#define CHANNEL_WAIT(channel, cond) pthread_cond_wait(cond, &(channel)->mutex)
+#endif
+
+// `make trace` logs every public call: the implementations below are compiled under traced_* names,
+// and the wrappers at the end of this file time them and record their status
+#ifdef CHANNEL_TRACE
+#define channel_create traced_channel_create
+#define channel_create_with_allocator traced_channel_create_with_allocator
+#define channel_send traced_channel_send
+#define channel_receive traced_channel_receive
+#define channel_non_blocking_send traced_channel_non_blocking_send
+#define channel_non_blocking_receive traced_channel_non_blocking_receive
+#define channel_close traced_channel_close
+#define channel_destroy traced_channel_destroy
+#define channel_select traced_channel_select
+#define channel_select_policy traced_channel_select_policy
+// called before they are defined
+channel_t *traced_channel_create_with_allocator(size_t size, const allocator_t *allocator);
+enum channel_status traced_channel_select_policy(select_t *channel_list, size_t channel_count, size_t *selected_index, select_policy_t *policy);
+#endif
+
+// Calls every watch in the list; the channel mutex must be held
+static void notify_watches(list_t *list)
+{
+    list_node_t *current = list->head;
+    for (size_t i = 0; i < list->count; i++)
+    {
+        channel_watch_t *watch = current->data;
+        watch->notify(watch->arg);
+        current = current->next;
+    }
+}
+
 // Creates a new channel with the provided size and returns it to the caller
 // A 0 size indicates an unbuffered channel, whereas a positive size indicates a buffered channel
 channel_t *channel_create(size_t size)
 {
     /* IMPLEMENT THIS */
-    // malloc the channel
-    channel_t *channel = malloc(sizeof(channel_t));
+    return channel_create_with_allocator(size, NULL);
+}
+
+// Same as channel_create, with every internal allocation going through allocator (the default if NULL)
+channel_t *channel_create_with_allocator(size_t size, const allocator_t *allocator)
+{
+    allocator_t resolved = allocator_or_default(allocator);
+    channel_t *channel = allocator_alloc(&resolved, sizeof(channel_t));
+    channel->allocator = resolved;
 
     // create a buffer of size size
-    buffer_t *buffer = buffer_create(size);
+    buffer_t *buffer = buffer_create_with_allocator(size, &resolved);
     channel->buffer = buffer;
 
     // initialize the mutex and condition variables
@@ -27,8 +77,16 @@ channel_t *channel_create(size_t size)
     channel->select_recv_sem = NULL;
 
     // create a list to store the select send and receive semaphores
-    channel->send_sem_list = list_create();
-    channel->recv_sem_list = list_create();
+    channel->send_sem_list = list_create_with_allocator(&resolved);
+    channel->recv_sem_list = list_create_with_allocator(&resolved);
+
+    // create a list to store the readiness watches
+    channel->send_watch_list = list_create_with_allocator(&resolved);
+    channel->recv_watch_list = list_create_with_allocator(&resolved);
+
+#ifdef CHANNEL_PROFILE
+    channel_profile_init(&channel->profile);
+#endif
 
     return channel;
 }
@@ -43,12 +101,12 @@ enum channel_status channel_send(channel_t *channel, void *data)
 {
 
     // lock the mutex
-    pthread_mutex_lock(&channel->mutex);
+    CHANNEL_LOCK(channel, LOCK_SITE_SEND);
 
     // check if the channel is closed
     if (channel->is_closed)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CLOSED_ERROR;
     }
 
@@ -58,14 +116,14 @@ enum channel_status channel_send(channel_t *channel, void *data)
     {
         // increment the send_wait_count
         channel->send_wait_count++;
-        pthread_cond_wait(&channel->send_cond, &channel->mutex);
+        CHANNEL_WAIT(channel, &channel->send_cond);
 
         // when the thread wakes up, check if the channel is closed
         // because channel_close() will boardcast all the send condition variable
         if (channel->is_closed)
         {
             channel->send_wait_count--;
-            pthread_mutex_unlock(&channel->mutex);
+            CHANNEL_UNLOCK(channel);
             return CLOSED_ERROR;
         }
         channel->send_wait_count--;
@@ -83,9 +141,11 @@ enum channel_status channel_send(channel_t *channel, void *data)
         sem_post(current->data);
         current = current->next;
     }
+    // notify the executors watching for recv readiness
+    notify_watches(channel->recv_watch_list);
 
     // unlock the mutex
-    pthread_mutex_unlock(&channel->mutex);
+    CHANNEL_UNLOCK(channel);
     return SUCCESS;
 }
 
@@ -99,12 +159,12 @@ enum channel_status channel_receive(channel_t *channel, void **data)
 {
 
     // lock the mutex
-    pthread_mutex_lock(&channel->mutex);
+    CHANNEL_LOCK(channel, LOCK_SITE_RECEIVE);
 
     // check if the channel is closed
     if (channel->is_closed)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CLOSED_ERROR;
     }
 
@@ -113,12 +173,12 @@ enum channel_status channel_receive(channel_t *channel, void **data)
     while (channel->buffer->size == 0)
     {
         channel->recv_wait_count++;
-        pthread_cond_wait(&channel->recv_cond, &channel->mutex);
+        CHANNEL_WAIT(channel, &channel->recv_cond);
         // when the thread wakes up, check if the channel is closed
         if (channel->is_closed)
         {
             channel->recv_wait_count--;
-            pthread_mutex_unlock(&channel->mutex);
+            CHANNEL_UNLOCK(channel);
             return CLOSED_ERROR;
         }
         channel->recv_wait_count--;
@@ -136,9 +196,11 @@ enum channel_status channel_receive(channel_t *channel, void **data)
         sem_post(current->data);
         current = current->next;
     }
+    // notify the executors watching for send readiness
+    notify_watches(channel->send_watch_list);
 
     // unlock the mutex
-    pthread_mutex_unlock(&channel->mutex);
+    CHANNEL_UNLOCK(channel);
     return SUCCESS;
 }
 
@@ -148,15 +210,16 @@ enum channel_status channel_receive(channel_t *channel, void **data)
 // CHANNEL_FULL if the channel is full and the data was not added to the buffer,
 // CLOSED_ERROR if the channel is closed, and
 // GEN_ERROR on encountering any other generic error of any sort
-enum channel_status channel_non_blocking_send(channel_t *channel, void *data)
+// site records which caller took the lock, so that select's scan is profiled separately
+static enum channel_status try_send(channel_t *channel, void *data, enum channel_lock_site site)
 {
     // lock the mutex
-    pthread_mutex_lock(&channel->mutex);
+    CHANNEL_LOCK(channel, site);
 
     // check if the channel is closed
     if (channel->is_closed)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CLOSED_ERROR;
     }
 
@@ -164,7 +227,7 @@ enum channel_status channel_non_blocking_send(channel_t *channel, void *data)
     //  unlock the mutex and return CHANNEL_FULL
     if (channel->buffer->size == channel->buffer->capacity)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CHANNEL_FULL;
     }
 
@@ -189,28 +252,35 @@ enum channel_status channel_non_blocking_send(channel_t *channel, void *data)
         sem_post(current->data);
         current = current->next;
     }
+    // notify the executors watching for recv readiness
+    notify_watches(channel->recv_watch_list);
 
     // unlock the mutex
-    pthread_mutex_unlock(&channel->mutex);
+    CHANNEL_UNLOCK(channel);
     return SUCCESS;
 }
 
+enum channel_status channel_non_blocking_send(channel_t *channel, void *data)
+{
+    return try_send(channel, data, LOCK_SITE_SEND);
+}
+
 // Reads data from the given channel and stores it in the function's input parameter data (Note that it is a double pointer)
 // This is a non-blocking call i.e., the function simply returns if the channel is empty
 // Returns SUCCESS for successful retrieval of data,
 // CHANNEL_EMPTY if the channel is empty and nothing was stored in data,
 // CLOSED_ERROR if the channel is closed, and
 // GEN_ERROR on encountering any other generic error of any sort
-enum channel_status channel_non_blocking_receive(channel_t *channel, void **data)
+// site records which caller took the lock, so that select's scan is profiled separately
+static enum channel_status try_receive(channel_t *channel, void **data, enum channel_lock_site site)
 {
-    /* IMPLEMENT THIS */
     // lock the mutex
-    pthread_mutex_lock(&channel->mutex);
+    CHANNEL_LOCK(channel, site);
 
     // check if the channel is closed
     if (channel->is_closed)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CLOSED_ERROR;
     }
 
@@ -218,7 +288,7 @@ enum channel_status channel_non_blocking_receive(channel_t *channel, void **data
     // unlock the mutex and return CHANNEL_EMPTY
     if (channel->buffer->size == 0)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CHANNEL_EMPTY;
     }
 
@@ -243,12 +313,19 @@ enum channel_status channel_non_blocking_receive(channel_t *channel, void **data
         sem_post(current->data);
         current = current->next;
     }
+    // notify the executors watching for send readiness
+    notify_watches(channel->send_watch_list);
 
     // unlock the mutex
-    pthread_mutex_unlock(&channel->mutex);
+    CHANNEL_UNLOCK(channel);
     return SUCCESS;
 }
 
+enum channel_status channel_non_blocking_receive(channel_t *channel, void **data)
+{
+    return try_receive(channel, data, LOCK_SITE_RECEIVE);
+}
+
 // Closes the channel and informs all the blocking send/receive/select calls to return with CLOSED_ERROR
 // Once the channel is closed, send/receive/select operations will cease to function and just return CLOSED_ERROR
 // Returns SUCCESS if close is successful,
@@ -257,11 +334,11 @@ enum channel_status channel_non_blocking_receive(channel_t *channel, void **data
 enum channel_status channel_close(channel_t *channel)
 {
     // lock the mutex
-    pthread_mutex_lock(&channel->mutex);
+    CHANNEL_LOCK(channel, LOCK_SITE_CLOSE);
     // check if the channel is already closed
     if (channel->is_closed)
     {
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return CLOSED_ERROR;
     }
     else
@@ -288,12 +365,15 @@ enum channel_status channel_close(channel_t *channel)
             sem_post(node->data);
             node = node->next;
         }
+        // notify the watches of both directions
+        notify_watches(channel->send_watch_list);
+        notify_watches(channel->recv_watch_list);
 
         // unlock the mutex
-        pthread_mutex_unlock(&channel->mutex);
+        CHANNEL_UNLOCK(channel);
         return SUCCESS;
     }
-    pthread_mutex_unlock(&channel->mutex);
+    CHANNEL_UNLOCK(channel);
     return GEN_ERROR;
 }
 
@@ -314,6 +394,9 @@ enum channel_status channel_destroy(channel_t *channel)
     else
     {
         // Undo everything in channel_create()
+#ifdef CHANNEL_PROFILE
+        channel_profile_retire(&channel->profile);
+#endif
         // destroy mutex and condition variables
         pthread_mutex_destroy(&channel->mutex);
         pthread_cond_destroy(&channel->send_cond);
@@ -322,11 +405,11 @@ enum channel_status channel_destroy(channel_t *channel)
         // free semophores
         if (channel->select_send_sem != NULL)
         {
-            free(channel->select_send_sem);
+            allocator_free(&channel->allocator, channel->select_send_sem, sizeof(sem_t));
         }
         if (channel->select_recv_sem != NULL)
         {
-            free(channel->select_recv_sem);
+            allocator_free(&channel->allocator, channel->select_recv_sem, sizeof(sem_t));
         }
 
         // free lists
@@ -338,15 +421,123 @@ enum channel_status channel_destroy(channel_t *channel)
         {
             list_destroy(channel->recv_sem_list);
         }
+        list_destroy(channel->send_watch_list);
+        list_destroy(channel->recv_watch_list);
 
         // free the allocated memory
         buffer_free(channel->buffer);
-        free(channel);
+        allocator_t allocator = channel->allocator;
+        allocator_free(&allocator, channel, sizeof(channel_t));
         return SUCCESS;
     }
     return GEN_ERROR;
 }
 
+// Stores the number of buffered messages and of blocked receivers
+// Returns SUCCESS, or CLOSED_ERROR if the channel is closed
+enum channel_status channel_occupancy(channel_t *channel, size_t *messages, size_t *blocked_receivers)
+{
+    CHANNEL_LOCK(channel, LOCK_SITE_STATS);
+    if (channel->is_closed)
+    {
+        CHANNEL_UNLOCK(channel);
+        return CLOSED_ERROR;
+    }
+    *messages = buffer_current_size(channel->buffer);
+    *blocked_receivers = (size_t)channel->recv_wait_count + list_count(channel->recv_sem_list);
+    CHANNEL_UNLOCK(channel);
+    return SUCCESS;
+}
+
+// Registers watch to be called whenever an operation in direction dir may have become possible
+// (SEND after a receive, RECV after a send) and when the channel is closed
+// Returns SUCCESS, or CLOSED_ERROR if the channel is already closed
+enum channel_status channel_watch(channel_t *channel, enum direction dir, channel_watch_t *watch)
+{
+    CHANNEL_LOCK(channel, LOCK_SITE_SELECT);
+    if (channel->is_closed)
+    {
+        CHANNEL_UNLOCK(channel);
+        return CLOSED_ERROR;
+    }
+    list_insert(dir == SEND ? channel->send_watch_list : channel->recv_watch_list, watch);
+    CHANNEL_UNLOCK(channel);
+    return SUCCESS;
+}
+
+// Removes a watch registered with channel_watch; once this returns the watch is no longer called
+void channel_unwatch(channel_t *channel, enum direction dir, channel_watch_t *watch)
+{
+    CHANNEL_LOCK(channel, LOCK_SITE_SELECT);
+    list_t *list = dir == SEND ? channel->send_watch_list : channel->recv_watch_list;
+    list_node_t *node = list_find(list, watch);
+    if (node != NULL)
+    {
+        list_remove(list, node);
+    }
+    CHANNEL_UNLOCK(channel);
+}
+
+// Returns the semaphore list of the channel that matches the direction of the select entry
+static list_t *select_sem_list(select_t *entry)
+{
+    if (entry->dir == SEND)
+    {
+        return entry->channel->send_sem_list;
+    }
+    return entry->channel->recv_sem_list;
+}
+
+// Removes sem from the semaphore lists of the first count entries of channel_list
+// Every entry inserted sem once, so every entry removes exactly one node
+// (the same channel may appear several times in channel_list)
+static void select_unregister(select_t *channel_list, size_t count, sem_t *sem)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        CHANNEL_LOCK(channel_list[i].channel, LOCK_SITE_SELECT);
+        list_t *list = select_sem_list(&channel_list[i]);
+        list_node_t *remove_node = list_find(list, sem);
+        if (remove_node != NULL)
+        {
+            list_remove(list, remove_node);
+        }
+        CHANNEL_UNLOCK(channel_list[i].channel);
+    }
+}
+
+void select_policy_init(select_policy_t *policy, enum select_policy kind, const unsigned int *weights, unsigned int seed)
+{
+    policy->policy = kind;
+    policy->next = 0;
+    policy->seed = seed;
+    policy->weights = weights;
+}
+
+// Entries tried in order on the stack; longer select lists allocate their order
+#define SELECT_STACK_ORDER 64
+
+// Fills order with the entries of a weighted select in a random order where entry i comes before
+// the others with probability proportional to its weight (Efraimidis-Spirakis: sort by -ln(u) / w),
+// so the first ready entry in the order is a weighted draw among the ready ones
+static void weighted_order(select_policy_t *policy, size_t channel_count, size_t *order, double *keys)
+{
+    for (size_t i = 0; i < channel_count; i++)
+    {
+        // u in (0, 1], so the logarithm is finite
+        double u = ((double)rand_r(&policy->seed) + 1.0) / ((double)RAND_MAX + 1.0);
+        keys[i] = policy->weights[i] > 0 ? -log(u) / (double)policy->weights[i] : HUGE_VAL;
+        // insertion sort; select lists are short
+        size_t j = i;
+        while (j > 0 && keys[order[j - 1]] > keys[i])
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
 // Takes an array of channels (channel_list) of type select_t and the array length (channel_count) as inputs
 // This API iterates over the provided list and finds the set of possible channels which can be used to invoke the required operation (send or receive) specified in select_t
 // If multiple options are available, it selects the first option and performs its corresponding action
@@ -356,9 +547,13 @@ enum channel_status channel_destroy(channel_t *channel)
 // Additionally, selected_index is set to the index of the channel that generated the error
 enum channel_status channel_select(select_t *channel_list, size_t channel_count, size_t *selected_index)
 {
-    /* IMPLEMENT THIS */
+    return channel_select_policy(channel_list, channel_count, selected_index, NULL);
+}
 
-    // create semaphore for each channel
+enum channel_status channel_select_policy(select_t *channel_list, size_t channel_count, size_t *selected_index, select_policy_t *policy)
+{
+    // one semaphore shared by all channels in the list
+    // any send/receive/close on one of them posts it and wakes us up to scan again
     sem_t sem;
     sem_init(&sem, 0, 0);
 
@@ -366,113 +561,183 @@ enum channel_status channel_select(select_t *channel_list, size_t channel_count,
     for (size_t i = 0; i < channel_count; i++)
     {
         // Lock
-        pthread_mutex_lock(&channel_list[i].channel->mutex);
+        CHANNEL_LOCK(channel_list[i].channel, LOCK_SITE_SELECT);
 
-        // if this channel is closed, return CLOSED_ERROR
+        // if this channel is closed, undo the registrations so far and return CLOSED_ERROR
         if (channel_list[i].channel->is_closed == true)
         {
-            pthread_mutex_unlock(&channel_list[i].channel->mutex);
+            CHANNEL_UNLOCK(channel_list[i].channel);
+            select_unregister(channel_list, i, &sem);
+            sem_destroy(&sem);
+            *selected_index = i;
             return CLOSED_ERROR;
         }
 
-        // add sem to list
-        // if the channel is SEND, add sem to send_sem_list
-        if (channel_list[i].dir == SEND)
-        {
-            // condition check? if sem is already in the list, don't add it again
-            list_insert(channel_list[i].channel->send_sem_list, &sem);
-        }
-
-        // if the channel is RECV, add sem to recv_sem_list
-        else if (channel_list[i].dir == RECV)
-        {
-            // if (list_find(channel_list[i].channel->recv_sem_list, &sem) == NULL)
-            // {
-            //     list_insert(channel_list[i].channel->recv_sem_list, &sem);
-            // }
-            list_insert(channel_list[i].channel->recv_sem_list, &sem);
-        }
+        // SEND entries wait on send_sem_list, RECV entries on recv_sem_list
+        list_insert(select_sem_list(&channel_list[i]), &sem);
 
         // Unlock
-        pthread_mutex_unlock(&channel_list[i].channel->mutex);
+        CHANNEL_UNLOCK(channel_list[i].channel);
+    }
+
+    // the order of this call's scans: a rotation starting at start, or a weighted order
+    enum select_policy kind = (policy == NULL || channel_count == 0) ? SELECT_FIRST : policy->policy;
+    size_t start = 0;
+    size_t stack_order[SELECT_STACK_ORDER];
+    double stack_keys[SELECT_STACK_ORDER];
+    size_t *order = NULL;
+    double *keys = NULL;
+    if (kind == SELECT_RANDOM)
+    {
+        start = (size_t)rand_r(&policy->seed) % channel_count;
+    }
+    else if (kind == SELECT_ROUND_ROBIN)
+    {
+        start = policy->next % channel_count;
+    }
+    else if (kind == SELECT_WEIGHTED)
+    {
+        order = channel_count <= SELECT_STACK_ORDER ? stack_order : malloc(sizeof(size_t) * channel_count);
+        keys = channel_count <= SELECT_STACK_ORDER ? stack_keys : malloc(sizeof(double) * channel_count);
+        weighted_order(policy, channel_count, order, keys);
     }
 
     while (true)
     {
-        // store channel status
-        enum channel_status status;
         // iterate through the channel list
-        for (size_t i = 0; i < channel_count; i++)
+        for (size_t k = 0; k < channel_count; k++)
         {
-            // Sender channel
+            size_t i = order != NULL ? order[k] : (start + k < channel_count ? start + k : start + k - channel_count);
+            enum channel_status status;
             if (channel_list[i].dir == SEND)
             {
-                // perform send operation
-                status = channel_non_blocking_send(channel_list[i].channel, channel_list[i].data);
-                // if channel is full, go to next channel
-                if (status == CHANNEL_FULL)
-                {
-                    continue;
-                }
-                // if channel is closed or Success, return
-                else if (status == CLOSED_ERROR || status == SUCCESS || status == GEN_ERROR || status == DESTROY_ERROR)
-                {
-                    pthread_mutex_lock(&channel_list[i].channel->mutex);
-                    // remove semaphore from channel's list
-                    for (size_t i = 0; i < channel_count; i++)
-                    {
-
-                        // remove sem from send_sem_list
-                        // find the node that contains sem
-                        list_node_t *remove_node = list_find(channel_list[i].channel->send_sem_list, &sem);
-                        if (remove_node != NULL)
-                        {
-                            list_remove(channel_list[i].channel->send_sem_list, remove_node);
-                        }
-                    }
-                    // unlock the mutex
-                    pthread_mutex_unlock(&channel_list[i].channel->mutex);
-
-                    *selected_index = i;
-                    sem_destroy(&sem);
-                    return status;
-                }
+                status = try_send(channel_list[i].channel, channel_list[i].data, LOCK_SITE_SELECT);
+            }
+            else
+            {
+                status = try_receive(channel_list[i].channel, &channel_list[i].data, LOCK_SITE_SELECT);
+            }
+
+            // if channel is full (or empty), go to next channel
+            if (status == CHANNEL_FULL)
+            {
+                continue;
             }
 
-            // Receiver channel
-            else if (channel_list[i].dir == RECV)
+            // success or error: remove sem from every channel before it goes out of scope
+            select_unregister(channel_list, channel_count, &sem);
+            sem_destroy(&sem);
+            if (order != stack_order)
+            {
+                free(order);
+                free(keys);
+            }
+            if (kind == SELECT_ROUND_ROBIN)
             {
-                // perform send operation
-                status = channel_non_blocking_receive(channel_list[i].channel, &channel_list[i].data);
-                // if channel is empty, go to next channel
-                if (status == CHANNEL_EMPTY)
-                {
-                    continue;
-                }
-                // if channel is closed or Success, return
-                else if (status == CLOSED_ERROR || status == SUCCESS || status == GEN_ERROR || status == DESTROY_ERROR)
-                {
-                    pthread_mutex_lock(&channel_list[i].channel->mutex);
-                    // remove semaphore from channel
-                    list_node_t *remove_node = list_find(channel_list[i].channel->recv_sem_list, &sem);
-                    for (size_t i = 0; i < channel_count; i++)
-                    {
-                        if (remove_node != NULL)
-                        {
-                            list_remove(channel_list[i].channel->recv_sem_list, remove_node);
-                        }
-                    }
-                    // unlock the mutex
-                    pthread_mutex_unlock(&channel_list[i].channel->mutex);
-
-                    *selected_index = i;
-                    sem_destroy(&sem);
-                    return status;
-                }
+                policy->next = i + 1;
             }
+            *selected_index = i;
+            return status;
         }
         // if all channels are unavailable, wait for the semaphore
         sem_wait(&sem);
     }
     return GEN_ERROR;
 }
+
+#ifdef CHANNEL_TRACE
+#undef channel_create
+#undef channel_create_with_allocator
+#undef channel_send
+#undef channel_receive
+#undef channel_non_blocking_send
+#undef channel_non_blocking_receive
+#undef channel_close
+#undef channel_destroy
+#undef channel_select
+#undef channel_select_policy
+
+channel_t *channel_create_with_allocator(size_t size, const allocator_t *allocator)
+{
+    uint64_t start = channel_trace_now();
+    channel_t *channel = traced_channel_create_with_allocator(size, allocator);
+    channel->trace_id = channel_trace_register();
+    channel_trace_record(channel->trace_id, TRACE_CREATE, (uint32_t)size, SUCCESS, start);
+    return channel;
+}
+
+channel_t *channel_create(size_t size)
+{
+    return channel_create_with_allocator(size, NULL);
+}
+
+enum channel_status channel_send(channel_t *channel, void *data)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_send(channel, data);
+    channel_trace_record(channel->trace_id, TRACE_SEND, 0, status, start);
+    return status;
+}
+
+enum channel_status channel_receive(channel_t *channel, void **data)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_receive(channel, data);
+    channel_trace_record(channel->trace_id, TRACE_RECEIVE, 0, status, start);
+    return status;
+}
+
+enum channel_status channel_non_blocking_send(channel_t *channel, void *data)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_non_blocking_send(channel, data);
+    channel_trace_record(channel->trace_id, TRACE_NB_SEND, 0, status, start);
+    return status;
+}
+
+enum channel_status channel_non_blocking_receive(channel_t *channel, void **data)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_non_blocking_receive(channel, data);
+    channel_trace_record(channel->trace_id, TRACE_NB_RECEIVE, 0, status, start);
+    return status;
+}
+
+enum channel_status channel_close(channel_t *channel)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_close(channel);
+    channel_trace_record(channel->trace_id, TRACE_CLOSE, 0, status, start);
+    return status;
+}
+
+enum channel_status channel_destroy(channel_t *channel)
+{
+    uint64_t start = channel_trace_now();
+    uint32_t id = channel->trace_id;
+    enum channel_status status = traced_channel_destroy(channel);
+    channel_trace_record(id, TRACE_DESTROY, 0, status, start);
+    return status;
+}
+
+// A select is logged as an operation on the entry it performed
+enum channel_status channel_select_policy(select_t *channel_list, size_t channel_count, size_t *selected_index, select_policy_t *policy)
+{
+    uint64_t start = channel_trace_now();
+    enum channel_status status = traced_channel_select_policy(channel_list, channel_count, selected_index, policy);
+    uint32_t id = TRACE_NO_CHANNEL;
+    enum channel_trace_op op = TRACE_SELECT_RECV;
+    if ((status == SUCCESS || status == CLOSED_ERROR) && *selected_index < channel_count)
+    {
+        id = channel_list[*selected_index].channel->trace_id;
+        op = channel_list[*selected_index].dir == SEND ? TRACE_SELECT_SEND : TRACE_SELECT_RECV;
+    }
+    channel_trace_record(id, op, (uint32_t)channel_count, status, start);
+    return status;
+}
+
+enum channel_status channel_select(select_t *channel_list, size_t channel_count, size_t *selected_index)
+{
+    return channel_select_policy(channel_list, channel_count, selected_index, NULL);
+}
+#endif
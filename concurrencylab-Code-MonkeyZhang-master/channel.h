@@ -10,6 +10,9 @@
 #include <string.h>
 #include <stdbool.h>
 #include "linked_list.h"
+#include "allocator.h"
+#include "channel_profile.h"
+#include "channel_trace.h"
 
 // Defines possible return values from channel functions
 enum channel_status
@@ -47,6 +50,23 @@ typedef struct
     list_t *send_sem_list;
     list_t *recv_sem_list;
 
+    // readiness watches (channel_watch_t *) of event-driven executors
+    list_t *send_watch_list;
+    list_t *recv_watch_list;
+
+    // allocates the channel, its buffer and its lists
+    allocator_t allocator;
+
+#ifdef CHANNEL_PROFILE
+    // lock contention statistics, only present in `make profile` builds
+    channel_lock_profile_t profile;
+#endif
+
+#ifdef CHANNEL_TRACE
+    // id of the channel in the operation trace, only present in `make trace` builds
+    uint32_t trace_id;
+#endif
+
 } channel_t;
 
 // Defines channel list structure for channel_select function
@@ -66,10 +86,22 @@ typedef struct
     void *data;
 } select_t;
 
+// Readiness callback for event-driven executors, see channel_watch
+// notify is called with the channel's mutex held, so it must be short and must not call into any channel
+typedef struct
+{
+    void (*notify)(void *arg);
+    void *arg;
+} channel_watch_t;
+
 // Creates a new channel with the provided size and returns it to the caller
 // A 0 size indicates an unbuffered channel, whereas a positive size indicates a buffered channel
 channel_t *channel_create(size_t size);
 
+// Same as channel_create, but the channel, its buffer and every list node it ever needs are allocated with
+// allocator (the default allocator if NULL), which must outlive the channel
+channel_t *channel_create_with_allocator(size_t size, const allocator_t *allocator);
+
 // Writes data to the given channel
 // This is a blocking call i.e., the function only returns on a successful completion of send
 // In case the channel is full, the function waits till the channel has space to write the new data
@@ -125,4 +157,47 @@ enum channel_status channel_destroy(channel_t *channel);
 // Additionally, selected_index is set to the index of the channel that generated the error
 enum channel_status channel_select(select_t *channel_list, size_t channel_count, size_t *selected_index);
 
+// How channel_select_policy picks among entries that are ready at the same time
+enum select_policy
+{
+    SELECT_FIRST,       // lowest index first, like channel_select
+    SELECT_RANDOM,      // scan from a random entry, wrapping around
+    SELECT_ROUND_ROBIN, // scan from the entry after the one selected last time
+    SELECT_WEIGHTED,    // among ready entries, entry i wins with probability weights[i] / (sum of ready weights)
+};
+
+// Policy and its state, kept by the caller across calls on the same select list
+// Initialize with select_policy_init; for SELECT_WEIGHTED, weights has one entry per select entry
+// (an entry of weight 0 is only selected when no entry of positive weight is ready)
+typedef struct
+{
+    enum select_policy policy;
+    size_t next;                 // SELECT_ROUND_ROBIN: where the next scan starts
+    unsigned int seed;           // SELECT_RANDOM and SELECT_WEIGHTED: rand_r state
+    const unsigned int *weights; // SELECT_WEIGHTED only
+} select_policy_t;
+
+// Sets up policy; seed makes the random policies reproducible
+void select_policy_init(select_policy_t *policy, enum select_policy kind, const unsigned int *weights, unsigned int seed);
+
+// Same as channel_select, but when several entries are ready the one performed is chosen by policy
+// (NULL behaves like SELECT_FIRST); the policy state is updated, so a policy must not be shared
+// between threads
+enum channel_status channel_select_policy(select_t *channel_list, size_t channel_count, size_t *selected_index, select_policy_t *policy);
+
+// Stores the number of messages in the channel's buffer and the number of receivers blocked on it,
+// in channel_receive or in a channel_select waiting to receive from it
+// Returns SUCCESS, or CLOSED_ERROR if the channel is closed
+enum channel_status channel_occupancy(channel_t *channel, size_t *messages, size_t *blocked_receivers);
+
+// Registers watch so that watch->notify(watch->arg) is called whenever an operation in direction dir
+// may have become possible on the channel (SEND after a receive, RECV after a send) and when it closes
+// Notifications only say that the operation is worth retrying with the non-blocking calls
+// Returns SUCCESS, or CLOSED_ERROR if the channel is already closed
+enum channel_status channel_watch(channel_t *channel, enum direction dir, channel_watch_t *watch);
+
+// Removes a watch registered with channel_watch
+// Once this returns, the channel no longer calls the watch
+void channel_unwatch(channel_t *channel, enum direction dir, channel_watch_t *watch);
+
 #endif // CHANNEL_H
@@ -0,0 +1,585 @@
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+// Header-only C++ front-end for channels
+// Channel<T, N> stores up to N values of type T inline (no heap allocation and no void* casts),
+// supports move-only element types, and follows the semantics of channel.c:
+// the same channel_status return codes, blocking/non-blocking send and receive, close waking
+// every blocked call, and select registering one waker on every channel it watches
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "channel.h"
+
+namespace chan
+{
+
+namespace detail
+{
+
+// Something parked on a channel's waiter list
+// post() is called with the channel's mutex held whenever the channel changes state
+class Waiter
+{
+public:
+    virtual void post() = 0;
+
+protected:
+    ~Waiter() = default;
+};
+
+// C++ counterpart of the sem_t that channel_select registers on every channel
+// Channels post it on every state change; the selecting thread waits on it and rescans
+class Waker final : public Waiter
+{
+public:
+    void post() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count_++;
+        }
+        cv_.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return count_ > 0; });
+        count_--;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::size_t count_ = 0;
+};
+
+// Blocking and wakeup state shared by every channel, independent of how values are stored
+// Mirrors the mutex, condition variables, wait counts and semaphore lists of channel_t
+class ChannelCore
+{
+public:
+    ChannelCore() = default;
+    ChannelCore(const ChannelCore &) = delete;
+    ChannelCore &operator=(const ChannelCore &) = delete;
+
+    // Closes the channel and wakes every blocked send/receive/select
+    // Returns SUCCESS, or CLOSED_ERROR if the channel was already closed
+    enum channel_status close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        closed_ = true;
+        send_cv_.notify_all();
+        recv_cv_.notify_all();
+        handoff_cv_.notify_all();
+        for (Waiter *waiter : send_wakers_)
+        {
+            waiter->post();
+        }
+        for (Waiter *waiter : recv_wakers_)
+        {
+            waiter->post();
+        }
+        return SUCCESS;
+    }
+
+    bool is_closed()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+    // Registers a select waker (or a parked coroutine) for the given direction
+    // Returns false (and registers nothing) if the channel is already closed
+    bool watch(enum direction dir, Waiter *waiter)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return false;
+        }
+        wakers(dir).push_back(waiter);
+        return true;
+    }
+
+    // Removes one registration of the waiter; the same channel may be watched twice by one select
+    void unwatch(enum direction dir, Waiter *waiter)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Waiter *> &list = wakers(dir);
+        for (std::size_t i = 0; i < list.size(); i++)
+        {
+            if (list[i] == waiter)
+            {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+        }
+    }
+
+protected:
+    // Called with mutex_ held after a value became available
+    void notify_receivers()
+    {
+        if (recv_wait_count_ > 0)
+        {
+            recv_cv_.notify_one();
+        }
+        for (Waiter *waiter : recv_wakers_)
+        {
+            waiter->post();
+        }
+    }
+
+    // Called with mutex_ held after space became available
+    void notify_senders()
+    {
+        if (send_wait_count_ > 0)
+        {
+            send_cv_.notify_one();
+        }
+        for (Waiter *waiter : send_wakers_)
+        {
+            waiter->post();
+        }
+    }
+
+    std::vector<Waiter *> &wakers(enum direction dir)
+    {
+        return dir == SEND ? send_wakers_ : recv_wakers_;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable send_cv_;
+    std::condition_variable recv_cv_;
+    // only used by rendezvous channels: the sender waits here until its value is taken
+    std::condition_variable handoff_cv_;
+    bool closed_ = false;
+    std::size_t send_wait_count_ = 0;
+    std::size_t recv_wait_count_ = 0;
+    std::vector<Waiter *> send_wakers_;
+    std::vector<Waiter *> recv_wakers_;
+};
+
+// Fixed-capacity FIFO of N values stored inline
+// Slots are raw storage so T does not need to be default constructible
+template <typename T, std::size_t N>
+class Ring
+{
+public:
+    Ring() = default;
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    ~Ring()
+    {
+        while (size_ > 0)
+        {
+            at(next_)->~T();
+            advance();
+        }
+    }
+
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == N; }
+    std::size_t size() const { return size_; }
+
+    void push(T &&value)
+    {
+        std::size_t pos = next_ + size_;
+        if (pos >= N)
+        {
+            pos -= N;
+        }
+        ::new (static_cast<void *>(slots_[pos].bytes)) T(std::move(value));
+        size_++;
+    }
+
+    void pop(T &out)
+    {
+        T *value = at(next_);
+        out = std::move(*value);
+        value->~T();
+        advance();
+    }
+
+private:
+    struct Slot
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    T *at(std::size_t pos) { return std::launder(reinterpret_cast<T *>(slots_[pos].bytes)); }
+
+    void advance()
+    {
+        size_--;
+        next_++;
+        if (next_ >= N)
+        {
+            next_ = 0;
+        }
+    }
+
+    std::array<Slot, N> slots_;
+    std::size_t next_ = 0;
+    std::size_t size_ = 0;
+};
+
+// A single slot needs no ring indices, only a full flag
+template <typename T>
+class Ring<T, 1>
+{
+public:
+    Ring() = default;
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    ~Ring()
+    {
+        if (full_)
+        {
+            at()->~T();
+        }
+    }
+
+    bool empty() const { return !full_; }
+    bool full() const { return full_; }
+    std::size_t size() const { return full_ ? 1 : 0; }
+
+    void push(T &&value)
+    {
+        ::new (static_cast<void *>(slot_.bytes)) T(std::move(value));
+        full_ = true;
+    }
+
+    void pop(T &out)
+    {
+        out = std::move(*at());
+        at()->~T();
+        full_ = false;
+    }
+
+private:
+    struct Slot
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    T *at() { return std::launder(reinterpret_cast<T *>(slot_.bytes)); }
+
+    Slot slot_;
+    bool full_ = false;
+};
+
+} // namespace detail
+
+// Buffered channel holding up to N values of type T
+template <typename T, std::size_t N>
+class Channel : public detail::ChannelCore
+{
+public:
+    using value_type = T;
+    static constexpr std::size_t capacity = N;
+
+    // Blocking send; waits while the channel is full
+    // Returns SUCCESS, or CLOSED_ERROR if the channel is (or becomes) closed
+    enum channel_status send(T value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!closed_ && ring_.full())
+        {
+            send_wait_count_++;
+            send_cv_.wait(lock);
+            send_wait_count_--;
+        }
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        ring_.push(std::move(value));
+        notify_receivers();
+        return SUCCESS;
+    }
+
+    // Blocking receive; waits while the channel is empty
+    // Returns SUCCESS, or CLOSED_ERROR if the channel is (or becomes) closed
+    enum channel_status receive(T &out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!closed_ && ring_.empty())
+        {
+            recv_wait_count_++;
+            recv_cv_.wait(lock);
+            recv_wait_count_--;
+        }
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        ring_.pop(out);
+        notify_senders();
+        return SUCCESS;
+    }
+
+    // Non-blocking send; value is only moved from when SUCCESS is returned
+    // Returns SUCCESS, CHANNEL_FULL or CLOSED_ERROR
+    enum channel_status try_send(T &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        if (ring_.full())
+        {
+            return CHANNEL_FULL;
+        }
+        ring_.push(std::move(value));
+        notify_receivers();
+        return SUCCESS;
+    }
+
+    enum channel_status try_send(T &&value)
+    {
+        return try_send(value);
+    }
+
+    // Non-blocking receive
+    // Returns SUCCESS, CHANNEL_EMPTY or CLOSED_ERROR
+    enum channel_status try_receive(T &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        if (ring_.empty())
+        {
+            return CHANNEL_EMPTY;
+        }
+        ring_.pop(out);
+        notify_senders();
+        return SUCCESS;
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ring_.size();
+    }
+
+private:
+    detail::Ring<T, N> ring_;
+};
+
+// Unbuffered (rendezvous) channel: a send completes only once a receiver has taken the value
+// The sender offers a pointer to its own value, so nothing is copied into channel storage
+// try_send only succeeds when a receiver is blocked in receive(); two selects on opposite
+// ends of a rendezvous channel therefore never match each other
+template <typename T>
+class Channel<T, 0> : public detail::ChannelCore
+{
+public:
+    using value_type = T;
+    static constexpr std::size_t capacity = 0;
+
+    // Blocking send; waits for a receiver to take the value
+    // Returns SUCCESS, or CLOSED_ERROR if the channel is closed before the value was taken
+    enum channel_status send(T value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // only one value can be on offer at a time
+        while (!closed_ && offered_ != nullptr)
+        {
+            send_wait_count_++;
+            send_cv_.wait(lock);
+            send_wait_count_--;
+        }
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        return offer(lock, value);
+    }
+
+    // Blocking receive; waits for a sender to offer a value
+    // Returns SUCCESS, or CLOSED_ERROR if the channel is (or becomes) closed
+    enum channel_status receive(T &out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!closed_ && !offer_pending())
+        {
+            recv_wait_count_++;
+            recv_cv_.wait(lock);
+            recv_wait_count_--;
+        }
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        take(out);
+        return SUCCESS;
+    }
+
+    // Non-blocking send; succeeds only if a receiver is already blocked in receive()
+    // value is only moved from when SUCCESS is returned
+    // Returns SUCCESS, CHANNEL_FULL or CLOSED_ERROR
+    enum channel_status try_send(T &value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        if (offered_ != nullptr || recv_wait_count_ == 0)
+        {
+            return CHANNEL_FULL;
+        }
+        return offer(lock, value);
+    }
+
+    enum channel_status try_send(T &&value)
+    {
+        return try_send(value);
+    }
+
+    // Non-blocking receive; succeeds only if a sender is currently offering a value
+    // Returns SUCCESS, CHANNEL_EMPTY or CLOSED_ERROR
+    enum channel_status try_receive(T &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return CLOSED_ERROR;
+        }
+        if (!offer_pending())
+        {
+            return CHANNEL_EMPTY;
+        }
+        take(out);
+        return SUCCESS;
+    }
+
+    std::size_t size()
+    {
+        return 0;
+    }
+
+private:
+    bool offer_pending() const { return offered_ != nullptr && !taken_; }
+
+    // Publishes value and waits until a receiver takes it or the channel closes
+    enum channel_status offer(std::unique_lock<std::mutex> &lock, T &value)
+    {
+        offered_ = &value;
+        taken_ = false;
+        notify_receivers();
+        handoff_cv_.wait(lock, [this] { return taken_ || closed_; });
+        bool taken = taken_;
+        offered_ = nullptr;
+        taken_ = false;
+        // let the next sender offer
+        notify_senders();
+        return taken ? SUCCESS : CLOSED_ERROR;
+    }
+
+    void take(T &out)
+    {
+        out = std::move(*offered_);
+        taken_ = true;
+        handoff_cv_.notify_all();
+    }
+
+    T *offered_ = nullptr;
+    bool taken_ = false;
+};
+
+// A send case of select; owns the value until the send succeeds
+template <typename Ch>
+struct SendCase
+{
+    static constexpr enum direction dir = SEND;
+    Ch &channel;
+    typename Ch::value_type value;
+
+    enum channel_status attempt() { return channel.try_send(value); }
+};
+
+// A receive case of select; the received value is stored in out
+template <typename Ch>
+struct RecvCase
+{
+    static constexpr enum direction dir = RECV;
+    Ch &channel;
+    typename Ch::value_type &out;
+
+    enum channel_status attempt() { return channel.try_receive(out); }
+};
+
+template <typename Ch, typename U>
+SendCase<Ch> send_case(Ch &channel, U &&value)
+{
+    return SendCase<Ch>{channel, typename Ch::value_type(std::forward<U>(value))};
+}
+
+template <typename Ch>
+RecvCase<Ch> recv_case(Ch &channel, typename Ch::value_type &out)
+{
+    return RecvCase<Ch>{channel, out};
+}
+
+// Variadic select over channels of any element type and capacity
+// Behaves like channel_select: the cases are tried in order and the first one that can complete
+// is performed; if none can, the caller blocks until one of the channels changes state
+// selected_index is set to the case that completed (or failed) and its status is returned
+template <typename... Cases>
+enum channel_status select(std::size_t &selected_index, Cases &&...cases)
+{
+    static_assert(sizeof...(Cases) > 0, "select needs at least one case");
+    detail::Waker waker;
+
+    // register the waker on every channel, stopping at the first closed one
+    std::size_t registered = 0;
+    bool watching = ((cases.channel.watch(cases.dir, &waker) ? (registered++, true) : false) && ...);
+    auto unwatch = [&](std::size_t count) {
+        std::size_t i = 0;
+        ((i++ < count ? cases.channel.unwatch(cases.dir, &waker) : void()), ...);
+    };
+    if (!watching)
+    {
+        unwatch(registered);
+        selected_index = registered;
+        return CLOSED_ERROR;
+    }
+
+    while (true)
+    {
+        std::size_t index = 0;
+        enum channel_status status = CHANNEL_FULL;
+        bool completed = ((status = cases.attempt(), status != CHANNEL_FULL ? true : (index++, false)) || ...);
+        if (completed)
+        {
+            unwatch(sizeof...(Cases));
+            selected_index = index;
+            return status;
+        }
+        waker.wait();
+    }
+}
+
+} // namespace chan
+
+#endif // CHANNEL_HPP
@@ -0,0 +1,494 @@
+#ifndef CHANNEL_CORO_HPP
+#define CHANNEL_CORO_HPP
+
+// C++20 coroutine front-end for chan::Channel
+// co_await async_send/async_receive/async_select never block the worker thread: when the
+// operation cannot complete, the coroutine parks a waiter on the channels' waiter lists
+// (the same lists channel select uses) and returns the thread to the Executor.
+// A post from a channel schedules a retry of the operation, and the coroutine is resumed
+// once the retry completes, so the scan-and-wait loop of channel_select runs as a state machine.
+// Coroutine and thread operations on the same channel interoperate.
+// Only buffered channels are supported: a rendezvous try_send needs a thread blocked in receive().
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "channel.hpp"
+
+namespace chan
+{
+
+class Executor;
+
+namespace detail
+{
+
+// Unit of work run by an Executor thread
+class Job
+{
+public:
+    virtual void run() = 0;
+
+protected:
+    ~Job() = default;
+};
+
+} // namespace detail
+
+// Fire-and-forget coroutine started with Executor::spawn
+// The frame destroys itself when the coroutine finishes
+class Task
+{
+public:
+    struct promise_type final : detail::Job
+    {
+        Executor *executor = nullptr;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept;
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+        void run() override { std::coroutine_handle<promise_type>::from_promise(*this).resume(); }
+    };
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    // a task that was never spawned is destroyed without running
+    ~Task()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+private:
+    friend class Executor;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Fixed pool of threads resuming coroutines and their parked channel operations
+class Executor
+{
+public:
+    explicit Executor(std::size_t num_threads)
+    {
+        for (std::size_t i = 0; i < num_threads; i++)
+        {
+            threads_.emplace_back([this] { worker(); });
+        }
+    }
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    // Waits for all spawned tasks to finish, then stops the threads
+    ~Executor()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (std::thread &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    // Starts a task on one of the executor's threads
+    void spawn(Task task)
+    {
+        Task::promise_type &promise = std::exchange(task.handle_, nullptr).promise();
+        promise.executor = this;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            outstanding_++;
+        }
+        schedule(&promise);
+    }
+
+    void schedule(detail::Job *job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(job);
+        }
+        work_cv_.notify_one();
+    }
+
+    // Blocks the calling thread until every spawned task has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [this] { return outstanding_ == 0; });
+    }
+
+    // Called by a finishing task after its frame was destroyed
+    void task_done()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--outstanding_ == 0)
+        {
+            idle_cv_.notify_all();
+        }
+    }
+
+private:
+    void worker()
+    {
+        while (true)
+        {
+            detail::Job *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty())
+                {
+                    return;
+                }
+                job = queue_.front();
+                queue_.pop_front();
+            }
+            job->run();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<detail::Job *> queue_;
+    std::size_t outstanding_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+inline auto Task::promise_type::final_suspend() noexcept
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+        {
+            Executor *executor = handle.promise().executor;
+            handle.destroy();
+            executor->task_done();
+        }
+        void await_resume() noexcept {}
+    };
+    return FinalAwaiter{};
+}
+
+namespace detail
+{
+
+// Base of every channel awaitable
+// Derived classes provide:
+//   bool attempt()            tries the operation without blocking, returns true once it completed
+//   void watch_all()          registers this waiter on every channel involved
+//   void unwatch_all()        removes those registrations
+// A post from a channel schedules a retry; posts that arrive while a retry is running
+// mark it dirty so that the retry runs again instead of missing the wakeup
+template <typename Derived>
+class ChannelAwaiter : public Waiter, public Job
+{
+public:
+    // fast path: complete without touching any waiter list
+    bool await_ready() { return self().attempt(); }
+
+    bool await_suspend(std::coroutine_handle<Task::promise_type> handle)
+    {
+        handle_ = handle;
+        executor_ = handle.promise().executor;
+        state_.store(RUNNING);
+        self().watch_all();
+        // retry once after registering so that a post between await_ready and watch_all is not lost
+        // if this completes, resume right away; otherwise a later post resumes the coroutine
+        // (possibly on another thread, so nothing may touch *this after drain() returned false)
+        return !drain();
+    }
+
+    // called with a channel's mutex held
+    void post() override
+    {
+        int state = state_.load();
+        while (true)
+        {
+            if (state == IDLE)
+            {
+                if (state_.compare_exchange_weak(state, RUNNING))
+                {
+                    executor_->schedule(this);
+                    return;
+                }
+            }
+            else if (state == RUNNING)
+            {
+                if (state_.compare_exchange_weak(state, DIRTY))
+                {
+                    return;
+                }
+            }
+            else
+            {
+                // already dirty, or the operation completed
+                return;
+            }
+        }
+    }
+
+    // retry scheduled by post()
+    void run() override
+    {
+        if (drain())
+        {
+            handle_.resume();
+        }
+    }
+
+private:
+    enum
+    {
+        IDLE,    // parked, the next post schedules a retry
+        RUNNING, // a retry is in progress
+        DIRTY,   // posted while the retry was in progress
+        DONE     // completed, posts are ignored
+    };
+
+    Derived &self() { return static_cast<Derived &>(*this); }
+
+    // Retries until the operation completes (returns true) or the waiter is parked (returns false)
+    bool drain()
+    {
+        while (true)
+        {
+            if (self().attempt())
+            {
+                state_.store(DONE);
+                self().unwatch_all();
+                return true;
+            }
+            int expected = RUNNING;
+            if (state_.compare_exchange_strong(expected, IDLE))
+            {
+                return false;
+            }
+            state_.store(RUNNING);
+        }
+    }
+
+    std::coroutine_handle<Task::promise_type> handle_;
+    Executor *executor_ = nullptr;
+    std::atomic<int> state_{IDLE};
+};
+
+template <typename T, std::size_t N>
+class SendAwaiter final : public ChannelAwaiter<SendAwaiter<T, N>>
+{
+public:
+    static_assert(N > 0, "coroutine operations need a buffered channel");
+
+    SendAwaiter(Channel<T, N> &channel, T value) : channel_(channel), value_(std::move(value)) {}
+
+    bool attempt()
+    {
+        status_ = channel_.try_send(value_);
+        return status_ != CHANNEL_FULL;
+    }
+    void watch_all() { watched_ = channel_.watch(SEND, this); }
+    void unwatch_all()
+    {
+        if (watched_)
+        {
+            channel_.unwatch(SEND, this);
+        }
+    }
+    enum channel_status await_resume() { return status_; }
+
+private:
+    Channel<T, N> &channel_;
+    T value_;
+    bool watched_ = false;
+    enum channel_status status_ = GEN_ERROR;
+};
+
+template <typename T, std::size_t N>
+class ReceiveAwaiter final : public ChannelAwaiter<ReceiveAwaiter<T, N>>
+{
+public:
+    static_assert(N > 0, "coroutine operations need a buffered channel");
+
+    ReceiveAwaiter(Channel<T, N> &channel, T &out) : channel_(channel), out_(out) {}
+
+    bool attempt()
+    {
+        status_ = channel_.try_receive(out_);
+        return status_ != CHANNEL_EMPTY;
+    }
+    void watch_all() { watched_ = channel_.watch(RECV, this); }
+    void unwatch_all()
+    {
+        if (watched_)
+        {
+            channel_.unwatch(RECV, this);
+        }
+    }
+    enum channel_status await_resume() { return status_; }
+
+private:
+    Channel<T, N> &channel_;
+    T &out_;
+    bool watched_ = false;
+    enum channel_status status_ = GEN_ERROR;
+};
+
+// Select over a fixed set of send_case/recv_case arguments
+template <typename... Cases>
+class SelectAwaiter final : public ChannelAwaiter<SelectAwaiter<Cases...>>
+{
+public:
+    SelectAwaiter(std::size_t &selected_index, Cases... cases) : selected_index_(selected_index), cases_(std::move(cases)...) {}
+
+    bool attempt()
+    {
+        return std::apply([this](auto &...cases) {
+            std::size_t index = 0;
+            bool completed = ((status_ = cases.attempt(), status_ != CHANNEL_FULL ? true : (index++, false)) || ...);
+            selected_index_ = index;
+            return completed;
+        }, cases_);
+    }
+    void watch_all()
+    {
+        // stop at the first closed channel; attempt() reports it
+        std::apply([this](auto &...cases) {
+            ((cases.channel.watch(cases.dir, this) ? (watched_++, true) : false) && ...);
+        }, cases_);
+    }
+    void unwatch_all()
+    {
+        std::apply([this](auto &...cases) {
+            std::size_t i = 0;
+            ((i++ < watched_ ? cases.channel.unwatch(cases.dir, this) : void()), ...);
+        }, cases_);
+    }
+    enum channel_status await_resume() { return status_; }
+
+private:
+    std::size_t &selected_index_;
+    std::tuple<Cases...> cases_;
+    std::size_t watched_ = 0;
+    enum channel_status status_ = GEN_ERROR;
+};
+
+} // namespace detail
+
+// One entry of a select whose cases are only known at run time (the select_t of channel.h)
+template <typename T, std::size_t N>
+struct SelectEntry
+{
+    Channel<T, N> *channel;
+    enum direction dir;
+    // value to send for SEND entries, the received value for RECV entries
+    T data;
+};
+
+namespace detail
+{
+
+template <typename T, std::size_t N>
+class SelectListAwaiter final : public ChannelAwaiter<SelectListAwaiter<T, N>>
+{
+public:
+    static_assert(N > 0, "coroutine operations need a buffered channel");
+
+    SelectListAwaiter(SelectEntry<T, N> *entries, std::size_t count, std::size_t &selected_index)
+        : entries_(entries), count_(count), selected_index_(selected_index) {}
+
+    bool attempt()
+    {
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            SelectEntry<T, N> &entry = entries_[i];
+            status_ = entry.dir == SEND ? entry.channel->try_send(entry.data) : entry.channel->try_receive(entry.data);
+            if (status_ != CHANNEL_FULL)
+            {
+                selected_index_ = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    void watch_all()
+    {
+        while (watched_ < count_ && entries_[watched_].channel->watch(entries_[watched_].dir, this))
+        {
+            watched_++;
+        }
+    }
+    void unwatch_all()
+    {
+        for (std::size_t i = 0; i < watched_; i++)
+        {
+            entries_[i].channel->unwatch(entries_[i].dir, this);
+        }
+    }
+    enum channel_status await_resume() { return status_; }
+
+private:
+    SelectEntry<T, N> *entries_;
+    std::size_t count_;
+    std::size_t &selected_index_;
+    std::size_t watched_ = 0;
+    enum channel_status status_ = GEN_ERROR;
+};
+
+} // namespace detail
+
+// co_await async_send(channel, value): SUCCESS or CLOSED_ERROR
+template <typename T, std::size_t N, typename U>
+detail::SendAwaiter<T, N> async_send(Channel<T, N> &channel, U &&value)
+{
+    return detail::SendAwaiter<T, N>(channel, T(std::forward<U>(value)));
+}
+
+// co_await async_receive(channel, out): SUCCESS or CLOSED_ERROR
+template <typename T, std::size_t N>
+detail::ReceiveAwaiter<T, N> async_receive(Channel<T, N> &channel, T &out)
+{
+    return detail::ReceiveAwaiter<T, N>(channel, out);
+}
+
+// co_await async_select(selected_index, send_case(...), recv_case(...), ...)
+// Same rules as chan::select, without blocking the thread
+template <typename... Cases>
+detail::SelectAwaiter<std::decay_t<Cases>...> async_select(std::size_t &selected_index, Cases &&...cases)
+{
+    static_assert(sizeof...(Cases) > 0, "select needs at least one case");
+    return detail::SelectAwaiter<std::decay_t<Cases>...>(selected_index, std::forward<Cases>(cases)...);
+}
+
+// co_await async_select(entries, count, selected_index) over a run-time list, like channel_select
+template <typename T, std::size_t N>
+detail::SelectListAwaiter<T, N> async_select(SelectEntry<T, N> *entries, std::size_t count, std::size_t &selected_index)
+{
+    return detail::SelectListAwaiter<T, N>(entries, count, selected_index);
+}
+
+} // namespace chan
+
+#endif // CHANNEL_CORO_HPP
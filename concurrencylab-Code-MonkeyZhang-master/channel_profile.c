@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "channel_profile.h"
+
+// Statistics of a destroyed channel kept for the exit report
+typedef struct
+{
+    size_t id;
+    channel_lock_stats_t site[LOCK_SITE_COUNT];
+    uint64_t total_wait_ns;
+} retired_profile_t;
+
+static const char *site_names[LOCK_SITE_COUNT] = {"send", "receive", "select", "close", "stats"};
+
+static atomic_size_t next_id;
+static pthread_once_t report_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t retired_mutex = PTHREAD_MUTEX_INITIALIZER;
+static retired_profile_t *retired;
+static size_t retired_count;
+static size_t retired_capacity;
+
+static uint64_t now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void report_at_exit()
+{
+    channel_profile_report(stderr);
+    free(retired);
+}
+
+static void register_report()
+{
+    atexit(report_at_exit);
+}
+
+// Initializes a channel's profile and registers the exit report on first use
+void channel_profile_init(channel_lock_profile_t *profile)
+{
+    pthread_once(&report_once, register_report);
+    memset(profile, 0, sizeof(*profile));
+    profile->id = atomic_fetch_add(&next_id, 1);
+}
+
+// Takes the mutex on behalf of the given call site
+// Tries the lock first so that contended acquisitions can be counted and their wait timed
+void channel_profile_lock(pthread_mutex_t *mutex, channel_lock_profile_t *profile, enum channel_lock_site site)
+{
+    uint64_t wait = 0;
+    bool contended = pthread_mutex_trylock(mutex) != 0;
+    if (contended)
+    {
+        uint64_t start = now_ns();
+        pthread_mutex_lock(mutex);
+        wait = now_ns() - start;
+    }
+    channel_lock_stats_t *stats = &profile->site[site];
+    stats->acquisitions++;
+    if (contended)
+    {
+        stats->contended++;
+        stats->wait_ns += wait;
+        if (wait > stats->max_wait_ns)
+        {
+            stats->max_wait_ns = wait;
+        }
+    }
+    profile->holder = site;
+    profile->acquired_at = now_ns();
+}
+
+// Records the hold time of the current acquisition and releases the mutex
+void channel_profile_unlock(pthread_mutex_t *mutex, channel_lock_profile_t *profile)
+{
+    profile->site[profile->holder].hold_ns += now_ns() - profile->acquired_at;
+    pthread_mutex_unlock(mutex);
+}
+
+// Waits on a condition variable without counting the time asleep as hold time
+void channel_profile_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, channel_lock_profile_t *profile)
+{
+    enum channel_lock_site site = profile->holder;
+    profile->site[site].hold_ns += now_ns() - profile->acquired_at;
+    pthread_cond_wait(cond, mutex);
+    // the wakeup re-acquires the lock, which counts as a new acquisition of the same site
+    profile->site[site].acquisitions++;
+    profile->holder = site;
+    profile->acquired_at = now_ns();
+}
+
+// Folds a channel's statistics into the exit report; called from channel_destroy
+void channel_profile_retire(channel_lock_profile_t *profile)
+{
+    pthread_mutex_lock(&retired_mutex);
+    if (retired_count == retired_capacity)
+    {
+        retired_capacity = retired_capacity ? retired_capacity * 2 : 64;
+        retired = realloc(retired, sizeof(retired_profile_t) * retired_capacity);
+    }
+    retired_profile_t *entry = &retired[retired_count++];
+    entry->id = profile->id;
+    entry->total_wait_ns = 0;
+    for (size_t i = 0; i < LOCK_SITE_COUNT; i++)
+    {
+        entry->site[i] = profile->site[i];
+        entry->total_wait_ns += profile->site[i].wait_ns;
+    }
+    pthread_mutex_unlock(&retired_mutex);
+}
+
+static int compare_wait(const void *a, const void *b)
+{
+    uint64_t wait_a = ((const retired_profile_t *)a)->total_wait_ns;
+    uint64_t wait_b = ((const retired_profile_t *)b)->total_wait_ns;
+    return (wait_a < wait_b) - (wait_a > wait_b);
+}
+
+static void print_stats(FILE *out, const char *name, const channel_lock_stats_t *stats)
+{
+    double contended_pct = stats->acquisitions ? 100.0 * (double)stats->contended / (double)stats->acquisitions : 0.0;
+    fprintf(out, "  %-8s acq %10llu  contended %10llu (%5.1f%%)  wait %12.3f ms  max wait %9.3f ms  hold %12.3f ms\n",
+            name,
+            (unsigned long long)stats->acquisitions,
+            (unsigned long long)stats->contended,
+            contended_pct,
+            (double)stats->wait_ns / 1e6,
+            (double)stats->max_wait_ns / 1e6,
+            (double)stats->hold_ns / 1e6);
+}
+
+// Prints the per call site totals and the top-N channels by wait time
+// N is read from the CHANNEL_PROFILE_TOP environment variable (default 10)
+void channel_profile_report(FILE *out)
+{
+    size_t top = 10;
+    const char *env = getenv("CHANNEL_PROFILE_TOP");
+    if (env != NULL)
+    {
+        top = (size_t)strtoul(env, NULL, 10);
+    }
+
+    pthread_mutex_lock(&retired_mutex);
+    channel_lock_stats_t totals[LOCK_SITE_COUNT];
+    memset(totals, 0, sizeof(totals));
+    for (size_t i = 0; i < retired_count; i++)
+    {
+        for (size_t s = 0; s < LOCK_SITE_COUNT; s++)
+        {
+            totals[s].acquisitions += retired[i].site[s].acquisitions;
+            totals[s].contended += retired[i].site[s].contended;
+            totals[s].wait_ns += retired[i].site[s].wait_ns;
+            totals[s].hold_ns += retired[i].site[s].hold_ns;
+            if (retired[i].site[s].max_wait_ns > totals[s].max_wait_ns)
+            {
+                totals[s].max_wait_ns = retired[i].site[s].max_wait_ns;
+            }
+        }
+    }
+    qsort(retired, retired_count, sizeof(retired_profile_t), compare_wait);
+
+    fprintf(out, "CHANNEL LOCK PROFILE (%zu channels destroyed)\n", retired_count);
+    fprintf(out, "by call site:\n");
+    for (size_t s = 0; s < LOCK_SITE_COUNT; s++)
+    {
+        print_stats(out, site_names[s], &totals[s]);
+    }
+    if (top > retired_count)
+    {
+        top = retired_count;
+    }
+    fprintf(out, "top %zu channels by wait time:\n", top);
+    for (size_t i = 0; i < top; i++)
+    {
+        fprintf(out, "channel %zu: total wait %.3f ms\n", retired[i].id, (double)retired[i].total_wait_ns / 1e6);
+        for (size_t s = 0; s < LOCK_SITE_COUNT; s++)
+        {
+            if (retired[i].site[s].acquisitions > 0)
+            {
+                print_stats(out, site_names[s], &retired[i].site[s]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&retired_mutex);
+}
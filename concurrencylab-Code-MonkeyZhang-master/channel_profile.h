@@ -0,0 +1,60 @@
+#ifndef CHANNEL_PROFILE_H
+#define CHANNEL_PROFILE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Call sites that take a channel's mutex
+enum channel_lock_site
+{
+    LOCK_SITE_SEND,
+    LOCK_SITE_RECEIVE,
+    LOCK_SITE_SELECT,
+    LOCK_SITE_CLOSE,
+    LOCK_SITE_STATS,
+    LOCK_SITE_COUNT
+};
+
+// Lock statistics for one call site
+typedef struct
+{
+    uint64_t acquisitions; // number of times the lock was taken
+    uint64_t contended;    // acquisitions where the first try-lock failed
+    uint64_t wait_ns;      // total time spent blocked in pthread_mutex_lock
+    uint64_t max_wait_ns;  // longest single wait
+    uint64_t hold_ns;      // total time the lock was held
+} channel_lock_stats_t;
+
+// Per-channel lock profile, embedded in channel_t when built with CHANNEL_PROFILE
+// Every field is protected by the channel's own mutex
+typedef struct
+{
+    size_t id;                      // creation order of the channel
+    uint64_t acquired_at;           // timestamp of the current acquisition
+    enum channel_lock_site holder;  // call site that currently holds the lock
+    channel_lock_stats_t site[LOCK_SITE_COUNT];
+} channel_lock_profile_t;
+
+// Initializes a channel's profile and registers the exit report on first use
+void channel_profile_init(channel_lock_profile_t *profile);
+
+// Takes the mutex on behalf of the given call site
+// Tries the lock first so that contended acquisitions can be counted and their wait timed
+void channel_profile_lock(pthread_mutex_t *mutex, channel_lock_profile_t *profile, enum channel_lock_site site);
+
+// Records the hold time of the current acquisition and releases the mutex
+void channel_profile_unlock(pthread_mutex_t *mutex, channel_lock_profile_t *profile);
+
+// Waits on a condition variable without counting the time asleep as hold time
+void channel_profile_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, channel_lock_profile_t *profile);
+
+// Folds a channel's statistics into the exit report; called from channel_destroy
+void channel_profile_retire(channel_lock_profile_t *profile);
+
+// Prints the per call site totals and the top-N channels by wait time
+// N is read from the CHANNEL_PROFILE_TOP environment variable (default 10)
+void channel_profile_report(FILE *out);
+
+#endif // CHANNEL_PROFILE_H
@@ -0,0 +1,237 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "channel_trace.h"
+
+#define TRACE_MAGIC "CHTRACE1"
+
+typedef struct
+{
+    char magic[8];
+    uint32_t record_size;
+    uint32_t num_threads;
+    uint32_t num_channels;
+    uint32_t reserved;
+    uint64_t num_records;
+} trace_header_t;
+
+static const char *op_names[TRACE_OPS] = {"create", "send", "receive", "nb_send", "nb_receive",
+                                          "select_send", "select_recv", "close", "destroy"};
+
+// Records of one thread; the mutex is only contended by the writer at exit
+typedef struct trace_buffer
+{
+    pthread_mutex_t mutex;
+    uint32_t thread;
+    size_t count;
+    size_t capacity;
+    channel_trace_record_t *records;
+    struct trace_buffer *next;
+} trace_buffer_t;
+
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+static pthread_mutex_t buffers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static trace_buffer_t *buffers;
+static uint64_t epoch_ns;
+static atomic_uint next_channel;
+static atomic_uint next_thread;
+
+const char *channel_trace_op_name(enum channel_trace_op op)
+{
+    return op < TRACE_OPS ? op_names[op] : "unknown";
+}
+
+int channel_trace_write(const char *path, const channel_trace_record_t *records, size_t num_records)
+{
+    trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(channel_trace_record_t);
+    header.num_records = num_records;
+    for (size_t i = 0; i < num_records; i++)
+    {
+        if (records[i].thread + 1 > header.num_threads)
+        {
+            header.num_threads = records[i].thread + 1;
+        }
+        if (records[i].channel != TRACE_NO_CHANNEL && records[i].channel + 1 > header.num_channels)
+        {
+            header.num_channels = records[i].channel + 1;
+        }
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(records, sizeof(channel_trace_record_t), num_records, file) == num_records;
+    if (fclose(file) != 0 || !written)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+channel_trace_t *channel_trace_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    trace_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(channel_trace_record_t))
+    {
+        fclose(file);
+        return NULL;
+    }
+    channel_trace_t *trace = malloc(sizeof(channel_trace_t));
+    trace->num_records = (size_t)header.num_records;
+    trace->num_threads = header.num_threads;
+    trace->num_channels = header.num_channels;
+    trace->records = malloc(sizeof(channel_trace_record_t) * (trace->num_records ? trace->num_records : 1));
+    if (trace->records == NULL ||
+        fread(trace->records, sizeof(channel_trace_record_t), trace->num_records, file) != trace->num_records)
+    {
+        fclose(file);
+        channel_trace_free(trace);
+        return NULL;
+    }
+    fclose(file);
+    // replay indexes per-thread and per-channel arrays with these, so a stale or edited file stops here
+    for (size_t i = 0; i < trace->num_records; i++)
+    {
+        const channel_trace_record_t *record = &trace->records[i];
+        bool known_channel = record->channel < trace->num_channels ||
+                             (record->channel == TRACE_NO_CHANNEL && record->op != TRACE_CREATE);
+        if (record->op >= TRACE_OPS || record->thread >= trace->num_threads || !known_channel)
+        {
+            channel_trace_free(trace);
+            return NULL;
+        }
+    }
+    return trace;
+}
+
+void channel_trace_free(channel_trace_t *trace)
+{
+    if (trace != NULL)
+    {
+        free(trace->records);
+        free(trace);
+    }
+}
+
+uint64_t channel_trace_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static int compare_records(const void *a, const void *b)
+{
+    const channel_trace_record_t *x = a;
+    const channel_trace_record_t *y = b;
+    if (x->time_ns != y->time_ns)
+    {
+        return x->time_ns < y->time_ns ? -1 : 1;
+    }
+    return (x->thread > y->thread) - (x->thread < y->thread);
+}
+
+// Merges every thread's records and writes the trace
+static void write_at_exit()
+{
+    pthread_mutex_lock(&buffers_mutex);
+    size_t total = 0;
+    for (trace_buffer_t *buffer = buffers; buffer != NULL; buffer = buffer->next)
+    {
+        pthread_mutex_lock(&buffer->mutex);
+        total += buffer->count;
+    }
+    channel_trace_record_t *records = malloc(sizeof(channel_trace_record_t) * (total ? total : 1));
+    size_t count = 0;
+    for (trace_buffer_t *buffer = buffers; buffer != NULL; buffer = buffer->next)
+    {
+        memcpy(&records[count], buffer->records, sizeof(channel_trace_record_t) * buffer->count);
+        count += buffer->count;
+        pthread_mutex_unlock(&buffer->mutex);
+    }
+    pthread_mutex_unlock(&buffers_mutex);
+    qsort(records, count, sizeof(channel_trace_record_t), compare_records);
+    const char *path = getenv("CHANNEL_TRACE_FILE");
+    if (path == NULL)
+    {
+        path = "channel.trace";
+    }
+    if (channel_trace_write(path, records, count) != 0)
+    {
+        fprintf(stderr, "channel trace: cannot write %s\n", path);
+    }
+    else
+    {
+        fprintf(stderr, "channel trace: %zu operations written to %s\n", count, path);
+    }
+    free(records);
+}
+
+static void trace_init()
+{
+    pthread_key_create(&buffer_key, NULL);
+    epoch_ns = channel_trace_now();
+    atexit(write_at_exit);
+}
+
+uint32_t channel_trace_register()
+{
+    pthread_once(&trace_once, trace_init);
+    return atomic_fetch_add(&next_channel, 1);
+}
+
+static trace_buffer_t *buffer_of_thread()
+{
+    trace_buffer_t *buffer = pthread_getspecific(buffer_key);
+    if (buffer == NULL)
+    {
+        buffer = malloc(sizeof(trace_buffer_t));
+        pthread_mutex_init(&buffer->mutex, NULL);
+        buffer->thread = atomic_fetch_add(&next_thread, 1);
+        buffer->count = 0;
+        buffer->capacity = 0;
+        buffer->records = NULL;
+        pthread_mutex_lock(&buffers_mutex);
+        buffer->next = buffers;
+        buffers = buffer;
+        pthread_mutex_unlock(&buffers_mutex);
+        pthread_setspecific(buffer_key, buffer);
+    }
+    return buffer;
+}
+
+void channel_trace_record(uint32_t channel, enum channel_trace_op op, uint32_t arg, int status, uint64_t start_ns)
+{
+    trace_buffer_t *buffer = buffer_of_thread();
+    pthread_mutex_lock(&buffer->mutex);
+    if (buffer->count == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        buffer->records = realloc(buffer->records, sizeof(channel_trace_record_t) * buffer->capacity);
+    }
+    channel_trace_record_t *record = &buffer->records[buffer->count++];
+    record->time_ns = start_ns > epoch_ns ? start_ns - epoch_ns : 0;
+    record->thread = buffer->thread;
+    record->channel = channel;
+    record->arg = arg;
+    record->op = (uint8_t)op;
+    record->status = (int8_t)status;
+    record->reserved = 0;
+    pthread_mutex_unlock(&buffer->mutex);
+}
@@ -0,0 +1,74 @@
+#ifndef CHANNEL_TRACE_H
+#define CHANNEL_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Channel operation traces: `make trace` builds the channel with CHANNEL_TRACE, which logs every
+// public channel call (thread, channel, operation, start time, status) into per-thread buffers that
+// are merged in time order and written to a binary trace at exit, to CHANNEL_TRACE_FILE (default
+// channel.trace). replay.h re-issues a trace against a channel engine.
+
+// Operations in a trace
+enum channel_trace_op
+{
+    TRACE_CREATE,      // arg is the buffer size
+    TRACE_SEND,
+    TRACE_RECEIVE,
+    TRACE_NB_SEND,
+    TRACE_NB_RECEIVE,
+    TRACE_SELECT_SEND, // a select that sent on channel; arg is the number of select entries
+    TRACE_SELECT_RECV, // a select that received from channel
+    TRACE_CLOSE,
+    TRACE_DESTROY,
+    TRACE_OPS
+};
+
+// Channel id of a select that failed before picking an entry
+#define TRACE_NO_CHANNEL UINT32_MAX
+
+// One operation, 24 bytes on disk
+typedef struct
+{
+    uint64_t time_ns; // when the call started, from the first traced channel's creation
+    uint32_t thread;  // small ids in order of each thread's first traced call
+    uint32_t channel; // ids in creation order
+    uint32_t arg;
+    uint8_t op;       // enum channel_trace_op
+    int8_t status;    // enum channel_status returned
+    uint16_t reserved;
+} channel_trace_record_t;
+
+typedef struct
+{
+    size_t num_records;
+    uint32_t num_threads;
+    uint32_t num_channels;
+    channel_trace_record_t *records; // sorted by time
+} channel_trace_t;
+
+// Returns the name of op, e.g. "send"
+const char *channel_trace_op_name(enum channel_trace_op op);
+
+// Writes num_records records to path in the trace format
+// Returns 0 on success, -1 if the file cannot be written
+int channel_trace_write(const char *path, const channel_trace_record_t *records, size_t num_records);
+
+// Reads a trace written by channel_trace_write; returns NULL if path is missing or not a trace,
+// or if a record names an op, thread or channel the header does not account for
+channel_trace_t *channel_trace_load(const char *path);
+
+void channel_trace_free(channel_trace_t *trace);
+
+// Recording, used by channel.c in CHANNEL_TRACE builds
+
+// Returns nanoseconds on the trace clock
+uint64_t channel_trace_now();
+
+// Returns the id of a new channel and registers the trace writer on first use
+uint32_t channel_trace_register();
+
+// Logs an operation of the calling thread that started at start_ns
+void channel_trace_record(uint32_t channel, enum channel_trace_op op, uint32_t arg, int status, uint64_t start_ns);
+
+#endif // CHANNEL_TRACE_H
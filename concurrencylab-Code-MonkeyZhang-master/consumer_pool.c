@@ -0,0 +1,267 @@
+#include <assert.h>
+#include <time.h>
+#include "consumer_pool.h"
+
+enum worker_state
+{
+    WORKER_FREE,
+    WORKER_RUNNING,
+    WORKER_EXITED, // returned, waiting to be joined
+};
+
+typedef struct
+{
+    pthread_t thread;
+    enum worker_state state;
+    consumer_pool_t *pool;
+} consumer_worker_t;
+
+struct consumer_pool
+{
+    channel_t *channel;
+    consumer_pool_config_t config;
+    void (*consume)(void *message, void *arg);
+    void *arg;
+    // an idle worker that receives a token from here retires
+    channel_t *retire_channel;
+    pthread_t monitor;
+    struct timespec start;
+
+    pthread_mutex_t mutex; // protects everything below
+    consumer_worker_t *workers; // max_workers slots
+    size_t pending_retirements;
+    consumer_pool_stats_t stats;
+    atomic_size_t consumed;
+};
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void *worker_main(void *arg)
+{
+    consumer_worker_t *worker = arg;
+    consumer_pool_t *pool = worker->pool;
+    bool retired = false;
+    while (true)
+    {
+        void *message;
+        enum channel_status status = channel_non_blocking_receive(pool->channel, &message);
+        if (status == CHANNEL_EMPTY)
+        {
+            // idle: the only place a worker may be told to retire
+            select_t list[2] = {{pool->channel, RECV, NULL}, {pool->retire_channel, RECV, NULL}};
+            size_t index = 0;
+            status = channel_select(list, 2, &index);
+            if (status == SUCCESS && index == 1)
+            {
+                retired = true;
+                break;
+            }
+            message = list[0].data;
+        }
+        if (status != SUCCESS)
+        {
+            break;
+        }
+        pool->consume(message, pool->arg);
+        atomic_fetch_add_explicit(&pool->consumed, 1, memory_order_relaxed);
+    }
+    pthread_mutex_lock(&pool->mutex);
+    if (retired)
+    {
+        pool->pending_retirements--;
+    }
+    pool->stats.workers--;
+    worker->state = WORKER_EXITED;
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+// Starts a worker in a free slot; the pool mutex must be held
+static void spawn_worker(consumer_pool_t *pool)
+{
+    for (size_t i = 0; i < pool->config.max_workers; i++)
+    {
+        consumer_worker_t *worker = &pool->workers[i];
+        if (worker->state == WORKER_EXITED)
+        {
+            pthread_join(worker->thread, NULL);
+            worker->state = WORKER_FREE;
+        }
+        if (worker->state == WORKER_FREE)
+        {
+            worker->pool = pool;
+            worker->state = WORKER_RUNNING;
+            int status = pthread_create(&worker->thread, NULL, worker_main, worker);
+            assert(status == 0);
+            pool->stats.workers++;
+            if (pool->stats.workers > pool->stats.peak_workers)
+            {
+                pool->stats.peak_workers = pool->stats.workers;
+            }
+            return;
+        }
+    }
+    assert(false);
+}
+
+// Records a scaling event; the pool mutex must be held
+static void record_event(consumer_pool_t *pool, enum consumer_pool_event_kind kind, double time, size_t workers, size_t depth)
+{
+    consumer_pool_stats_t *stats = &pool->stats;
+    if (kind == CONSUMER_POOL_SCALE_UP)
+    {
+        stats->scale_ups++;
+    }
+    else
+    {
+        stats->scale_downs++;
+    }
+    if (stats->num_events == CONSUMER_POOL_EVENTS)
+    {
+        memmove(&stats->events[0], &stats->events[1], sizeof(consumer_pool_event_t) * (CONSUMER_POOL_EVENTS - 1));
+        stats->num_events--;
+    }
+    stats->events[stats->num_events++] = (consumer_pool_event_t){kind, time, workers, depth};
+}
+
+static void *monitor_main(void *arg)
+{
+    consumer_pool_t *pool = arg;
+    const consumer_pool_config_t *config = &pool->config;
+    struct timespec interval;
+    interval.tv_sec = (time_t)config->sample_interval;
+    interval.tv_nsec = (long)((config->sample_interval - (double)interval.tv_sec) * 1e9);
+    size_t backlogged = 0;
+    double idle_since = -1;
+    double last_event = 0;
+    while (true)
+    {
+        clock_nanosleep(CLOCK_MONOTONIC, 0, &interval, NULL);
+        size_t depth, blocked;
+        if (channel_occupancy(pool->channel, &depth, &blocked) != SUCCESS)
+        {
+            break;
+        }
+        double now = seconds_since(&pool->start);
+        backlogged = depth >= config->high_watermark ? backlogged + 1 : 0;
+        // a blocked receiver with nothing buffered is an idle worker
+        if (blocked == 0 || depth > 0)
+        {
+            idle_since = -1;
+        }
+        else if (idle_since < 0)
+        {
+            idle_since = now;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->stats.samples++;
+        pool->stats.last_depth = depth;
+        size_t active = pool->stats.workers - pool->pending_retirements;
+        if (backlogged >= config->scale_up_samples && active < config->max_workers)
+        {
+            // take back a retirement nobody picked up yet before starting a new thread
+            void *token;
+            if (pool->pending_retirements > 0 && channel_non_blocking_receive(pool->retire_channel, &token) == SUCCESS)
+            {
+                pool->pending_retirements--;
+            }
+            else
+            {
+                spawn_worker(pool);
+            }
+            record_event(pool, CONSUMER_POOL_SCALE_UP, now, active + 1, depth);
+            backlogged = 0;
+            last_event = now;
+        }
+        else if (idle_since >= 0 && now - idle_since >= config->cooldown && now - last_event >= config->cooldown &&
+                 active > config->min_workers && pool->pending_retirements == 0)
+        {
+            if (channel_non_blocking_send(pool->retire_channel, NULL) == SUCCESS)
+            {
+                pool->pending_retirements++;
+                record_event(pool, CONSUMER_POOL_SCALE_DOWN, now, active - 1, depth);
+                last_event = now;
+                // the next worker has to be idle for a whole cooldown of its own
+                idle_since = now;
+            }
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+consumer_pool_t *consumer_pool_create(channel_t *channel, const consumer_pool_config_t *config,
+                                      void (*consume)(void *message, void *arg), void *arg)
+{
+    assert(config->min_workers >= 1 && config->min_workers <= config->max_workers);
+    consumer_pool_t *pool = malloc(sizeof(consumer_pool_t));
+    assert(pool != NULL);
+    pool->channel = channel;
+    pool->config = *config;
+    pool->consume = consume;
+    pool->arg = arg;
+    pool->retire_channel = channel_create(config->max_workers);
+    clock_gettime(CLOCK_MONOTONIC, &pool->start);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->workers = malloc(sizeof(consumer_worker_t) * config->max_workers);
+    assert(pool->workers != NULL);
+    for (size_t i = 0; i < config->max_workers; i++)
+    {
+        pool->workers[i].state = WORKER_FREE;
+    }
+    pool->pending_retirements = 0;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    atomic_init(&pool->consumed, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    for (size_t i = 0; i < config->min_workers; i++)
+    {
+        spawn_worker(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    int status = pthread_create(&pool->monitor, NULL, monitor_main, pool);
+    assert(status == 0);
+    return pool;
+}
+
+void consumer_pool_stats(consumer_pool_t *pool, consumer_pool_stats_t *stats)
+{
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+    stats->consumed = atomic_load_explicit(&pool->consumed, memory_order_relaxed);
+}
+
+void consumer_pool_destroy(consumer_pool_t *pool)
+{
+    // both the monitor and the workers stop on their own once the channel is closed
+    pthread_join(pool->monitor, NULL);
+    // without the monitor no slot changes from free to used anymore
+    pthread_mutex_lock(&pool->mutex);
+    bool *used = malloc(sizeof(bool) * pool->config.max_workers);
+    assert(used != NULL);
+    for (size_t i = 0; i < pool->config.max_workers; i++)
+    {
+        used[i] = pool->workers[i].state != WORKER_FREE;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->config.max_workers; i++)
+    {
+        if (used[i])
+        {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+    }
+    free(used);
+    channel_close(pool->retire_channel);
+    channel_destroy(pool->retire_channel);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    free(pool);
+}
@@ -0,0 +1,67 @@
+#ifndef CONSUMER_POOL_H
+#define CONSUMER_POOL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "channel.h"
+
+// Elastic pool of consumer threads bound to one channel. A monitor thread samples the channel's depth
+// and blocked receivers with channel_occupancy: a backlog that lasts scale_up_samples samples in a row
+// adds a worker (up to max_workers), and workers that have stayed idle for cooldown seconds retire one
+// at a time (down to min_workers). Scale-downs also wait cooldown seconds after any scaling event, so a
+// bursty load does not make the pool thrash.
+typedef struct
+{
+    size_t min_workers;      // started right away, at least 1
+    size_t max_workers;
+    size_t high_watermark;   // buffered messages that count as a backlog
+    double sample_interval;  // seconds between samples
+    size_t scale_up_samples; // backlogged samples in a row before a worker is added
+    double cooldown;         // seconds of idleness, and since the last scaling event, before a worker retires
+} consumer_pool_config_t;
+
+enum consumer_pool_event_kind
+{
+    CONSUMER_POOL_SCALE_UP,
+    CONSUMER_POOL_SCALE_DOWN,
+};
+
+typedef struct
+{
+    enum consumer_pool_event_kind kind;
+    double time;    // seconds since the pool was created
+    size_t workers; // workers after the event
+    size_t depth;   // buffered messages at the sample that triggered it
+} consumer_pool_event_t;
+
+// Scaling events kept in the stats, most recent last
+#define CONSUMER_POOL_EVENTS 16
+
+typedef struct
+{
+    size_t workers;      // running, including one asked to retire that has not yet
+    size_t peak_workers;
+    size_t consumed;     // messages handed to consume
+    size_t samples;
+    size_t last_depth;   // buffered messages at the last sample
+    size_t scale_ups;
+    size_t scale_downs;
+    size_t num_events;   // valid entries of events
+    consumer_pool_event_t events[CONSUMER_POOL_EVENTS];
+} consumer_pool_stats_t;
+
+typedef struct consumer_pool consumer_pool_t;
+
+// Starts min_workers workers that call consume(message, arg) for every message received on channel,
+// and the monitor that scales them
+consumer_pool_t *consumer_pool_create(channel_t *channel, const consumer_pool_config_t *config,
+                                      void (*consume)(void *message, void *arg), void *arg);
+
+// Stores the pool's counters and its most recent scaling events
+void consumer_pool_stats(consumer_pool_t *pool, consumer_pool_stats_t *stats);
+
+// Waits for the workers to stop and frees the pool
+// The channel must have been closed; messages still buffered when it was closed are not consumed
+void consumer_pool_destroy(consumer_pool_t *pool);
+
+#endif // CONSUMER_POOL_H
@@ -0,0 +1,229 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "ebr.h"
+
+// Retirements between two attempts to advance the epoch and free old lists
+#define EBR_BATCH 64
+// A record's announcement: the epoch it observed, shifted left, with the low bit set while in a section
+#define EBR_ACTIVE 1
+
+typedef struct ebr_node
+{
+    struct ebr_node *next;
+    void *ptr;
+    void (*free_fn)(void *ptr, void *ctx);
+    void *ctx;
+} ebr_node_t;
+
+typedef struct ebr_record
+{
+    atomic_uint_fast64_t announce;
+    atomic_bool in_use; // owned by a live thread; records of exited threads are adopted by new ones
+    // retired nodes by epoch modulo 3, and the epoch each list was filled in; only the owner touches these
+    ebr_node_t *retired[3];
+    uint64_t retired_epoch[3];
+    size_t pending;
+    struct ebr_record *next; // link in the domain's list, which only grows
+} ebr_record_t;
+
+struct ebr
+{
+    atomic_uint_fast64_t epoch;
+    _Atomic(ebr_record_t *) records;
+    pthread_key_t key; // the calling thread's record
+    atomic_size_t threads;
+    atomic_size_t retired;
+    atomic_size_t freed;
+};
+
+static void record_release(void *record)
+{
+    atomic_store(&((ebr_record_t *)record)->in_use, false);
+}
+
+ebr_t *ebr_create()
+{
+    ebr_t *ebr = malloc(sizeof(ebr_t));
+    assert(ebr != NULL);
+    atomic_init(&ebr->epoch, 0);
+    atomic_init(&ebr->records, NULL);
+    int status = pthread_key_create(&ebr->key, record_release);
+    assert(status == 0);
+    atomic_init(&ebr->threads, 0);
+    atomic_init(&ebr->retired, 0);
+    atomic_init(&ebr->freed, 0);
+    return ebr;
+}
+
+static ebr_record_t *record_of_thread(ebr_t *ebr)
+{
+    ebr_record_t *record = pthread_getspecific(ebr->key);
+    if (record != NULL)
+    {
+        return record;
+    }
+    // adopt the record of an exited thread, with whatever it left retired
+    for (record = atomic_load(&ebr->records); record != NULL; record = record->next)
+    {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&record->in_use, &expected, true))
+        {
+            pthread_setspecific(ebr->key, record);
+            return record;
+        }
+    }
+    record = malloc(sizeof(ebr_record_t));
+    assert(record != NULL);
+    atomic_init(&record->announce, 0);
+    atomic_init(&record->in_use, true);
+    for (size_t i = 0; i < 3; i++)
+    {
+        record->retired[i] = NULL;
+        record->retired_epoch[i] = 0;
+    }
+    record->pending = 0;
+    record->next = atomic_load(&ebr->records);
+    while (!atomic_compare_exchange_weak(&ebr->records, &record->next, record))
+    {
+    }
+    atomic_fetch_add(&ebr->threads, 1);
+    pthread_setspecific(ebr->key, record);
+    return record;
+}
+
+void ebr_enter(ebr_t *ebr)
+{
+    ebr_record_t *record = record_of_thread(ebr);
+    assert((atomic_load_explicit(&record->announce, memory_order_relaxed) & EBR_ACTIVE) == 0);
+    // seq_cst store then load: once announced, the epoch cannot move past the announced one + 1
+    uint64_t epoch = atomic_load(&ebr->epoch);
+    atomic_store(&record->announce, epoch << 1 | EBR_ACTIVE);
+}
+
+void ebr_exit(ebr_t *ebr)
+{
+    ebr_record_t *record = record_of_thread(ebr);
+    uint64_t announce = atomic_load_explicit(&record->announce, memory_order_relaxed);
+    assert(announce & EBR_ACTIVE);
+    atomic_store_explicit(&record->announce, announce & ~(uint64_t)EBR_ACTIVE, memory_order_release);
+}
+
+// Advances the epoch if every thread in a critical section has observed the current one
+static uint64_t try_advance(ebr_t *ebr)
+{
+    uint64_t epoch = atomic_load(&ebr->epoch);
+    for (ebr_record_t *record = atomic_load(&ebr->records); record != NULL; record = record->next)
+    {
+        uint64_t announce = atomic_load(&record->announce);
+        if ((announce & EBR_ACTIVE) && (announce >> 1) != epoch)
+        {
+            return epoch;
+        }
+    }
+    if (atomic_compare_exchange_strong(&ebr->epoch, &epoch, epoch + 1))
+    {
+        return epoch + 1;
+    }
+    return epoch;
+}
+
+static void free_list(ebr_t *ebr, ebr_record_t *record, size_t index)
+{
+    ebr_node_t *node = record->retired[index];
+    record->retired[index] = NULL;
+    size_t count = 0;
+    while (node != NULL)
+    {
+        ebr_node_t *next = node->next;
+        node->free_fn(node->ptr, node->ctx);
+        free(node);
+        node = next;
+        count++;
+    }
+    record->pending -= count;
+    atomic_fetch_add_explicit(&ebr->freed, count, memory_order_relaxed);
+}
+
+// Frees the lists of the record that were filled two or more epochs before epoch
+static void collect(ebr_t *ebr, ebr_record_t *record, uint64_t epoch)
+{
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (record->retired[i] != NULL && record->retired_epoch[i] + 2 <= epoch)
+        {
+            free_list(ebr, record, i);
+        }
+    }
+}
+
+void ebr_retire(ebr_t *ebr, void *ptr, void (*free_fn)(void *ptr, void *ctx), void *ctx)
+{
+    ebr_record_t *record = record_of_thread(ebr);
+    ebr_node_t *node = malloc(sizeof(ebr_node_t));
+    assert(node != NULL);
+    node->ptr = ptr;
+    node->free_fn = free_fn;
+    node->ctx = ctx;
+    // ptr is already unlinked, so only threads that entered by now can hold it
+    uint64_t epoch = atomic_load(&ebr->epoch);
+    size_t index = (size_t)(epoch % 3);
+    if (record->retired[index] != NULL && record->retired_epoch[index] != epoch)
+    {
+        // filled three or more epochs ago
+        free_list(ebr, record, index);
+    }
+    node->next = record->retired[index];
+    record->retired[index] = node;
+    record->retired_epoch[index] = epoch;
+    record->pending++;
+    atomic_fetch_add_explicit(&ebr->retired, 1, memory_order_relaxed);
+    if (record->pending % EBR_BATCH == 0)
+    {
+        collect(ebr, record, try_advance(ebr));
+    }
+}
+
+void ebr_synchronize(ebr_t *ebr)
+{
+    ebr_record_t *record = record_of_thread(ebr);
+    assert((atomic_load(&record->announce) & EBR_ACTIVE) == 0);
+    while (record->pending > 0)
+    {
+        collect(ebr, record, try_advance(ebr));
+        if (record->pending > 0)
+        {
+            sched_yield();
+        }
+    }
+}
+
+void ebr_stats(ebr_t *ebr, ebr_stats_t *stats)
+{
+    stats->epoch = atomic_load(&ebr->epoch);
+    stats->threads = atomic_load(&ebr->threads);
+    stats->retired = atomic_load(&ebr->retired);
+    stats->freed = atomic_load(&ebr->freed);
+}
+
+void ebr_destroy(ebr_t *ebr)
+{
+    pthread_key_delete(ebr->key);
+    ebr_record_t *record = atomic_load(&ebr->records);
+    while (record != NULL)
+    {
+        assert((atomic_load(&record->announce) & EBR_ACTIVE) == 0);
+        for (size_t i = 0; i < 3; i++)
+        {
+            free_list(ebr, record, i);
+        }
+        ebr_record_t *next = record->next;
+        free(record);
+        record = next;
+    }
+    assert(atomic_load(&ebr->retired) == atomic_load(&ebr->freed));
+    free(ebr);
+}
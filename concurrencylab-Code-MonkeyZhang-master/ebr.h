@@ -0,0 +1,47 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Epoch-based reclamation for lock-free structures built next to the channels: a node unlinked by one
+// thread may still be read by others, so instead of freeing it the thread retires it, and it is freed
+// once every thread that could have seen it has left its critical section.
+//
+// Readers bracket every access to shared nodes with ebr_enter/ebr_exit. A global epoch only advances
+// when every thread inside a critical section has observed the current one, so a node retired in epoch
+// e is unreachable to everyone once the epoch reaches e + 2. Each thread keeps its retired nodes in one
+// list per epoch and frees a whole list at a time, so the cost of a free is batched.
+typedef struct ebr ebr_t;
+
+typedef struct
+{
+    uint64_t epoch;  // current global epoch
+    size_t threads;  // per-thread records, including those of threads that exited
+    size_t retired;  // nodes retired so far
+    size_t freed;    // retired nodes freed so far
+} ebr_stats_t;
+
+// Creates a reclamation domain; structures sharing a domain share its epochs
+ebr_t *ebr_create();
+
+// Starts a critical section on the calling thread; sections do not nest
+void ebr_enter(ebr_t *ebr);
+
+// Ends the critical section; nodes read inside it must not be used afterwards
+void ebr_exit(ebr_t *ebr);
+
+// Hands ptr to the domain once it is unlinked; free_fn(ptr, ctx) is called when no thread can hold it
+// May be called inside or outside a critical section
+void ebr_retire(ebr_t *ebr, void *ptr, void (*free_fn)(void *ptr, void *ctx), void *ctx);
+
+// Waits until everything the calling thread retired is freed; must be called outside a critical section
+void ebr_synchronize(ebr_t *ebr);
+
+// Stores the counters of the domain
+void ebr_stats(ebr_t *ebr, ebr_stats_t *stats);
+
+// Frees every retired node and the domain; no thread may be inside a critical section or use it again
+void ebr_destroy(ebr_t *ebr);
+
+#endif // EBR_H
@@ -0,0 +1,199 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "floyd_warshall.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FW_X86 1
+#endif
+
+// 64 x 64 distances = 16 KiB per tile, so the three tiles of an update stay in L1/L2
+#define FW_BLOCK 64
+
+// c[j] = min(c[j], a + b[j]) for j < len; c and b may be the same row
+typedef void (*minplus_row_fn)(distance_t* c, const distance_t* b, distance_t a, size_t len);
+
+typedef struct {
+    distance_t* dist;
+    size_t n;
+    size_t num_blocks;
+    size_t num_threads;
+    minplus_row_fn minplus_row;
+    pthread_barrier_t barrier;
+} fw_shared_t;
+
+typedef struct {
+    fw_shared_t* shared;
+    size_t id;
+} fw_worker_t;
+
+void floyd_warshall_scalar(distance_t* dist, size_t n)
+{
+    for (size_t intermediate = 0; intermediate < n; intermediate++) {
+        for (size_t src = 0; src < n; src++) {
+            for (size_t dst = 0; dst < n; dst++) {
+                if (dist[src * n + intermediate] + dist[intermediate * n + dst] < dist[src * n + dst]) {
+                    dist[src * n + dst] = dist[src * n + intermediate] + dist[intermediate * n + dst];
+                }
+            }
+        }
+    }
+}
+
+static void minplus_row_scalar(distance_t* c, const distance_t* b, distance_t a, size_t len)
+{
+    for (size_t j = 0; j < len; j++) {
+        distance_t through = a + b[j];
+        if (through < c[j]) {
+            c[j] = through;
+        }
+    }
+}
+
+#ifdef FW_X86
+__attribute__((target("sse4.1")))
+static void minplus_row_sse41(distance_t* c, const distance_t* b, distance_t a, size_t len)
+{
+    __m128i va = _mm_set1_epi32((int)a);
+    size_t j = 0;
+    for (; j + 4 <= len; j += 4) {
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i vc = _mm_loadu_si128((const __m128i*)(c + j));
+        _mm_storeu_si128((__m128i*)(c + j), _mm_min_epu32(vc, _mm_add_epi32(va, vb)));
+    }
+    minplus_row_scalar(c + j, b + j, a, len - j);
+}
+
+__attribute__((target("avx2")))
+static void minplus_row_avx2(distance_t* c, const distance_t* b, distance_t a, size_t len)
+{
+    __m256i va = _mm256_set1_epi32((int)a);
+    size_t j = 0;
+    for (; j + 8 <= len; j += 8) {
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        __m256i vc = _mm256_loadu_si256((const __m256i*)(c + j));
+        _mm256_storeu_si256((__m256i*)(c + j), _mm256_min_epu32(vc, _mm256_add_epi32(va, vb)));
+    }
+    minplus_row_scalar(c + j, b + j, a, len - j);
+}
+#endif
+
+static minplus_row_fn pick_minplus_row()
+{
+#ifdef FW_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return minplus_row_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return minplus_row_sse41;
+    }
+#endif
+    return minplus_row_scalar;
+}
+
+static size_t block_len(size_t n, size_t block)
+{
+    size_t start = block * FW_BLOCK;
+    return (n - start < FW_BLOCK) ? n - start : FW_BLOCK;
+}
+
+// Relaxes tile (ib, jb) through the intermediates of tile kb
+// Row k of the tile-row kb and column k of the tile-column kb do not change during step k,
+// so updating in place is correct even when the tile is the diagonal or on its row/column
+static void relax_block(fw_shared_t* shared, size_t ib, size_t jb, size_t kb)
+{
+    distance_t* dist = shared->dist;
+    size_t n = shared->n;
+    size_t i0 = ib * FW_BLOCK, j0 = jb * FW_BLOCK, k0 = kb * FW_BLOCK;
+    size_t ilen = block_len(n, ib), jlen = block_len(n, jb), klen = block_len(n, kb);
+    for (size_t k = k0; k < k0 + klen; k++) {
+        const distance_t* row_k = &dist[k * n + j0];
+        for (size_t i = i0; i < i0 + ilen; i++) {
+            shared->minplus_row(&dist[i * n + j0], row_k, dist[i * n + k], jlen);
+        }
+    }
+}
+
+static void* fw_worker(void* arg)
+{
+    fw_worker_t* worker = arg;
+    fw_shared_t* shared = worker->shared;
+    size_t blocks = shared->num_blocks;
+    size_t threads = shared->num_threads;
+    for (size_t kb = 0; kb < blocks; kb++) {
+        // phase 1: the diagonal tile depends only on itself
+        if (worker->id == 0) {
+            relax_block(shared, kb, kb, kb);
+        }
+        pthread_barrier_wait(&shared->barrier);
+        // phase 2: row and column tiles of kb depend only on the diagonal tile
+        // task t < blocks is row tile (kb, t), task t >= blocks is column tile (t - blocks, kb)
+        for (size_t t = worker->id; t < 2 * blocks; t += threads) {
+            if (t < blocks) {
+                if (t != kb) {
+                    relax_block(shared, kb, t, kb);
+                }
+            } else if (t - blocks != kb) {
+                relax_block(shared, t - blocks, kb, kb);
+            }
+        }
+        pthread_barrier_wait(&shared->barrier);
+        // phase 3: every other tile depends only on its row and column tiles
+        // whole tile rows are handed out so a thread keeps reusing the same column tile
+        for (size_t ib = worker->id; ib < blocks; ib += threads) {
+            if (ib == kb) {
+                continue;
+            }
+            for (size_t jb = 0; jb < blocks; jb++) {
+                if (jb != kb) {
+                    relax_block(shared, ib, jb, kb);
+                }
+            }
+        }
+        pthread_barrier_wait(&shared->barrier);
+    }
+    return NULL;
+}
+
+void floyd_warshall_blocked(distance_t* dist, size_t n, size_t num_threads)
+{
+    if (n == 0) {
+        return;
+    }
+    fw_shared_t shared;
+    shared.dist = dist;
+    shared.n = n;
+    shared.num_blocks = (n + FW_BLOCK - 1) / FW_BLOCK;
+    shared.minplus_row = pick_minplus_row();
+    if (num_threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+    // more threads than tile rows would only wait at the barriers
+    if (num_threads > shared.num_blocks) {
+        num_threads = shared.num_blocks;
+    }
+    shared.num_threads = num_threads;
+    pthread_barrier_init(&shared.barrier, NULL, (unsigned)num_threads);
+
+    fw_worker_t* workers = malloc(sizeof(fw_worker_t) * num_threads);
+    pthread_t* pid = malloc(sizeof(pthread_t) * num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i].shared = &shared;
+        workers[i].id = i;
+    }
+    // the calling thread is worker 0
+    for (size_t i = 1; i < num_threads; i++) {
+        pthread_create(&pid[i], NULL, fw_worker, &workers[i]);
+    }
+    fw_worker(&workers[0]);
+    for (size_t i = 1; i < num_threads; i++) {
+        pthread_join(pid[i], NULL);
+    }
+    pthread_barrier_destroy(&shared.barrier);
+    free(pid);
+    free(workers);
+}
@@ -0,0 +1,20 @@
+#ifndef FLOYD_WARSHALL_H
+#define FLOYD_WARSHALL_H
+
+#include <stddef.h>
+
+// Distances are at most 0x7fffffff (unreachable), so the sum of two never overflows
+typedef unsigned int distance_t;
+
+// Computes all-pairs shortest paths in place over a dense n x n row-major matrix
+// Reference version: the plain triple loop, used to check the blocked version
+void floyd_warshall_scalar(distance_t* dist, size_t n);
+
+// Computes all-pairs shortest paths in place over a dense n x n row-major matrix
+// The matrix is processed in cache-sized tiles, one round per diagonal tile:
+// the diagonal tile first, then its row and column tiles, then all remaining tiles,
+// with the independent tiles of a phase spread over num_threads threads
+// (0 picks the number of online CPUs) and the inner min-plus loop vectorised with AVX2 or SSE4.1
+void floyd_warshall_blocked(distance_t* dist, size_t n, size_t num_threads);
+
+#endif // FLOYD_WARSHALL_H
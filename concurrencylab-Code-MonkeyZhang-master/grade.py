@@ -41,6 +41,9 @@ def add_test_case_sanitize(test_name, iters=0, timeout=0):
 def add_test_case_valgrind(test_name, iters=0, timeout=0):
     test_cases[f"valgrind_{test_name}"] = {"args": ["valgrind", "-v", "--leak-check=full", "--errors-for-leak-kinds=all", "--error-exitcode=2", "./channel", test_name, str(iters_valgrind if iters == 0 else iters)], "timeout": timeout_valgrind if timeout == 0 else timeout}
 
+def add_test_case_cpp(test_name, iters=0, timeout=0):
+    test_cases[f"cpp_{test_name}"] = {"args": ["./channel_cpp", test_name, str(iters_channel if iters == 0 else iters)], "timeout": timeout_channel if timeout == 0 else timeout}
+
 def add_test_cases(test_name, iters=0, timeout=0):
     add_test_case_channel(test_name, iters, timeout)
     add_test_case_sanitize(test_name, iters, timeout)
@@ -81,6 +84,38 @@ add_test_cases("test_select_response_time", iters_one, timeout_response_time)
 add_test_cases("test_cpu_utilization_select", iters_one, timeout_cpu_utilization)
 add_test_cases("test_cpu_utilization_overall", iters_one, timeout_cpu_utilization)
 add_test_cases("test_for_too_many_wakeups", iters_one, timeout_too_many_wakeups)
+add_test_cases("test_floyd_warshall_blocked", iters_one)
+add_test_cases("test_graph_dijkstra", iters_one)
+add_test_case_channel("test_stress_sparse", iters_one, timeout_channel * 5)
+add_test_case_sanitize("test_stress_sparse", iters_one, timeout_sanitize * 5)
+add_test_case_valgrind("test_stress_sparse", iters_one, timeout_valgrind * 5)
+add_test_cases("test_graph_read_formats", iters_one)
+add_test_case_channel("test_stress_delta", iters_one, timeout_channel * 5)
+add_test_case_sanitize("test_stress_delta", iters_one, timeout_sanitize * 5)
+add_test_case_valgrind("test_stress_delta", iters_one, timeout_valgrind * 5)
+add_test_cases("test_channel_watch", iters_one)
+add_test_cases("test_stress_reactor", iters_one)
+add_test_cases("test_histogram", iters_one)
+add_test_cases("test_open_loop", iters_one)
+add_test_cases("test_msg_pool")
+add_test_cases("test_placement", iters_one)
+add_test_cases("test_perf_counters", iters_one)
+add_test_cases("test_spill_channel", iters_one)
+add_test_cases("test_select_policy", iters_one)
+add_test_cases("test_allocator", iters_one)
+add_test_cases("test_ebr", iters_one)
+add_test_cases("test_lf_queue", iters_one)
+add_test_cases("test_consumer_pool", iters_one)
+add_test_cases("test_trace_replay", iters_one)
+add_test_cases("test_ws_deque", iters_one)
+add_test_cases("test_ws_deque_last_element", iters_one)
+add_test_cases("test_task_pool", iters_one)
+add_test_case_cpp("test_cpp_buffered", iters_one)
+add_test_case_cpp("test_cpp_move_only", iters_one)
+add_test_case_cpp("test_cpp_rendezvous", iters_one)
+add_test_case_cpp("test_cpp_select", iters_one)
+add_test_case_cpp("test_cpp_coro", iters_one)
+add_test_case_cpp("test_cpp_stress_coro", iters_one)
 #add_test_case_channel("test_unbuffered", iters_slow)
 #add_test_case_sanitize("test_unbuffered", iters_slow)
 #add_test_case_valgrind("test_unbuffered", iters_slow, timeout_valgrind * 5)
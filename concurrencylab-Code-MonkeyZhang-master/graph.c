@@ -0,0 +1,619 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graph.h"
+
+static const distance_t inf_distance = 0x7fffffff;
+
+// Growable list of edges used while reading or generating a graph
+typedef struct {
+    edge_t* edges;
+    size_t count;
+    size_t capacity;
+} edge_list_t;
+
+typedef struct {
+    size_t dst;
+    distance_t weight;
+} adjacency_t;
+
+typedef struct {
+    distance_t dist;
+    size_t node;
+} heap_entry_t;
+
+static void edge_list_add(edge_list_t* list, size_t src, size_t dst, distance_t weight)
+{
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->edges = realloc(list->edges, sizeof(edge_t) * list->capacity);
+    }
+    list->edges[list->count].src = src;
+    list->edges[list->count].dst = dst;
+    list->edges[list->count].weight = weight;
+    list->count++;
+}
+
+// Adds both directions of an undirected edge
+static void edge_list_add_undirected(edge_list_t* list, size_t u, size_t v, distance_t weight)
+{
+    edge_list_add(list, u, v, weight);
+    edge_list_add(list, v, u, weight);
+}
+
+static graph_t* edge_list_to_graph(edge_list_t* list, size_t num_nodes)
+{
+    graph_t* graph = graph_create(num_nodes, list->edges, list->count);
+    free(list->edges);
+    return graph;
+}
+
+static int compare_adjacency(const void* a, const void* b)
+{
+    const adjacency_t* x = a;
+    const adjacency_t* y = b;
+    if (x->dst != y->dst) {
+        return x->dst < y->dst ? -1 : 1;
+    }
+    return (x->weight > y->weight) - (x->weight < y->weight);
+}
+
+graph_t* graph_create(size_t num_nodes, edge_t* edges, size_t num_edges)
+{
+    graph_t* graph = malloc(sizeof(graph_t));
+    graph->num_nodes = num_nodes;
+    graph->row_start = calloc(num_nodes + 1, sizeof(size_t));
+
+    // counting sort of the edges by source
+    for (size_t e = 0; e < num_edges; e++) {
+        if (edges[e].src != edges[e].dst && edges[e].weight < inf_distance) {
+            graph->row_start[edges[e].src + 1]++;
+        }
+    }
+    for (size_t u = 0; u < num_nodes; u++) {
+        graph->row_start[u + 1] += graph->row_start[u];
+    }
+    size_t total = graph->row_start[num_nodes];
+    adjacency_t* adjacency = malloc(sizeof(adjacency_t) * (total > 0 ? total : 1));
+    size_t* fill = malloc(sizeof(size_t) * (num_nodes > 0 ? num_nodes : 1));
+    memcpy(fill, graph->row_start, sizeof(size_t) * num_nodes);
+    for (size_t e = 0; e < num_edges; e++) {
+        if (edges[e].src != edges[e].dst && edges[e].weight < inf_distance) {
+            adjacency_t* slot = &adjacency[fill[edges[e].src]++];
+            slot->dst = edges[e].dst;
+            slot->weight = edges[e].weight;
+        }
+    }
+    free(fill);
+
+    // sort every row by destination and keep only the lightest of duplicate edges
+    graph->dst = malloc(sizeof(size_t) * (total > 0 ? total : 1));
+    graph->weight = malloc(sizeof(distance_t) * (total > 0 ? total : 1));
+    size_t kept = 0;
+    size_t row_begin = 0;
+    for (size_t u = 0; u < num_nodes; u++) {
+        size_t row_end = graph->row_start[u + 1];
+        qsort(&adjacency[row_begin], row_end - row_begin, sizeof(adjacency_t), compare_adjacency);
+        graph->row_start[u] = kept;
+        for (size_t e = row_begin; e < row_end; e++) {
+            if (e > row_begin && adjacency[e].dst == adjacency[e - 1].dst) {
+                continue;
+            }
+            graph->dst[kept] = adjacency[e].dst;
+            graph->weight[kept] = adjacency[e].weight;
+            kept++;
+        }
+        row_begin = row_end;
+    }
+    graph->row_start[num_nodes] = kept;
+    graph->num_edges = kept;
+    free(adjacency);
+    return graph;
+}
+
+void graph_free(graph_t* graph)
+{
+    if (graph == NULL) {
+        return;
+    }
+    free(graph->row_start);
+    free(graph->dst);
+    free(graph->weight);
+    free(graph);
+}
+
+distance_t graph_link_distance(const graph_t* graph, size_t src, size_t dst)
+{
+    if (src == dst) {
+        return 0;
+    }
+    size_t low = graph->row_start[src];
+    size_t high = graph->row_start[src + 1];
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (graph->dst[mid] < dst) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < graph->row_start[src + 1] && graph->dst[low] == dst) {
+        return graph->weight[low];
+    }
+    return inf_distance;
+}
+
+static void heap_push(heap_entry_t* heap, size_t* size, distance_t dist, size_t node)
+{
+    size_t i = (*size)++;
+    while (i > 0 && heap[(i - 1) / 2].dist > dist) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].dist = dist;
+    heap[i].node = node;
+}
+
+static heap_entry_t heap_pop(heap_entry_t* heap, size_t* size)
+{
+    heap_entry_t top = heap[0];
+    heap_entry_t last = heap[--(*size)];
+    size_t i = 0;
+    while (2 * i + 1 < *size) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < *size && heap[child + 1].dist < heap[child].dist) {
+            child++;
+        }
+        if (heap[child].dist >= last.dist) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+void graph_dijkstra(const graph_t* graph, size_t src, distance_t* dist)
+{
+    for (size_t u = 0; u < graph->num_nodes; u++) {
+        dist[u] = inf_distance;
+    }
+    // lazy deletion: a node is pushed once per improvement, so at most num_edges + 1 entries
+    heap_entry_t* heap = malloc(sizeof(heap_entry_t) * (graph->num_edges + 1));
+    size_t size = 0;
+    dist[src] = 0;
+    heap_push(heap, &size, 0, src);
+    while (size > 0) {
+        heap_entry_t top = heap_pop(heap, &size);
+        if (top.dist > dist[top.node]) {
+            continue;
+        }
+        for (size_t e = graph->row_start[top.node]; e < graph->row_start[top.node + 1]; e++) {
+            distance_t through = top.dist + graph->weight[e];
+            if (through < dist[graph->dst[e]]) {
+                dist[graph->dst[e]] = through;
+                heap_push(heap, &size, through, graph->dst[e]);
+            }
+        }
+    }
+    free(heap);
+}
+
+void graph_to_dense(const graph_t* graph, distance_t* dense)
+{
+    size_t n = graph->num_nodes;
+    for (size_t i = 0; i < n * n; i++) {
+        dense[i] = inf_distance;
+    }
+    for (size_t u = 0; u < n; u++) {
+        dense[u * n + u] = 0;
+        for (size_t e = graph->row_start[u]; e < graph->row_start[u + 1]; e++) {
+            dense[u * n + graph->dst[e]] = graph->weight[e];
+        }
+    }
+}
+
+// Cursor over the mapped bytes of a text topology file
+typedef struct {
+    const char* pos;
+    const char* end;
+} text_cursor_t;
+
+static void skip_space(text_cursor_t* cursor)
+{
+    while (cursor->pos < cursor->end && (*cursor->pos == ' ' || *cursor->pos == '\n' || *cursor->pos == '\t' || *cursor->pos == '\r')) {
+        cursor->pos++;
+    }
+}
+
+// Parses an optionally negative decimal integer; returns false if there is none
+static bool parse_long(text_cursor_t* cursor, long* value)
+{
+    skip_space(cursor);
+    bool negative = false;
+    if (cursor->pos < cursor->end && (*cursor->pos == '-' || *cursor->pos == '+')) {
+        negative = *cursor->pos == '-';
+        cursor->pos++;
+    }
+    if (cursor->pos == cursor->end || *cursor->pos < '0' || *cursor->pos > '9') {
+        return false;
+    }
+    long result = 0;
+    while (cursor->pos < cursor->end && *cursor->pos >= '0' && *cursor->pos <= '9') {
+        result = result * 10 + (*cursor->pos - '0');
+        cursor->pos++;
+    }
+    *value = negative ? -result : result;
+    return true;
+}
+
+static bool parse_size(text_cursor_t* cursor, size_t* value)
+{
+    long result;
+    if (!parse_long(cursor, &result) || result < 0) {
+        return false;
+    }
+    *value = (size_t)result;
+    return true;
+}
+
+// Empty graph whose rows are appended in order with graph_append_edge
+static graph_t* graph_alloc(size_t num_nodes, size_t capacity)
+{
+    graph_t* graph = malloc(sizeof(graph_t));
+    graph->num_nodes = num_nodes;
+    graph->num_edges = 0;
+    graph->row_start = calloc(num_nodes + 1, sizeof(size_t));
+    graph->dst = malloc(sizeof(size_t) * (capacity > 0 ? capacity : 1));
+    graph->weight = malloc(sizeof(distance_t) * (capacity > 0 ? capacity : 1));
+    return graph;
+}
+
+static void graph_append_edge(graph_t* graph, size_t* capacity, size_t dst, distance_t weight)
+{
+    if (graph->num_edges == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 1024;
+        graph->dst = realloc(graph->dst, sizeof(size_t) * *capacity);
+        graph->weight = realloc(graph->weight, sizeof(distance_t) * *capacity);
+    }
+    graph->dst[graph->num_edges] = dst;
+    graph->weight[graph->num_edges] = weight;
+    graph->num_edges++;
+}
+
+static graph_t* read_edge_list(text_cursor_t* cursor)
+{
+    size_t num_nodes, num_edges;
+    if (!parse_size(cursor, &num_nodes) || !parse_size(cursor, &num_edges)) {
+        return NULL;
+    }
+    edge_list_t list = {NULL, 0, 0};
+    for (size_t e = 0; e < num_edges; e++) {
+        size_t u, v;
+        long weight;
+        if (!parse_size(cursor, &u) || !parse_size(cursor, &v) || !parse_long(cursor, &weight) || u >= num_nodes || v >= num_nodes) {
+            free(list.edges);
+            return NULL;
+        }
+        // negative weights mean no link, as in the dense format
+        if (weight >= 0) {
+            edge_list_add_undirected(&list, u, v, (distance_t)weight);
+        }
+    }
+    return edge_list_to_graph(&list, num_nodes);
+}
+
+// Rows of a dense matrix are already sorted by destination, so the CSR arrays are filled directly
+static graph_t* read_dense(text_cursor_t* cursor, size_t num_nodes)
+{
+    size_t capacity = 0;
+    graph_t* graph = graph_alloc(num_nodes, capacity);
+    for (size_t src = 0; src < num_nodes; src++) {
+        graph->row_start[src] = graph->num_edges;
+        for (size_t dst = 0; dst < num_nodes; dst++) {
+            long distance;
+            if (!parse_long(cursor, &distance)) {
+                graph_free(graph);
+                return NULL;
+            }
+            if (distance >= 0 && distance < inf_distance && src != dst) {
+                graph_append_edge(graph, &capacity, dst, (distance_t)distance);
+            }
+        }
+    }
+    graph->row_start[num_nodes] = graph->num_edges;
+    return graph;
+}
+
+static graph_t* read_text(const char* data, size_t length)
+{
+    text_cursor_t cursor = {data, data + length};
+    skip_space(&cursor);
+    static const char edges_token[] = "edges";
+    size_t token_length = sizeof(edges_token) - 1;
+    if ((size_t)(cursor.end - cursor.pos) >= token_length && memcmp(cursor.pos, edges_token, token_length) == 0) {
+        cursor.pos += token_length;
+        return read_edge_list(&cursor);
+    }
+    size_t num_nodes;
+    if (!parse_size(&cursor, &num_nodes) || num_nodes == 0) {
+        return NULL;
+    }
+    return read_dense(&cursor, num_nodes);
+}
+
+static graph_t* read_binary_edges(const graph_binary_header_t* header, const unsigned char* body, size_t body_length)
+{
+    size_t num_nodes = (size_t)header->num_nodes;
+    size_t num_edges = (size_t)header->num_entries;
+    if (body_length / sizeof(graph_binary_edge_t) < num_edges) {
+        return NULL;
+    }
+    const graph_binary_edge_t* records = (const graph_binary_edge_t*)body;
+    // graph_write_binary emits edges sorted by (src, dst) without duplicates;
+    // such a file is copied straight into the CSR arrays, anything else goes through graph_create
+    bool ordered = true;
+    for (size_t e = 0; e < num_edges && ordered; e++) {
+        ordered = records[e].src < num_nodes && records[e].dst < num_nodes && records[e].src != records[e].dst &&
+                  records[e].weight < inf_distance;
+        if (ordered && e > 0) {
+            ordered = records[e - 1].src < records[e].src ||
+                      (records[e - 1].src == records[e].src && records[e - 1].dst < records[e].dst);
+        }
+    }
+    if (ordered) {
+        graph_t* graph = graph_alloc(num_nodes, num_edges);
+        for (size_t e = 0; e < num_edges; e++) {
+            graph->row_start[records[e].src + 1]++;
+            graph->dst[e] = records[e].dst;
+            graph->weight[e] = records[e].weight;
+        }
+        for (size_t u = 0; u < num_nodes; u++) {
+            graph->row_start[u + 1] += graph->row_start[u];
+        }
+        graph->num_edges = num_edges;
+        return graph;
+    }
+    edge_t* edges = malloc(sizeof(edge_t) * (num_edges > 0 ? num_edges : 1));
+    for (size_t e = 0; e < num_edges; e++) {
+        if (records[e].src >= num_nodes || records[e].dst >= num_nodes) {
+            free(edges);
+            return NULL;
+        }
+        edges[e].src = records[e].src;
+        edges[e].dst = records[e].dst;
+        edges[e].weight = records[e].weight;
+    }
+    graph_t* graph = graph_create(num_nodes, edges, num_edges);
+    free(edges);
+    return graph;
+}
+
+static graph_t* read_binary_dense(const graph_binary_header_t* header, const unsigned char* body, size_t body_length)
+{
+    size_t num_nodes = (size_t)header->num_nodes;
+    if (header->num_entries != header->num_nodes * header->num_nodes || body_length / sizeof(int32_t) < num_nodes * num_nodes) {
+        return NULL;
+    }
+    const int32_t* cells = (const int32_t*)body;
+    size_t capacity = 0;
+    graph_t* graph = graph_alloc(num_nodes, capacity);
+    for (size_t src = 0; src < num_nodes; src++) {
+        graph->row_start[src] = graph->num_edges;
+        const int32_t* row = &cells[src * num_nodes];
+        for (size_t dst = 0; dst < num_nodes; dst++) {
+            if (row[dst] >= 0 && src != dst) {
+                graph_append_edge(graph, &capacity, dst, (distance_t)row[dst]);
+            }
+        }
+    }
+    graph->row_start[num_nodes] = graph->num_edges;
+    return graph;
+}
+
+static graph_t* read_binary(const unsigned char* data, size_t length)
+{
+    graph_binary_header_t header;
+    memcpy(&header, data, sizeof(header));
+    const unsigned char* body = data + sizeof(header);
+    size_t body_length = length - sizeof(header);
+    if (header.version != GRAPH_BINARY_VERSION || header.num_nodes == 0 || header.num_nodes > UINT32_MAX) {
+        return NULL;
+    }
+    if (header.kind == GRAPH_BINARY_EDGES) {
+        return read_binary_edges(&header, body, body_length);
+    }
+    if (header.kind == GRAPH_BINARY_DENSE) {
+        return read_binary_dense(&header, body, body_length);
+    }
+    return NULL;
+}
+
+graph_t* graph_read(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)info.st_size;
+    // the whole file is mapped and parsed in place instead of going through stdio one number at a time
+    void* data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+    graph_t* graph;
+    if (length >= sizeof(graph_binary_header_t) && memcmp(data, GRAPH_BINARY_MAGIC, sizeof(GRAPH_BINARY_MAGIC)) == 0) {
+        graph = read_binary(data, length);
+    } else {
+        graph = read_text(data, length);
+    }
+    munmap(data, length);
+    return graph;
+}
+
+bool graph_write_edges(const graph_t* graph, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+    size_t pairs = 0;
+    for (size_t u = 0; u < graph->num_nodes; u++) {
+        for (size_t e = graph->row_start[u]; e < graph->row_start[u + 1]; e++) {
+            if (u < graph->dst[e]) {
+                pairs++;
+            }
+        }
+    }
+    fprintf(file, "edges %zu %zu\n", graph->num_nodes, pairs);
+    for (size_t u = 0; u < graph->num_nodes; u++) {
+        for (size_t e = graph->row_start[u]; e < graph->row_start[u + 1]; e++) {
+            if (u < graph->dst[e]) {
+                fprintf(file, "%zu %zu %u\n", u, graph->dst[e], graph->weight[e]);
+            }
+        }
+    }
+    return fclose(file) == 0;
+}
+
+bool graph_write_binary(const graph_t* graph, const char* filename)
+{
+    if (graph->num_nodes > UINT32_MAX) {
+        return false;
+    }
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t n = graph->num_nodes;
+    graph_binary_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_BINARY_MAGIC, sizeof(GRAPH_BINARY_MAGIC));
+    header.version = GRAPH_BINARY_VERSION;
+    header.num_nodes = n;
+    // a dense cell takes 4 bytes and an edge record 12, so dense wins above a third of all pairs
+    bool dense = 3 * graph->num_edges >= n * n;
+    header.kind = dense ? GRAPH_BINARY_DENSE : GRAPH_BINARY_EDGES;
+    header.num_entries = dense ? n * n : graph->num_edges;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (dense) {
+        int32_t* row = malloc(sizeof(int32_t) * n);
+        for (size_t u = 0; u < n && ok; u++) {
+            for (size_t v = 0; v < n; v++) {
+                row[v] = u == v ? 0 : -1;
+            }
+            for (size_t e = graph->row_start[u]; e < graph->row_start[u + 1]; e++) {
+                row[graph->dst[e]] = (int32_t)graph->weight[e];
+            }
+            ok = fwrite(row, sizeof(int32_t), n, file) == n;
+        }
+        free(row);
+    } else {
+        for (size_t u = 0; u < n && ok; u++) {
+            for (size_t e = graph->row_start[u]; e < graph->row_start[u + 1] && ok; e++) {
+                graph_binary_edge_t record = {(uint32_t)u, (uint32_t)graph->dst[e], graph->weight[e]};
+                ok = fwrite(&record, sizeof(record), 1, file) == 1;
+            }
+        }
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+static distance_t random_weight(distance_t max_weight, unsigned int* seed)
+{
+    return 1 + (distance_t)rand_r(seed) % max_weight;
+}
+
+static size_t random_node(size_t num_nodes, unsigned int* seed)
+{
+    // two draws so that more than RAND_MAX nodes can be reached
+    size_t r = ((size_t)rand_r(seed) << 31) ^ (size_t)rand_r(seed);
+    return r % num_nodes;
+}
+
+graph_t* graph_generate_random(size_t num_nodes, size_t avg_degree, distance_t max_weight, unsigned int seed)
+{
+    edge_list_t list = {NULL, 0, 0};
+    // random spanning tree keeps the graph connected
+    for (size_t u = 1; u < num_nodes; u++) {
+        edge_list_add_undirected(&list, u, random_node(u, &seed), random_weight(max_weight, &seed));
+    }
+    size_t target = num_nodes * avg_degree / 2;
+    for (size_t e = num_nodes - 1; e < target; e++) {
+        size_t u = random_node(num_nodes, &seed);
+        size_t v = random_node(num_nodes, &seed);
+        edge_list_add_undirected(&list, u, v, random_weight(max_weight, &seed));
+    }
+    return edge_list_to_graph(&list, num_nodes);
+}
+
+graph_t* graph_generate_grid(size_t rows, size_t cols, distance_t max_weight, unsigned int seed)
+{
+    edge_list_t list = {NULL, 0, 0};
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            size_t u = r * cols + c;
+            if (c + 1 < cols) {
+                edge_list_add_undirected(&list, u, u + 1, random_weight(max_weight, &seed));
+            }
+            if (r + 1 < rows) {
+                edge_list_add_undirected(&list, u, u + cols, random_weight(max_weight, &seed));
+            }
+        }
+    }
+    return edge_list_to_graph(&list, rows * cols);
+}
+
+graph_t* graph_generate_power_law(size_t num_nodes, size_t edges_per_node, distance_t max_weight, unsigned int seed)
+{
+    edge_list_t list = {NULL, 0, 0};
+    if (edges_per_node == 0) {
+        edges_per_node = 1;
+    }
+    // every edge endpoint is recorded once, so a uniform pick from endpoints is proportional to degree
+    size_t* endpoints = malloc(sizeof(size_t) * (2 * num_nodes * edges_per_node + 2));
+    size_t num_endpoints = 0;
+    size_t* targets = malloc(sizeof(size_t) * edges_per_node);
+    size_t seed_nodes = edges_per_node + 1 < num_nodes ? edges_per_node + 1 : num_nodes;
+    // small clique to attach to
+    for (size_t u = 0; u < seed_nodes; u++) {
+        for (size_t v = u + 1; v < seed_nodes; v++) {
+            edge_list_add_undirected(&list, u, v, random_weight(max_weight, &seed));
+            endpoints[num_endpoints++] = u;
+            endpoints[num_endpoints++] = v;
+        }
+    }
+    for (size_t u = seed_nodes; u < num_nodes; u++) {
+        size_t num_targets = 0;
+        for (size_t attempt = 0; num_targets < edges_per_node && attempt < 8 * edges_per_node; attempt++) {
+            size_t v = endpoints[random_node(num_endpoints, &seed)];
+            bool duplicate = false;
+            for (size_t t = 0; t < num_targets; t++) {
+                duplicate = duplicate || targets[t] == v;
+            }
+            if (!duplicate) {
+                targets[num_targets++] = v;
+            }
+        }
+        for (size_t t = 0; t < num_targets; t++) {
+            edge_list_add_undirected(&list, u, targets[t], random_weight(max_weight, &seed));
+            endpoints[num_endpoints++] = u;
+            endpoints[num_endpoints++] = targets[t];
+        }
+    }
+    free(targets);
+    free(endpoints);
+    return edge_list_to_graph(&list, num_nodes);
+}
@@ -0,0 +1,90 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "floyd_warshall.h"
+
+// Sparse directed graph in compressed sparse row (CSR) form
+// The out-edges of node u are dst[row_start[u]] .. dst[row_start[u + 1] - 1], sorted by dst,
+// with matching weights; self loops are not stored (a node is at distance 0 from itself)
+typedef struct {
+    size_t num_nodes;
+    size_t num_edges;
+    size_t* row_start;
+    size_t* dst;
+    distance_t* weight;
+} graph_t;
+
+typedef struct {
+    size_t src;
+    size_t dst;
+    distance_t weight;
+} edge_t;
+
+// Binary topology file, in host byte order: a header followed by either
+//   GRAPH_BINARY_EDGES: num_entries directed edge records, or
+//   GRAPH_BINARY_DENSE: num_nodes x num_nodes int32 distances (negative means no link)
+#define GRAPH_BINARY_MAGIC "CLTOPO\x01"
+#define GRAPH_BINARY_VERSION 1
+#define GRAPH_BINARY_EDGES 0
+#define GRAPH_BINARY_DENSE 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t num_nodes;
+    uint64_t num_entries;
+} graph_binary_header_t;
+
+typedef struct {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t weight;
+} graph_binary_edge_t;
+
+// Builds a graph from a list of directed edges
+// Self loops and edges of weight >= 0x7fffffff are dropped; of duplicate edges the lightest is kept
+graph_t* graph_create(size_t num_nodes, edge_t* edges, size_t num_edges);
+
+// Frees the memory allocated to the graph
+void graph_free(graph_t* graph);
+
+// Returns the weight of the edge src -> dst, 0 if src == dst, and 0x7fffffff if there is none
+// O(log degree) binary search in the row of src
+distance_t graph_link_distance(const graph_t* graph, size_t src, size_t dst);
+
+// Stores the shortest distance from src to every node in dist (num_nodes entries)
+void graph_dijkstra(const graph_t* graph, size_t src, distance_t* dist);
+
+// Expands the graph to a dense num_nodes x num_nodes row-major matrix
+void graph_to_dense(const graph_t* graph, distance_t* dense);
+
+// Loads a topology file, either
+//   a dense matrix: "N" followed by N x N distances (negative means no link),
+//   an edge list:   "edges N M" followed by M lines "u v weight" of undirected edges, or
+//   a binary file written by graph_write_binary (recognised by its magic)
+// The file is mapped into memory and parsed in place
+// Returns NULL if the file could not be read
+graph_t* graph_read(const char* filename);
+
+// Writes the graph as an edge list; each undirected pair is written once
+// Returns false if the file could not be written
+bool graph_write_edges(const graph_t* graph, const char* filename);
+
+// Writes the graph as a binary topology file, dense if that is the smaller encoding
+// Every directed edge is written, so directed graphs survive the round trip
+// Returns false if the file could not be written
+bool graph_write_binary(const graph_t* graph, const char* filename);
+
+// Generators of connected undirected graphs with weights in 1..max_weight
+// random:    a random spanning tree plus random extra edges up to avg_degree edges per node
+// grid:      rows x cols lattice, each node linked to its 4 neighbours
+// power law: Barabasi-Albert preferential attachment, each new node links to edges_per_node nodes
+graph_t* graph_generate_random(size_t num_nodes, size_t avg_degree, distance_t max_weight, unsigned int seed);
+graph_t* graph_generate_grid(size_t rows, size_t cols, distance_t max_weight, unsigned int seed);
+graph_t* graph_generate_power_law(size_t num_nodes, size_t edges_per_node, distance_t max_weight, unsigned int seed);
+
+#endif // GRAPH_H
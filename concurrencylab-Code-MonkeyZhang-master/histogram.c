@@ -0,0 +1,93 @@
+#include <string.h>
+#include "histogram.h"
+
+#define HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+
+// Values below HISTOGRAM_SUB_BUCKETS map to themselves; a larger value whose highest set bit is msb
+// is shifted right by msb - (HISTOGRAM_SUB_BUCKET_BITS - 1), leaving a sub-bucket in
+// [HALF_SUB_BUCKETS, HISTOGRAM_SUB_BUCKETS) of bucket number shift
+static size_t counts_index(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (size_t)value;
+    }
+    unsigned int msb = 63 - (unsigned int)__builtin_clzll(value);
+    unsigned int shift = msb - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    size_t sub_bucket = (size_t)(value >> shift);
+    return HISTOGRAM_SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS + (sub_bucket - HALF_SUB_BUCKETS);
+}
+
+// Largest value that maps to index
+static uint64_t highest_equivalent(size_t index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    size_t shift = (index - HISTOGRAM_SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+    uint64_t sub_bucket = (index - HISTOGRAM_SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    return (sub_bucket << shift) + ((UINT64_C(1) << shift) - 1);
+}
+
+void histogram_init(histogram_t* histogram)
+{
+    memset(histogram, 0, sizeof(histogram_t));
+    histogram->min = UINT64_MAX;
+}
+
+void histogram_record(histogram_t* histogram, uint64_t value)
+{
+    histogram->counts[counts_index(value)]++;
+    histogram->count++;
+    histogram->sum += (double)value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void histogram_merge(histogram_t* dst, const histogram_t* src)
+{
+    for (size_t i = 0; i < HISTOGRAM_COUNTS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+uint64_t histogram_percentile(const histogram_t* histogram, double percentile)
+{
+    if (histogram->count == 0) {
+        return 0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    // rank of the value asked for, counting from 1
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_COUNTS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t value = highest_equivalent(i);
+            // the top of the sub-bucket may lie above anything actually recorded
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double histogram_mean(const histogram_t* histogram)
+{
+    return histogram->count ? histogram->sum / (double)histogram->count : 0.0;
+}
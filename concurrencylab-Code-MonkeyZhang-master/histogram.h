@@ -0,0 +1,39 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Latency histogram with HDR-style log-linear buckets
+// Values below HISTOGRAM_SUB_BUCKETS are counted exactly; above that every power of two is split into
+// HISTOGRAM_SUB_BUCKETS / 2 linear sub-buckets, so a value is kept to within 1 / 64 of itself
+// over the whole uint64_t range, in a fixed 30 KiB of counters
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_COUNTS (HISTOGRAM_SUB_BUCKETS + (64 - HISTOGRAM_SUB_BUCKET_BITS) * (HISTOGRAM_SUB_BUCKETS / 2))
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t counts[HISTOGRAM_COUNTS];
+} histogram_t;
+
+// Empties the histogram
+void histogram_init(histogram_t* histogram);
+
+// Counts one occurrence of value
+void histogram_record(histogram_t* histogram, uint64_t value);
+
+// Adds every value recorded in src to dst
+void histogram_merge(histogram_t* dst, const histogram_t* src);
+
+// Returns the smallest value that at least percentile (0..100) percent of the recorded values
+// are at or below, rounded up to the top of its sub-bucket; 0 if nothing was recorded
+uint64_t histogram_percentile(const histogram_t* histogram, double percentile);
+
+// Returns the mean of the recorded values, 0 if nothing was recorded
+double histogram_mean(const histogram_t* histogram);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,151 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include "lf_queue.h"
+
+#define LF_QUEUE_SEGMENT 64
+#define CACHE_LINE 64
+
+// Marks a slot whose dequeuer arrived before its enqueuer; the enqueuer then takes another slot
+static char taken_marker;
+#define TAKEN ((void *)&taken_marker)
+
+typedef struct lf_segment
+{
+    atomic_size_t enqueue_index;
+    atomic_size_t dequeue_index;
+    _Atomic(struct lf_segment *) next;
+    _Atomic(void *) slots[LF_QUEUE_SEGMENT];
+} lf_segment_t;
+
+struct lf_queue
+{
+    _Alignas(CACHE_LINE) _Atomic(lf_segment_t *) head;
+    _Alignas(CACHE_LINE) _Atomic(lf_segment_t *) tail;
+    ebr_t *ebr;
+};
+
+// Creates a segment holding data in its first slot, or no message if data is NULL
+static lf_segment_t *segment_create(void *data)
+{
+    lf_segment_t *segment = malloc(sizeof(lf_segment_t));
+    assert(segment != NULL);
+    atomic_init(&segment->enqueue_index, data != NULL ? 1 : 0);
+    atomic_init(&segment->dequeue_index, 0);
+    atomic_init(&segment->next, NULL);
+    for (size_t i = 0; i < LF_QUEUE_SEGMENT; i++)
+    {
+        atomic_init(&segment->slots[i], i == 0 ? data : NULL);
+    }
+    return segment;
+}
+
+static void segment_free(void *segment, void *ctx)
+{
+    free(segment);
+}
+
+lf_queue_t *lf_queue_create(ebr_t *ebr)
+{
+    lf_queue_t *queue = aligned_alloc(CACHE_LINE, sizeof(lf_queue_t));
+    assert(queue != NULL);
+    lf_segment_t *segment = segment_create(NULL);
+    atomic_init(&queue->head, segment);
+    atomic_init(&queue->tail, segment);
+    queue->ebr = ebr;
+    return queue;
+}
+
+void lf_queue_enqueue(lf_queue_t *queue, void *data)
+{
+    assert(data != NULL && data != TAKEN);
+    ebr_enter(queue->ebr);
+    while (true)
+    {
+        lf_segment_t *tail = atomic_load(&queue->tail);
+        size_t index = atomic_fetch_add(&tail->enqueue_index, 1);
+        if (index < LF_QUEUE_SEGMENT)
+        {
+            void *expected = NULL;
+            if (atomic_compare_exchange_strong(&tail->slots[index], &expected, data))
+            {
+                break;
+            }
+            // a dequeuer gave up on this slot
+            continue;
+        }
+        // the segment is full: link a new one holding data, or help whoever did
+        if (tail != atomic_load(&queue->tail))
+        {
+            continue;
+        }
+        lf_segment_t *next = atomic_load(&tail->next);
+        if (next == NULL)
+        {
+            lf_segment_t *segment = segment_create(data);
+            if (atomic_compare_exchange_strong(&tail->next, &next, segment))
+            {
+                atomic_compare_exchange_strong(&queue->tail, &tail, segment);
+                break;
+            }
+            free(segment);
+        }
+        else
+        {
+            atomic_compare_exchange_strong(&queue->tail, &tail, next);
+        }
+    }
+    ebr_exit(queue->ebr);
+}
+
+enum channel_status lf_queue_dequeue(lf_queue_t *queue, void **data)
+{
+    enum channel_status status = CHANNEL_EMPTY;
+    ebr_enter(queue->ebr);
+    while (true)
+    {
+        lf_segment_t *head = atomic_load(&queue->head);
+        if (atomic_load(&head->dequeue_index) >= atomic_load(&head->enqueue_index) && atomic_load(&head->next) == NULL)
+        {
+            break;
+        }
+        size_t index = atomic_fetch_add(&head->dequeue_index, 1);
+        if (index < LF_QUEUE_SEGMENT)
+        {
+            void *message = atomic_exchange(&head->slots[index], TAKEN);
+            if (message == NULL)
+            {
+                // its enqueuer has not written yet and will use another slot
+                continue;
+            }
+            *data = message;
+            status = SUCCESS;
+            break;
+        }
+        // the segment is drained: unlink it once the tail has moved past it
+        lf_segment_t *next = atomic_load(&head->next);
+        if (next == NULL)
+        {
+            break;
+        }
+        lf_segment_t *tail = head;
+        atomic_compare_exchange_strong(&queue->tail, &tail, next);
+        if (atomic_compare_exchange_strong(&queue->head, &head, next))
+        {
+            ebr_retire(queue->ebr, head, segment_free, NULL);
+        }
+    }
+    ebr_exit(queue->ebr);
+    return status;
+}
+
+void lf_queue_destroy(lf_queue_t *queue)
+{
+    lf_segment_t *segment = atomic_load(&queue->head);
+    while (segment != NULL)
+    {
+        lf_segment_t *next = atomic_load(&segment->next);
+        free(segment);
+        segment = next;
+    }
+    free(queue);
+}
@@ -0,0 +1,27 @@
+#ifndef LF_QUEUE_H
+#define LF_QUEUE_H
+
+#include "channel.h"
+#include "ebr.h"
+
+// Unbounded lock-free MPMC queue of non-NULL pointers, for readiness queues and other channel
+// internals that should not take a mutex. Messages are stored in fixed-size ring segments linked
+// into a list: enqueuers and dequeuers claim slots with a fetch-and-add on the segment's indices,
+// a full segment gets a successor, and a drained one is unlinked and retired to the queue's
+// reclamation domain, since other threads may still be reading it.
+typedef struct lf_queue lf_queue_t;
+
+// Creates an empty queue whose old segments are reclaimed through ebr
+lf_queue_t *lf_queue_create(ebr_t *ebr);
+
+// Appends data, which must not be NULL; never blocks
+void lf_queue_enqueue(lf_queue_t *queue, void *data);
+
+// Removes the oldest message and stores it in data
+// Returns SUCCESS, or CHANNEL_EMPTY if the queue is empty
+enum channel_status lf_queue_dequeue(lf_queue_t *queue, void **data);
+
+// Frees the queue and the messages' slots; no thread may use it anymore
+void lf_queue_destroy(lf_queue_t *queue);
+
+#endif // LF_QUEUE_H
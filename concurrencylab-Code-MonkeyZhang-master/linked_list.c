@@ -5,7 +5,15 @@
 list_t *list_create()
 {
     /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    list_t *list = malloc(sizeof(list_t));
+    return list_create_with_allocator(NULL);
+}
+
+// Creates and returns a new list whose nodes are allocated with allocator (the default allocator if NULL)
+list_t *list_create_with_allocator(const allocator_t *allocator)
+{
+    allocator_t resolved = allocator_or_default(allocator);
+    list_t *list = allocator_alloc(&resolved, sizeof(list_t));
+    list->allocator = resolved;
     list->head = NULL;
     list->tail = NULL;
     list->count = 0;
@@ -22,7 +30,8 @@ void list_destroy(list_t *list)
         list_remove(list, list->head);
     }
 
-    free(list);
+    allocator_t allocator = list->allocator;
+    allocator_free(&allocator, list, sizeof(list_t));
 }
 
 // Returns head of the list
@@ -103,7 +112,7 @@ list_node_t *list_find(list_t *list, void *data)
 list_node_t *list_insert(list_t *list, void *data)
 {
     /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    list_node_t *new_node = malloc(sizeof(list_node_t));
+    list_node_t *new_node = allocator_alloc(&list->allocator, sizeof(list_node_t));
     new_node->data = data;
     new_node->next = NULL;
 
@@ -142,7 +151,7 @@ void list_remove(list_t *list, list_node_t *node)
         list->head = NULL;
         list->tail = NULL;
         list->count--;
-        free(node);
+        allocator_free(&list->allocator, node, sizeof(list_node_t));
     }
 
     // if node is in middle of list
@@ -151,7 +160,7 @@ void list_remove(list_t *list, list_node_t *node)
         node->prev->next = node->next;
         node->next->prev = node->prev;
         list->count--;
-        free(node);
+        allocator_free(&list->allocator, node, sizeof(list_node_t));
     }
     // if node is head
     else if (node->next != NULL && node->prev == NULL)
@@ -159,7 +168,7 @@ void list_remove(list_t *list, list_node_t *node)
         node->next->prev = NULL;
         list->head = node->next;
         list->count--;
-        free(node);
+        allocator_free(&list->allocator, node, sizeof(list_node_t));
     }
     // if node is tail
     else if (node->next == NULL && node->prev != NULL)
@@ -167,6 +176,6 @@ void list_remove(list_t *list, list_node_t *node)
         node->prev->next = NULL;
         list->tail = node->prev;
         list->count--;
-        free(node);
+        allocator_free(&list->allocator, node, sizeof(list_node_t));
     }
 }
@@ -2,6 +2,7 @@
 #define LINKED_LIST_H
 
 #include <stddef.h>
+#include "allocator.h"
 
 typedef struct list_node {
     struct list_node* next; // next node in list
@@ -13,11 +14,15 @@ typedef struct {
     list_node_t* head; // head of the list
     list_node_t* tail; // tail of the list
     size_t count; // count of nodes in the list
+    allocator_t allocator; // allocates the list and its nodes
 } list_t;
 
 // Creates and returns a new list
 list_t* list_create();
 
+// Creates and returns a new list whose nodes are allocated with allocator (the default allocator if NULL)
+list_t* list_create_with_allocator(const allocator_t* allocator);
+
 // Destroys a list
 void list_destroy(list_t* list);
 
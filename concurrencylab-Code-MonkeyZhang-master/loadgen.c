@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "open_loop.h"
+
+// Sweeps offered load over each consumer engine and buffer capacity of the channel,
+// printing the latency distribution at every load and the knee where the channel saturates
+#define START_RATE 1000.0
+#define MAX_RATE 4096000.0
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [constant|poisson] [SECONDS_PER_LOAD]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    open_loop_config_t config;
+    config.arrival = OPEN_LOOP_POISSON;
+    config.duration = 0.5;
+    config.seed = 1;
+    if (argc > 1) {
+        if (strcmp(argv[1], "constant") == 0) {
+            config.arrival = OPEN_LOOP_CONSTANT;
+        } else if (strcmp(argv[1], "poisson") != 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc > 2) {
+        config.duration = strtod(argv[2], NULL);
+    }
+    if (argc > 3 || config.duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const enum open_loop_engine engines[] = {OPEN_LOOP_RECEIVE, OPEN_LOOP_SELECT};
+    const char* engine_names[] = {"receive", "select"};
+    const size_t capacities[] = {1, 16, 256};
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+            config.engine = engines[e];
+            config.capacity = capacities[c];
+            printf("engine %s, capacity %zu\n", engine_names[e], capacities[c]);
+            double knee = open_loop_find_knee(&config, START_RATE, MAX_RATE, stdout);
+            printf("knee: %.0f msgs/s\n\n", knee);
+        }
+    }
+    return 0;
+}
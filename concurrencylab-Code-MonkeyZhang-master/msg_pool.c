@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "msg_pool.h"
+
+typedef struct msg_cache msg_cache_t;
+
+typedef struct msg_header
+{
+    struct msg_header *next; // link in a free list of the owner
+    msg_cache_t *owner;
+    atomic_size_t refs;
+    max_align_t payload[];
+} msg_header_t;
+
+// One per thread that allocated from the pool
+struct msg_cache
+{
+    msg_header_t *free_list;         // only touched by the owning thread
+    _Atomic(msg_header_t *) returned; // pushed to by other threads, drained whole by the owner
+    size_t created;                  // objects malloc'd for this cache, checked at destroy
+    msg_cache_t *next;               // link in the pool's list of caches
+};
+
+struct msg_pool
+{
+    size_t object_size;
+    pthread_key_t key; // the calling thread's cache
+    pthread_mutex_t mutex;
+    msg_cache_t *caches;
+};
+
+static msg_header_t *header_of(void *message)
+{
+    return (msg_header_t *)((char *)message - offsetof(msg_header_t, payload));
+}
+
+msg_pool_t *msg_pool_create(size_t object_size)
+{
+    msg_pool_t *pool = malloc(sizeof(msg_pool_t));
+    assert(pool != NULL);
+    pool->object_size = object_size;
+    int status = pthread_key_create(&pool->key, NULL);
+    assert(status == 0);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->caches = NULL;
+    return pool;
+}
+
+// Caches outlive their threads: messages a thread sent may still be released after it exits
+static msg_cache_t *cache_of_thread(msg_pool_t *pool)
+{
+    msg_cache_t *cache = pthread_getspecific(pool->key);
+    if (cache == NULL)
+    {
+        cache = malloc(sizeof(msg_cache_t));
+        assert(cache != NULL);
+        cache->free_list = NULL;
+        atomic_init(&cache->returned, NULL);
+        cache->created = 0;
+        pthread_mutex_lock(&pool->mutex);
+        cache->next = pool->caches;
+        pool->caches = cache;
+        pthread_mutex_unlock(&pool->mutex);
+        pthread_setspecific(pool->key, cache);
+    }
+    return cache;
+}
+
+void *msg_alloc(msg_pool_t *pool)
+{
+    msg_cache_t *cache = cache_of_thread(pool);
+    if (cache->free_list == NULL)
+    {
+        // take everything other threads gave back in one exchange, so there is no ABA problem
+        cache->free_list = atomic_exchange(&cache->returned, NULL);
+    }
+    msg_header_t *header = cache->free_list;
+    if (header != NULL)
+    {
+        cache->free_list = header->next;
+    }
+    else
+    {
+        header = malloc(sizeof(msg_header_t) + pool->object_size);
+        assert(header != NULL);
+        header->owner = cache;
+        cache->created++;
+    }
+    atomic_store_explicit(&header->refs, 1, memory_order_relaxed);
+    return header->payload;
+}
+
+void msg_retain(void *message, size_t count)
+{
+    atomic_fetch_add_explicit(&header_of(message)->refs, count, memory_order_relaxed);
+}
+
+void msg_release(void *message)
+{
+    msg_header_t *header = header_of(message);
+    if (atomic_fetch_sub(&header->refs, 1) != 1)
+    {
+        return;
+    }
+    msg_cache_t *cache = header->owner;
+    header->next = atomic_load(&cache->returned);
+    while (!atomic_compare_exchange_weak(&cache->returned, &header->next, header))
+    {
+    }
+}
+
+void msg_pool_destroy(msg_pool_t *pool)
+{
+    msg_cache_t *cache = pool->caches;
+    while (cache != NULL)
+    {
+        size_t freed = 0;
+        msg_header_t *lists[] = {cache->free_list, atomic_exchange(&cache->returned, NULL)};
+        for (size_t i = 0; i < 2; i++)
+        {
+            while (lists[i] != NULL)
+            {
+                msg_header_t *next = lists[i]->next;
+                free(lists[i]);
+                lists[i] = next;
+                freed++;
+            }
+        }
+        // a message still referenced would be leaked here, or freed under its user
+        assert(freed == cache->created);
+        msg_cache_t *next = cache->next;
+        free(cache);
+        cache = next;
+    }
+    pthread_key_delete(pool->key);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
@@ -0,0 +1,29 @@
+#ifndef MSG_POOL_H
+#define MSG_POOL_H
+
+#include <stddef.h>
+
+// Pools of fixed-size message objects for channel payloads that do not fit in a pointer
+// Each thread allocates from its own cache of the pool; a message released by another thread
+// goes back to the cache it came from through a lock-free list that only the owner drains,
+// so producers and consumers on different threads never free into each other's heap
+typedef struct msg_pool msg_pool_t;
+
+// Creates a pool of objects of object_size bytes, aligned like malloc's
+msg_pool_t *msg_pool_create(size_t object_size);
+
+// Returns an object from the calling thread's cache, holding a single reference
+void *msg_alloc(msg_pool_t *pool);
+
+// Adds count references to message, e.g. one per receiver of a broadcast
+void msg_retain(void *message, size_t count);
+
+// Drops one reference to message; the last one returns it to the cache it was allocated from
+// Safe to call from any thread
+void msg_release(void *message);
+
+// Frees the pool and every object in it
+// Every message must have been released and no thread may use the pool anymore
+void msg_pool_destroy(msg_pool_t *pool);
+
+#endif // MSG_POOL_H
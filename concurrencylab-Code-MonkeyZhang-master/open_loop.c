@@ -0,0 +1,152 @@
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "channel.h"
+#include "open_loop.h"
+
+typedef struct {
+    channel_t* channel;
+    const open_loop_config_t* config;
+    uint64_t* intended; // intended send time of every message, in ns
+    size_t num_messages;
+    open_loop_result_t* result;
+    uint64_t last_receive;
+} open_loop_run_t;
+
+static uint64_t now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline)
+{
+    struct timespec until;
+    until.tv_sec = (time_t)(deadline / 1000000000);
+    until.tv_nsec = (long)(deadline % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0) {
+    }
+}
+
+static void* producer(void* arg)
+{
+    open_loop_run_t* run = arg;
+    for (size_t i = 0; i < run->num_messages; i++) {
+        // behind schedule means send right away: the lateness is charged to the message, not dropped
+        if (now_ns() < run->intended[i]) {
+            sleep_until(run->intended[i]);
+        }
+        // the message is its index + 1, so that it is never NULL
+        enum channel_status status = channel_send(run->channel, (void*)(uintptr_t)(i + 1));
+        assert(status == SUCCESS);
+    }
+    return NULL;
+}
+
+static void* consumer(void* arg)
+{
+    open_loop_run_t* run = arg;
+    select_t select_list[1];
+    select_list[0].channel = run->channel;
+    select_list[0].dir = RECV;
+    for (size_t i = 0; i < run->num_messages; i++) {
+        void* data = NULL;
+        enum channel_status status;
+        if (run->config->engine == OPEN_LOOP_SELECT) {
+            size_t selected_index;
+            status = channel_select(select_list, 1, &selected_index);
+            data = select_list[0].data;
+        } else {
+            status = channel_receive(run->channel, &data);
+        }
+        assert(status == SUCCESS);
+        uint64_t now = now_ns();
+        uint64_t intended = run->intended[(uintptr_t)data - 1];
+        histogram_record(&run->result->latency, now > intended ? now - intended : 0);
+        run->last_receive = now;
+    }
+    return NULL;
+}
+
+void open_loop_run(const open_loop_config_t* config, open_loop_result_t* result)
+{
+    open_loop_run_t run;
+    run.config = config;
+    run.result = result;
+    run.num_messages = (size_t)(config->rate * config->duration);
+    if (run.num_messages == 0) {
+        run.num_messages = 1;
+    }
+    histogram_init(&result->latency);
+    result->offered_rate = config->rate;
+
+    // the whole schedule is fixed before the first send, starting a little in the future
+    run.intended = malloc(sizeof(uint64_t) * run.num_messages);
+    assert(run.intended != NULL);
+    unsigned int seed = config->seed;
+    double mean_gap = 1e9 / config->rate;
+    double at = (double)now_ns() + 1e6;
+    for (size_t i = 0; i < run.num_messages; i++) {
+        run.intended[i] = (uint64_t)at;
+        if (config->arrival == OPEN_LOOP_POISSON) {
+            // (0, 1] so the logarithm is finite
+            double uniform = ((double)rand_r(&seed) + 1.0) / ((double)RAND_MAX + 1.0);
+            at += -log(uniform) * mean_gap;
+        } else {
+            at += mean_gap;
+        }
+    }
+
+    run.channel = channel_create(config->capacity);
+    assert(run.channel != NULL);
+    pthread_t producer_thread, consumer_thread;
+    pthread_create(&consumer_thread, NULL, consumer, &run);
+    pthread_create(&producer_thread, NULL, producer, &run);
+    pthread_join(producer_thread, NULL);
+    pthread_join(consumer_thread, NULL);
+    channel_close(run.channel);
+    channel_destroy(run.channel);
+
+    // throughput is judged against the schedule actually offered, since Poisson gaps only average out to the rate
+    double elapsed = (double)(run.last_receive - run.intended[0]);
+    double scheduled = (double)(run.intended[run.num_messages - 1] - run.intended[0]);
+    result->achieved_rate = (scheduled > 0 && elapsed > 0) ? config->rate * scheduled / elapsed : config->rate;
+    free(run.intended);
+}
+
+double open_loop_find_knee(const open_loop_config_t* config, double start_rate, double max_rate, FILE* out)
+{
+    open_loop_config_t step = *config;
+    open_loop_result_t* result = malloc(sizeof(open_loop_result_t));
+    assert(result != NULL);
+    double knee = 0;
+    uint64_t baseline_p50 = UINT64_MAX;
+    if (out != NULL) {
+        fprintf(out, "%12s %12s %10s %10s %10s %10s\n", "offered/s", "achieved/s", "p50 us", "p99 us", "p99.9 us", "max us");
+    }
+    for (double rate = start_rate; rate <= max_rate; rate *= 2) {
+        step.rate = rate;
+        open_loop_run(&step, result);
+        uint64_t p50 = histogram_percentile(&result->latency, 50.0);
+        uint64_t p99 = histogram_percentile(&result->latency, 99.0);
+        if (out != NULL) {
+            fprintf(out, "%12.0f %12.0f %10.1f %10.1f %10.1f %10.1f\n", rate, result->achieved_rate,
+                    (double)p50 / 1e3, (double)p99 / 1e3,
+                    (double)histogram_percentile(&result->latency, 99.9) / 1e3, (double)result->latency.max / 1e3);
+        }
+        // the median rather than the tail, so one descheduled consumer does not look like saturation
+        if (p50 > 0 && p50 < baseline_p50) {
+            baseline_p50 = p50;
+        }
+        if (result->achieved_rate < 0.95 * rate || (baseline_p50 != UINT64_MAX && p50 > 10 * baseline_p50)) {
+            break;
+        }
+        knee = rate;
+    }
+    free(result);
+    return knee;
+}
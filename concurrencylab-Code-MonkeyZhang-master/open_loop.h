@@ -0,0 +1,48 @@
+#ifndef OPEN_LOOP_H
+#define OPEN_LOOP_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "histogram.h"
+
+// Open-loop load generation: a producer sends on a fixed schedule whether or not earlier sends
+// have completed, and a consumer records each message's latency from its intended send time.
+// A send that is held up (full buffer, slow consumer) therefore shows up as latency of every
+// message scheduled behind it instead of silently lowering the offered load (coordinated omission).
+
+enum open_loop_arrival {
+    OPEN_LOOP_CONSTANT, // evenly spaced sends
+    OPEN_LOOP_POISSON,  // exponentially distributed gaps with the same mean
+};
+
+// How the consumer takes messages off the channel
+enum open_loop_engine {
+    OPEN_LOOP_RECEIVE, // channel_receive
+    OPEN_LOOP_SELECT,  // channel_select over the data channel
+};
+
+typedef struct {
+    size_t capacity; // buffer size of the channel under test
+    enum open_loop_engine engine;
+    enum open_loop_arrival arrival;
+    double rate;     // offered load in messages per second
+    double duration; // seconds of load
+    unsigned int seed;
+} open_loop_config_t;
+
+typedef struct {
+    double offered_rate;
+    double achieved_rate; // messages received per second of the run
+    histogram_t latency;  // nanoseconds from intended send time to receipt
+} open_loop_result_t;
+
+// Runs one producer and one consumer at the configured load
+void open_loop_run(const open_loop_config_t* config, open_loop_result_t* result);
+
+// Doubles the offered load from start_rate up to max_rate until the channel saturates, printing a row per
+// load to out (if not NULL); saturation is throughput below 95% of the offered load or a median latency
+// above 10 times the lowest median seen at a lighter load
+// Returns the highest load that did not saturate (the knee), 0 if even start_rate did
+double open_loop_find_knee(const open_loop_config_t* config, double start_rate, double max_rate, FILE* out);
+
+#endif // OPEN_LOOP_H
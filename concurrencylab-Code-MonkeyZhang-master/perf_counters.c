@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+static const char* counter_names[] = {"cycles", "instructions", "cache-misses", "context-switches", "futex"};
+
+struct perf_phase {
+    size_t num_threads;
+    int (*fds)[PERF_COUNTERS]; // counters of every thread, -1 where one could not be opened
+};
+
+// Returns the id of the futex syscall tracepoint, or -1 without tracefs
+static long futex_tracepoint_id()
+{
+    const char* paths[] = {"/sys/kernel/tracing/events/syscalls/sys_enter_futex/id",
+                           "/sys/kernel/debug/tracing/events/syscalls/sys_enter_futex/id"};
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        FILE* file = fopen(paths[i], "r");
+        if (file != NULL) {
+            long id = -1;
+            if (fscanf(file, "%ld", &id) != 1) {
+                id = -1;
+            }
+            fclose(file);
+            return id;
+        }
+    }
+    return -1;
+}
+
+static int open_counter(pid_t tid, uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+    if (fd < 0) {
+        // unprivileged users may only count their own user-space events
+        attr.exclude_kernel = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+    }
+    return fd;
+}
+
+perf_phase_t* perf_phase_start()
+{
+    perf_phase_t* phase = malloc(sizeof(perf_phase_t));
+    assert(phase != NULL);
+    phase->num_threads = 0;
+    phase->fds = NULL;
+    long futex_id = futex_tracepoint_id();
+    DIR* tasks = opendir("/proc/self/task");
+    if (tasks == NULL) {
+        return phase;
+    }
+    size_t capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(tasks)) != NULL) {
+        pid_t tid = (pid_t)strtol(entry->d_name, NULL, 10);
+        if (tid <= 0) {
+            continue;
+        }
+        if (phase->num_threads == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            phase->fds = realloc(phase->fds, sizeof(phase->fds[0]) * capacity);
+            assert(phase->fds != NULL);
+        }
+        int* fds = phase->fds[phase->num_threads++];
+        fds[PERF_CYCLES] = open_counter(tid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[PERF_INSTRUCTIONS] = open_counter(tid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[PERF_CACHE_MISSES] = open_counter(tid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds[PERF_CONTEXT_SWITCHES] = open_counter(tid, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+        fds[PERF_FUTEX_CALLS] = futex_id < 0 ? -1 : open_counter(tid, PERF_TYPE_TRACEPOINT, (uint64_t)futex_id);
+    }
+    closedir(tasks);
+    return phase;
+}
+
+void perf_phase_stop(perf_phase_t* phase, perf_sample_t* sample)
+{
+    memset(sample, 0, sizeof(perf_sample_t));
+    sample->threads = phase->num_threads;
+    for (size_t c = 0; c < PERF_COUNTERS; c++) {
+        sample->available[c] = phase->num_threads > 0;
+    }
+    for (size_t t = 0; t < phase->num_threads; t++) {
+        for (size_t c = 0; c < PERF_COUNTERS; c++) {
+            int fd = phase->fds[t][c];
+            uint64_t value = 0;
+            // a thread that exited during the phase still reads its final count
+            if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+                sample->available[c] = false;
+            }
+            sample->value[c] += value;
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    free(phase->fds);
+    free(phase);
+}
+
+void perf_sample_print(FILE* out, const char* name, const perf_sample_t* sample)
+{
+    fprintf(out, "%s: %zu threads", name, sample->threads);
+    for (size_t c = 0; c < PERF_COUNTERS; c++) {
+        if (sample->available[c]) {
+            fprintf(out, ", %s %llu", counter_names[c], (unsigned long long)sample->value[c]);
+        } else {
+            fprintf(out, ", %s n/a", counter_names[c]);
+        }
+    }
+    if (sample->available[PERF_CYCLES] && sample->available[PERF_INSTRUCTIONS] && sample->value[PERF_CYCLES] > 0) {
+        fprintf(out, ", IPC %.2f", (double)sample->value[PERF_INSTRUCTIONS] / (double)sample->value[PERF_CYCLES]);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,38 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Counts hardware and kernel events over a phase of a test with perf_event_open, summed over
+// every thread of the process, so a CPU-time figure can be split into spinning, cache misses
+// and trips through the kernel
+enum perf_counter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_FUTEX_CALLS, // futex syscalls, from the syscalls:sys_enter_futex tracepoint
+    PERF_COUNTERS,
+};
+
+typedef struct {
+    // a counter the kernel, the hardware or the permissions do not provide is not available
+    bool available[PERF_COUNTERS];
+    uint64_t value[PERF_COUNTERS];
+    size_t threads; // threads that were running when the phase started
+} perf_sample_t;
+
+typedef struct perf_phase perf_phase_t;
+
+// Starts counting on every thread of the process; threads they create are counted too
+perf_phase_t* perf_phase_start();
+
+// Stops counting, stores the totals of the phase in sample and frees the phase
+void perf_phase_stop(perf_phase_t* phase, perf_sample_t* sample);
+
+// Prints the available counters of sample on one line, prefixed with name
+void perf_sample_print(FILE* out, const char* name, const perf_sample_t* sample);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,230 @@
+#define _GNU_SOURCE // CPU_SET and sched_setaffinity
+#include <assert.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "placement.h"
+
+static const char* policy_names[] = {"none", "compact", "scatter", "ring"};
+
+// Reads a single integer from a sysfs file; returns fallback if it is missing
+static int read_sys_int(int cpu, const char* name, int fallback)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return fallback;
+    }
+    int value;
+    if (fscanf(file, "%d", &value) != 1) {
+        value = fallback;
+    }
+    fclose(file);
+    return value;
+}
+
+cpu_topology_t* cpu_topology_read()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return NULL;
+    }
+    cpu_topology_t* topology = malloc(sizeof(cpu_topology_t));
+    assert(topology != NULL);
+    topology->num_cpus = 0;
+    topology->cpus = malloc(sizeof(cpu_info_t) * (size_t)CPU_COUNT(&allowed));
+    assert(topology->cpus != NULL);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET((size_t)cpu, &allowed)) {
+            cpu_info_t* info = &topology->cpus[topology->num_cpus++];
+            info->cpu = cpu;
+            // without topology information every CPU counts as a core of its own
+            info->package = read_sys_int(cpu, "physical_package_id", 0);
+            info->core = read_sys_int(cpu, "core_id", cpu);
+        }
+    }
+    return topology;
+}
+
+void cpu_topology_free(cpu_topology_t* topology)
+{
+    if (topology != NULL) {
+        free(topology->cpus);
+        free(topology);
+    }
+}
+
+enum cpu_distance cpu_distance(const cpu_info_t* a, const cpu_info_t* b)
+{
+    if (a->cpu == b->cpu) {
+        return CPU_SAME;
+    }
+    if (a->package != b->package) {
+        return CPU_OTHER_PACKAGE;
+    }
+    return a->core == b->core ? CPU_SMT_SIBLING : CPU_SAME_PACKAGE;
+}
+
+bool placement_parse(const char* name, enum placement_policy* policy)
+{
+    for (size_t i = 0; i < sizeof(policy_names) / sizeof(policy_names[0]); i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            *policy = (enum placement_policy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* placement_name(enum placement_policy policy)
+{
+    return policy_names[policy];
+}
+
+// A CPU with its position in the machine: the rank of its core within the package,
+// and its rank among the SMT siblings of that core
+typedef struct {
+    cpu_info_t info;
+    size_t core_rank;
+    size_t smt_rank;
+} ranked_cpu_t;
+
+static int compare_compact(const void* a, const void* b)
+{
+    const cpu_info_t* x = &((const ranked_cpu_t*)a)->info;
+    const cpu_info_t* y = &((const ranked_cpu_t*)b)->info;
+    if (x->package != y->package) {
+        return x->package < y->package ? -1 : 1;
+    }
+    if (x->core != y->core) {
+        return x->core < y->core ? -1 : 1;
+    }
+    return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+static int compare_scatter(const void* a, const void* b)
+{
+    const ranked_cpu_t* x = a;
+    const ranked_cpu_t* y = b;
+    if (x->smt_rank != y->smt_rank) {
+        return x->smt_rank < y->smt_rank ? -1 : 1;
+    }
+    if (x->core_rank != y->core_rank) {
+        return x->core_rank < y->core_rank ? -1 : 1;
+    }
+    return compare_compact(a, b);
+}
+
+placement_t* placement_create(const cpu_topology_t* topology, enum placement_policy policy, size_t num_threads)
+{
+    placement_t* placement = malloc(sizeof(placement_t));
+    assert(placement != NULL);
+    placement->policy = policy;
+    placement->num_threads = num_threads;
+    placement->cpu_of = NULL;
+    if (policy == PLACEMENT_NONE || topology == NULL || topology->num_cpus == 0 || num_threads == 0) {
+        placement->policy = PLACEMENT_NONE;
+        return placement;
+    }
+
+    size_t num_cpus = topology->num_cpus;
+    ranked_cpu_t* order = malloc(sizeof(ranked_cpu_t) * num_cpus);
+    assert(order != NULL);
+    for (size_t i = 0; i < num_cpus; i++) {
+        order[i].info = topology->cpus[i];
+    }
+    // in compact order the ranks are running counts, restarting with every core and package
+    qsort(order, num_cpus, sizeof(ranked_cpu_t), compare_compact);
+    for (size_t i = 0; i < num_cpus; i++) {
+        if (i == 0 || order[i].info.package != order[i - 1].info.package) {
+            order[i].core_rank = 0;
+            order[i].smt_rank = 0;
+        } else if (order[i].info.core != order[i - 1].info.core) {
+            order[i].core_rank = order[i - 1].core_rank + 1;
+            order[i].smt_rank = 0;
+        } else {
+            order[i].core_rank = order[i - 1].core_rank;
+            order[i].smt_rank = order[i - 1].smt_rank + 1;
+        }
+    }
+    if (policy == PLACEMENT_SCATTER) {
+        qsort(order, num_cpus, sizeof(ranked_cpu_t), compare_scatter);
+    }
+
+    placement->cpu_of = malloc(sizeof(cpu_info_t) * num_threads);
+    assert(placement->cpu_of != NULL);
+    for (size_t i = 0; i < num_threads; i++) {
+        // with more threads than CPUs, compact and scatter wrap around while ring keeps neighbours together
+        size_t slot = policy == PLACEMENT_RING ? i * num_cpus / num_threads : i % num_cpus;
+        placement->cpu_of[i] = order[slot].info;
+    }
+    free(order);
+    return placement;
+}
+
+placement_t* placement_from_env(size_t num_threads)
+{
+    const char* env = getenv("CHANNEL_PLACEMENT");
+    if (env == NULL) {
+        return NULL;
+    }
+    enum placement_policy policy;
+    if (!placement_parse(env, &policy)) {
+        fprintf(stderr, "Unknown CHANNEL_PLACEMENT %s, expected none, compact, scatter or ring\n", env);
+        policy = PLACEMENT_NONE;
+    }
+    cpu_topology_t* topology = cpu_topology_read();
+    placement_t* placement = placement_create(topology, policy, num_threads);
+    cpu_topology_free(topology);
+    return placement;
+}
+
+void placement_free(placement_t* placement)
+{
+    if (placement != NULL) {
+        free(placement->cpu_of);
+        free(placement);
+    }
+}
+
+void placement_pin(const placement_t* placement, size_t thread)
+{
+    if (placement == NULL || placement->cpu_of == NULL) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((size_t)placement->cpu_of[thread].cpu, &set);
+    int status = sched_setaffinity(0, sizeof(set), &set);
+    assert(status == 0);
+}
+
+enum cpu_distance placement_distance(const placement_t* placement, size_t a, size_t b)
+{
+    if (placement == NULL || placement->cpu_of == NULL) {
+        return CPU_DISTANCES;
+    }
+    return cpu_distance(&placement->cpu_of[a], &placement->cpu_of[b]);
+}
+
+void placement_print(FILE* out, const placement_t* placement, const size_t* pair_counts)
+{
+    if (placement == NULL) {
+        return;
+    }
+    fprintf(out, "placement %s", placement_name(placement->policy));
+    if (placement->cpu_of != NULL) {
+        fprintf(out, ", cpus");
+        for (size_t i = 0; i < placement->num_threads; i++) {
+            fprintf(out, "%s%d", i == 0 ? " " : ",", placement->cpu_of[i].cpu);
+        }
+        if (pair_counts != NULL) {
+            fprintf(out, ", neighbours on same cpu %zu, smt sibling %zu, same package %zu, other package %zu",
+                    pair_counts[CPU_SAME], pair_counts[CPU_SMT_SIBLING], pair_counts[CPU_SAME_PACKAGE],
+                    pair_counts[CPU_OTHER_PACKAGE]);
+        }
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,80 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Pins the threads of the stress harnesses to CPUs, so that results do not depend on where the
+// scheduler happened to put communicating threads and the effect of core distance can be measured
+
+typedef struct {
+    int cpu;
+    int package; // physical_package_id
+    int core;    // core_id, only unique within a package
+} cpu_info_t;
+
+typedef struct {
+    size_t num_cpus;
+    cpu_info_t* cpus;
+} cpu_topology_t;
+
+enum placement_policy {
+    PLACEMENT_NONE,    // leave placement to the scheduler
+    PLACEMENT_COMPACT, // thread i on the i-th CPU counting SMT siblings, then cores, then packages
+    PLACEMENT_SCATTER, // thread i on the i-th CPU counting packages, then cores, then SMT siblings
+    PLACEMENT_RING,    // consecutive threads in contiguous blocks of the compact order, so ring neighbours share or adjoin a core
+};
+
+// How far apart two CPUs are
+enum cpu_distance {
+    CPU_SAME,
+    CPU_SMT_SIBLING,
+    CPU_SAME_PACKAGE,
+    CPU_OTHER_PACKAGE,
+    CPU_DISTANCES,
+};
+
+typedef struct {
+    enum placement_policy policy;
+    size_t num_threads;
+    cpu_info_t* cpu_of; // CPU of every thread, NULL for PLACEMENT_NONE
+} placement_t;
+
+// Reads the package and core of every CPU the calling thread may run on from /sys
+// Returns NULL if the affinity mask cannot be read
+cpu_topology_t* cpu_topology_read();
+
+// Frees the memory allocated to the topology
+void cpu_topology_free(cpu_topology_t* topology);
+
+// Returns the distance between two CPUs
+enum cpu_distance cpu_distance(const cpu_info_t* a, const cpu_info_t* b);
+
+// Parses a policy name (none, compact, scatter, ring); returns false if it is unknown
+bool placement_parse(const char* name, enum placement_policy* policy);
+
+// Returns the name of the policy
+const char* placement_name(enum placement_policy policy);
+
+// Assigns num_threads threads to the CPUs of topology according to policy
+placement_t* placement_create(const cpu_topology_t* topology, enum placement_policy policy, size_t num_threads);
+
+// Creates the placement named by the CHANNEL_PLACEMENT environment variable for the CPUs of this process
+// Returns NULL if the variable is not set; an unknown name is reported and treated as none
+placement_t* placement_from_env(size_t num_threads);
+
+// Frees the memory allocated to the placement; placement may be NULL
+void placement_free(placement_t* placement);
+
+// Pins the calling thread to the CPU of thread; does nothing if placement is NULL or PLACEMENT_NONE
+void placement_pin(const placement_t* placement, size_t thread);
+
+// Returns the distance between the CPUs of two threads, CPU_DISTANCES if they are not pinned
+enum cpu_distance placement_distance(const placement_t* placement, size_t a, size_t b);
+
+// Prints the policy, the CPU of every thread and pair_counts, the number of communicating thread
+// pairs at each cpu_distance (CPU_DISTANCES entries, may be NULL)
+void placement_print(FILE* out, const placement_t* placement, const size_t* pair_counts);
+
+#endif // PLACEMENT_H
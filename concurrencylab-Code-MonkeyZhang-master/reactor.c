@@ -0,0 +1,193 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "reactor.h"
+
+struct reactor
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond; // run queue is not empty or the reactor is stopping
+    pthread_cond_t idle_cond; // the last task finished
+    reactor_task_t *head;
+    reactor_task_t *tail;
+    size_t live_tasks;
+    bool stopping;
+    size_t num_threads;
+    pthread_t *threads;
+};
+
+// Task states; a notification that arrives while the task runs turns RUNNING into DIRTY,
+// so the readiness it reports is not lost when the step was already past that channel
+enum
+{
+    TASK_IDLE,
+    TASK_SCHEDULED,
+    TASK_RUNNING,
+    TASK_DIRTY,
+};
+
+static void enqueue(reactor_t *reactor, reactor_task_t *task)
+{
+    pthread_mutex_lock(&reactor->mutex);
+    task->next = NULL;
+    if (reactor->tail == NULL)
+    {
+        reactor->head = task;
+    }
+    else
+    {
+        reactor->tail->next = task;
+    }
+    reactor->tail = task;
+    pthread_cond_signal(&reactor->work_cond);
+    pthread_mutex_unlock(&reactor->mutex);
+}
+
+void reactor_notify(void *arg)
+{
+    reactor_task_t *task = arg;
+    int state = atomic_load(&task->state);
+    while (true)
+    {
+        if (state == TASK_IDLE)
+        {
+            if (atomic_compare_exchange_weak(&task->state, &state, TASK_SCHEDULED))
+            {
+                enqueue(task->reactor, task);
+                return;
+            }
+        }
+        else if (state == TASK_RUNNING)
+        {
+            if (atomic_compare_exchange_weak(&task->state, &state, TASK_DIRTY))
+            {
+                return;
+            }
+        }
+        else
+        {
+            // already queued or already marked to run again
+            return;
+        }
+    }
+}
+
+static void task_finished(reactor_t *reactor)
+{
+    pthread_mutex_lock(&reactor->mutex);
+    if (--reactor->live_tasks == 0)
+    {
+        pthread_cond_broadcast(&reactor->idle_cond);
+    }
+    pthread_mutex_unlock(&reactor->mutex);
+}
+
+static void *reactor_worker(void *arg)
+{
+    reactor_t *reactor = arg;
+    while (true)
+    {
+        pthread_mutex_lock(&reactor->mutex);
+        while (reactor->head == NULL && !reactor->stopping)
+        {
+            pthread_cond_wait(&reactor->work_cond, &reactor->mutex);
+        }
+        if (reactor->head == NULL)
+        {
+            pthread_mutex_unlock(&reactor->mutex);
+            return NULL;
+        }
+        reactor_task_t *task = reactor->head;
+        reactor->head = task->next;
+        if (reactor->head == NULL)
+        {
+            reactor->tail = NULL;
+        }
+        pthread_mutex_unlock(&reactor->mutex);
+
+        atomic_store(&task->state, TASK_RUNNING);
+        enum reactor_step next = task->step(task);
+        if (next == REACTOR_DONE)
+        {
+            task_finished(reactor);
+            continue;
+        }
+        int state = TASK_RUNNING;
+        if (next == REACTOR_WAIT && atomic_compare_exchange_strong(&task->state, &state, TASK_IDLE))
+        {
+            continue;
+        }
+        // yielded, or notified while running: go to the back of the queue
+        atomic_store(&task->state, TASK_SCHEDULED);
+        enqueue(reactor, task);
+    }
+}
+
+reactor_t *reactor_create(size_t num_threads)
+{
+    reactor_t *reactor = malloc(sizeof(reactor_t));
+    assert(reactor != NULL);
+    pthread_mutex_init(&reactor->mutex, NULL);
+    pthread_cond_init(&reactor->work_cond, NULL);
+    pthread_cond_init(&reactor->idle_cond, NULL);
+    reactor->head = NULL;
+    reactor->tail = NULL;
+    reactor->live_tasks = 0;
+    reactor->stopping = false;
+    if (num_threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+    reactor->num_threads = num_threads;
+    reactor->threads = malloc(sizeof(pthread_t) * num_threads);
+    assert(reactor->threads != NULL);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        int status = pthread_create(&reactor->threads[i], NULL, reactor_worker, reactor);
+        assert(status == 0);
+    }
+    return reactor;
+}
+
+void reactor_spawn(reactor_t *reactor, reactor_task_t *task, enum reactor_step (*step)(reactor_task_t *task))
+{
+    task->step = step;
+    task->reactor = reactor;
+    task->next = NULL;
+    task->watch.notify = reactor_notify;
+    task->watch.arg = task;
+    atomic_store(&task->state, TASK_SCHEDULED);
+    pthread_mutex_lock(&reactor->mutex);
+    reactor->live_tasks++;
+    pthread_mutex_unlock(&reactor->mutex);
+    enqueue(reactor, task);
+}
+
+void reactor_wait(reactor_t *reactor)
+{
+    pthread_mutex_lock(&reactor->mutex);
+    while (reactor->live_tasks > 0)
+    {
+        pthread_cond_wait(&reactor->idle_cond, &reactor->mutex);
+    }
+    pthread_mutex_unlock(&reactor->mutex);
+}
+
+void reactor_destroy(reactor_t *reactor)
+{
+    reactor_wait(reactor);
+    pthread_mutex_lock(&reactor->mutex);
+    reactor->stopping = true;
+    pthread_cond_broadcast(&reactor->work_cond);
+    pthread_mutex_unlock(&reactor->mutex);
+    for (size_t i = 0; i < reactor->num_threads; i++)
+    {
+        pthread_join(reactor->threads[i], NULL);
+    }
+    pthread_cond_destroy(&reactor->idle_cond);
+    pthread_cond_destroy(&reactor->work_cond);
+    pthread_mutex_destroy(&reactor->mutex);
+    free(reactor->threads);
+    free(reactor);
+}
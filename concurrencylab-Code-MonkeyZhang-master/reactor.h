@@ -0,0 +1,48 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "channel.h"
+
+// What a task's step asks the reactor to do next
+enum reactor_step
+{
+    REACTOR_WAIT,  // nothing to do until one of the watched channels becomes ready
+    REACTOR_YIELD, // more work is available, run again after the tasks already queued
+    REACTOR_DONE,  // finished; the reactor no longer touches the task
+};
+
+typedef struct reactor reactor_t;
+
+// A non-blocking state machine run by the reactor's worker threads
+// step must only use the non-blocking channel calls (or blocking ones that are known to complete)
+// and must unwatch all its channels before returning REACTOR_DONE
+typedef struct reactor_task
+{
+    enum reactor_step (*step)(struct reactor_task *task);
+    reactor_t *reactor;
+    struct reactor_task *next; // link in the run queue
+    atomic_int state;
+    // register this with channel_watch to have the task scheduled when the channel becomes ready
+    channel_watch_t watch;
+} reactor_task_t;
+
+// Creates a reactor with num_threads workers (0 picks the number of online CPUs)
+reactor_t *reactor_create(size_t num_threads);
+
+// Prepares task to run step on the reactor and schedules its first step
+void reactor_spawn(reactor_t *reactor, reactor_task_t *task, enum reactor_step (*step)(reactor_task_t *task));
+
+// Schedules task unless it is already queued; if it is running, it runs once more afterwards
+// This is the notify function of task->watch
+void reactor_notify(void *task);
+
+// Blocks until every spawned task has returned REACTOR_DONE
+void reactor_wait(reactor_t *reactor);
+
+// Stops the workers and frees the reactor; all tasks must be done
+void reactor_destroy(reactor_t *reactor);
+
+#endif // REACTOR_H
@@ -0,0 +1,336 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "replay.h"
+
+static void* channel_engine_create(size_t size)
+{
+    return channel_create(size);
+}
+
+static enum channel_status channel_engine_send(void* channel, void* data)
+{
+    return channel_send(channel, data);
+}
+
+static enum channel_status channel_engine_receive(void* channel, void** data)
+{
+    return channel_receive(channel, data);
+}
+
+static enum channel_status channel_engine_non_blocking_send(void* channel, void* data)
+{
+    return channel_non_blocking_send(channel, data);
+}
+
+static enum channel_status channel_engine_non_blocking_receive(void* channel, void** data)
+{
+    return channel_non_blocking_receive(channel, data);
+}
+
+static enum channel_status select_engine_send(void* channel, void* data)
+{
+    select_t entry = {channel, SEND, data};
+    size_t index;
+    return channel_select(&entry, 1, &index);
+}
+
+static enum channel_status select_engine_receive(void* channel, void** data)
+{
+    select_t entry = {channel, RECV, NULL};
+    size_t index;
+    enum channel_status status = channel_select(&entry, 1, &index);
+    *data = entry.data;
+    return status;
+}
+
+static enum channel_status channel_engine_close(void* channel)
+{
+    return channel_close(channel);
+}
+
+static enum channel_status channel_engine_destroy(void* channel)
+{
+    return channel_destroy(channel);
+}
+
+const replay_engine_t replay_engines[] = {
+    {"channel", channel_engine_create, channel_engine_send, channel_engine_receive, channel_engine_non_blocking_send,
+     channel_engine_non_blocking_receive, select_engine_send, select_engine_receive, channel_engine_close,
+     channel_engine_destroy},
+    {"select", channel_engine_create, select_engine_send, select_engine_receive, channel_engine_non_blocking_send,
+     channel_engine_non_blocking_receive, select_engine_send, select_engine_receive, channel_engine_close,
+     channel_engine_destroy},
+};
+const size_t replay_num_engines = sizeof(replay_engines) / sizeof(replay_engines[0]);
+
+const replay_engine_t* replay_engine_find(const char* name)
+{
+    for (size_t i = 0; i < replay_num_engines; i++) {
+        if (strcmp(replay_engines[i].name, name) == 0) {
+            return &replay_engines[i];
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    const channel_trace_t* trace;
+    const replay_engine_t* engine;
+    const replay_config_t* config;
+    void** channels;
+    // operations that the recording saw end other than CLOSED_ERROR and that have completed, per channel
+    atomic_size_t* completed;
+    atomic_bool forced_close;
+    atomic_size_t progress; // operations issued, to tell a slow replay from a stuck one
+    struct timespec start;
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;
+    size_t done; // threads finished
+} replay_state_t;
+
+typedef struct {
+    replay_state_t* state;
+    size_t* records; // indices of this thread's operations in the trace
+    size_t* required; // for a close, the completed count of its channel it waits for
+    size_t count;
+    uint64_t* latency; // per operation
+    size_t mismatches;
+} replay_thread_t;
+
+static uint64_t elapsed_ns(const struct timespec* start, const struct timespec* end)
+{
+    return (uint64_t)((end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec));
+}
+
+// Returns start shifted by ns nanoseconds
+static struct timespec add_ns(struct timespec start, uint64_t ns)
+{
+    start.tv_sec += (time_t)(ns / 1000000000ULL);
+    start.tv_nsec += (long)(ns % 1000000000ULL);
+    if (start.tv_nsec >= 1000000000L) {
+        start.tv_sec++;
+        start.tv_nsec -= 1000000000L;
+    }
+    return start;
+}
+
+static enum channel_status reissue(const replay_engine_t* engine, void* channel, enum channel_trace_op op)
+{
+    // payloads are not recorded; any non-NULL pointer will do
+    void* message = (void*)engine;
+    void* data = NULL;
+    switch (op) {
+        case TRACE_SEND:
+            return engine->send(channel, message);
+        case TRACE_RECEIVE:
+            return engine->receive(channel, &data);
+        case TRACE_NB_SEND:
+            return engine->non_blocking_send(channel, message);
+        case TRACE_NB_RECEIVE:
+            return engine->non_blocking_receive(channel, &data);
+        case TRACE_SELECT_SEND:
+            return engine->select_send(channel, message);
+        case TRACE_SELECT_RECV:
+            return engine->select_receive(channel, &data);
+        case TRACE_CLOSE:
+            return engine->close(channel);
+        default:
+            return GEN_ERROR;
+    }
+}
+
+static void* replay_thread(void* arg)
+{
+    replay_thread_t* thread = arg;
+    replay_state_t* state = thread->state;
+    for (size_t i = 0; i < thread->count; i++) {
+        const channel_trace_record_t* record = &state->trace->records[thread->records[i]];
+        if (state->config->speed > 0) {
+            uint64_t at_ns = (uint64_t)((double)record->time_ns / state->config->speed);
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            // a replay running behind issues at once, without a system call
+            if (elapsed_ns(&state->start, &now) < at_ns) {
+                struct timespec at = add_ns(state->start, at_ns);
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR) {
+                }
+            }
+        }
+        if (record->op == TRACE_CLOSE) {
+            // a replay that runs behind must not close a channel under operations that completed before the
+            // close in the recording
+            while (atomic_load(&state->completed[record->channel]) < thread->required[i] && !atomic_load(&state->forced_close)) {
+                sched_yield();
+            }
+        }
+        struct timespec begin, end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        enum channel_status status = reissue(state->engine, state->channels[record->channel], (enum channel_trace_op)record->op);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        thread->latency[i] = elapsed_ns(&begin, &end);
+        if ((int)status != record->status) {
+            thread->mismatches++;
+        }
+        if (record->op != TRACE_CLOSE && record->status != CLOSED_ERROR) {
+            atomic_fetch_add(&state->completed[record->channel], 1);
+        }
+        atomic_fetch_add_explicit(&state->progress, 1, memory_order_relaxed);
+    }
+    pthread_mutex_lock(&state->mutex);
+    state->done++;
+    pthread_cond_signal(&state->done_cond);
+    pthread_mutex_unlock(&state->mutex);
+    return NULL;
+}
+
+void replay_run(const channel_trace_t* trace, const replay_engine_t* engine, const replay_config_t* config,
+                replay_result_t* result)
+{
+    result->operations = 0;
+    result->mismatches = 0;
+    result->forced_close = false;
+    for (size_t op = 0; op < TRACE_OPS; op++) {
+        histogram_init(&result->latency[op]);
+    }
+
+    // channels are created up front with their recorded sizes, and destroyed at the end
+    size_t* sizes = calloc(trace->num_channels, sizeof(size_t));
+    replay_thread_t* threads = calloc(trace->num_threads, sizeof(replay_thread_t));
+    assert((sizes != NULL || trace->num_channels == 0) && (threads != NULL || trace->num_threads == 0));
+    uint64_t last_start = 0;
+    for (size_t i = 0; i < trace->num_records; i++) {
+        const channel_trace_record_t* record = &trace->records[i];
+        if (record->op == TRACE_CREATE) {
+            sizes[record->channel] = record->arg;
+        } else if (record->op != TRACE_DESTROY && record->channel != TRACE_NO_CHANNEL) {
+            threads[record->thread].count++;
+            last_start = record->time_ns;
+        }
+    }
+    replay_state_t state;
+    state.trace = trace;
+    state.engine = engine;
+    state.config = config;
+    state.channels = malloc(sizeof(void*) * (trace->num_channels ? trace->num_channels : 1));
+    assert(state.channels != NULL);
+    state.completed = malloc(sizeof(atomic_size_t) * (trace->num_channels ? trace->num_channels : 1));
+    assert(state.completed != NULL);
+    atomic_init(&state.forced_close, false);
+    atomic_init(&state.progress, 0);
+    for (size_t i = 0; i < trace->num_channels; i++) {
+        state.channels[i] = engine->create(sizes[i]);
+        atomic_init(&state.completed[i], 0);
+    }
+    for (size_t t = 0; t < trace->num_threads; t++) {
+        threads[t].state = &state;
+        threads[t].records = malloc(sizeof(size_t) * (threads[t].count ? threads[t].count : 1));
+        threads[t].required = malloc(sizeof(size_t) * (threads[t].count ? threads[t].count : 1));
+        threads[t].latency = malloc(sizeof(uint64_t) * (threads[t].count ? threads[t].count : 1));
+        assert(threads[t].records != NULL && threads[t].required != NULL && threads[t].latency != NULL);
+        threads[t].count = 0;
+    }
+    // records are in time order, so this counts what was recorded to complete before each close started
+    size_t* before = sizes;
+    memset(before, 0, sizeof(size_t) * trace->num_channels);
+    for (size_t i = 0; i < trace->num_records; i++) {
+        const channel_trace_record_t* record = &trace->records[i];
+        if (record->op != TRACE_CREATE && record->op != TRACE_DESTROY && record->channel != TRACE_NO_CHANNEL) {
+            replay_thread_t* thread = &threads[record->thread];
+            thread->required[thread->count] = before[record->channel];
+            thread->records[thread->count++] = i;
+            if (record->op != TRACE_CLOSE && record->status != CLOSED_ERROR) {
+                before[record->channel]++;
+            }
+        }
+    }
+
+    pthread_mutex_init(&state.mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&state.done_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    state.done = 0;
+    pthread_t* pids = malloc(sizeof(pthread_t) * (trace->num_threads ? trace->num_threads : 1));
+    assert(pids != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &state.start);
+    for (size_t t = 0; t < trace->num_threads; t++) {
+        int status = pthread_create(&pids[t], NULL, replay_thread, &threads[t]);
+        assert(status == 0);
+    }
+
+    double speed = config->speed > 0 ? config->speed : 1;
+    struct timespec deadline = add_ns(state.start, (uint64_t)((double)last_start / speed + config->grace * 1e9));
+    size_t progress = 0;
+    pthread_mutex_lock(&state.mutex);
+    while (state.done < trace->num_threads) {
+        if (result->forced_close) {
+            pthread_cond_wait(&state.done_cond, &state.mutex);
+        } else if (pthread_cond_timedwait(&state.done_cond, &state.mutex, &deadline) == ETIMEDOUT) {
+            size_t now = atomic_load(&state.progress);
+            if (now != progress) {
+                // slower than the recording, but still going
+                progress = now;
+                deadline = add_ns(deadline, (uint64_t)(config->grace * 1e9));
+                continue;
+            }
+            // operations the recording saw complete are blocked: unblock them
+            result->forced_close = true;
+            atomic_store(&state.forced_close, true);
+            pthread_mutex_unlock(&state.mutex);
+            for (size_t i = 0; i < trace->num_channels; i++) {
+                engine->close(state.channels[i]);
+            }
+            pthread_mutex_lock(&state.mutex);
+        }
+    }
+    pthread_mutex_unlock(&state.mutex);
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->seconds = (double)elapsed_ns(&state.start, &end) / 1e9;
+
+    for (size_t t = 0; t < trace->num_threads; t++) {
+        pthread_join(pids[t], NULL);
+        for (size_t i = 0; i < threads[t].count; i++) {
+            histogram_record(&result->latency[trace->records[threads[t].records[i]].op], threads[t].latency[i]);
+        }
+        result->operations += threads[t].count;
+        result->mismatches += threads[t].mismatches;
+        free(threads[t].records);
+        free(threads[t].required);
+        free(threads[t].latency);
+    }
+    for (size_t i = 0; i < trace->num_channels; i++) {
+        engine->close(state.channels[i]);
+        engine->destroy(state.channels[i]);
+    }
+    pthread_cond_destroy(&state.done_cond);
+    pthread_mutex_destroy(&state.mutex);
+    free(pids);
+    free(state.channels);
+    free(state.completed);
+    free(threads);
+    free(sizes);
+}
+
+void replay_print(FILE* out, const replay_engine_t* engine, const replay_result_t* result)
+{
+    fprintf(out, "%s: %zu operations in %.3f s, %zu mismatches%s\n", engine->name, result->operations, result->seconds,
+            result->mismatches, result->forced_close ? ", force-closed" : "");
+    for (size_t op = 0; op < TRACE_OPS; op++) {
+        const histogram_t* latency = &result->latency[op];
+        if (latency->count == 0) {
+            continue;
+        }
+        fprintf(out, "  %-12s %10llu ops  mean %10.0f ns  p50 %10llu ns  p99 %10llu ns  max %10llu ns\n",
+                channel_trace_op_name((enum channel_trace_op)op), (unsigned long long)latency->count,
+                histogram_mean(latency), (unsigned long long)histogram_percentile(latency, 50),
+                (unsigned long long)histogram_percentile(latency, 99), (unsigned long long)latency->max);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "channel.h"
+#include "channel_trace.h"
+#include "histogram.h"
+
+// Replays a recorded channel trace against a channel engine, the way malloclab's mdriver replays
+// allocation traces: every recorded thread gets a thread that re-issues its operations in order at
+// the recorded start times (scaled by speed), on channels created up front with the recorded sizes.
+// Message payloads are not recorded, so a dummy pointer is sent. A close waits until the operations
+// its channel completed before the close in the recording have completed in the replay too, so a
+// replay that falls behind is not cut short. Timing still differs from the recording, so a replayed
+// operation may end differently; those are counted as mismatches. If the replay is past the last
+// recorded start and makes no progress for grace seconds, every channel is closed to unblock it.
+
+// The channel calls a replay goes through; channels are opaque to the driver
+typedef struct {
+    const char* name;
+    void* (*create)(size_t size);
+    enum channel_status (*send)(void* channel, void* data);
+    enum channel_status (*receive)(void* channel, void** data);
+    enum channel_status (*non_blocking_send)(void* channel, void* data);
+    enum channel_status (*non_blocking_receive)(void* channel, void** data);
+    enum channel_status (*select_send)(void* channel, void* data); // replays a select that sent
+    enum channel_status (*select_receive)(void* channel, void** data);
+    enum channel_status (*close)(void* channel);
+    enum channel_status (*destroy)(void* channel);
+} replay_engine_t;
+
+// Engines available to the replay driver: "channel" calls the channel as recorded, "select" issues
+// every blocking send and receive as a single-entry channel_select
+extern const replay_engine_t replay_engines[];
+extern const size_t replay_num_engines;
+
+// Returns the engine called name, or NULL
+const replay_engine_t* replay_engine_find(const char* name);
+
+typedef struct {
+    double speed; // 1 replays at the recorded pace, 2 twice as fast; 0 ignores the gaps
+    double grace; // seconds without progress, after the last recorded start, before channels are force-closed
+} replay_config_t;
+
+typedef struct {
+    size_t operations;  // operations re-issued
+    size_t mismatches;  // operations whose status differs from the recording
+    bool forced_close;  // the replay had to be unblocked by closing every channel
+    double seconds;     // wall time of the replay
+    histogram_t latency[TRACE_OPS]; // nanoseconds per call, by operation
+} replay_result_t;
+
+// Replays trace against engine
+void replay_run(const channel_trace_t* trace, const replay_engine_t* engine, const replay_config_t* config,
+                replay_result_t* result);
+
+// Prints one line per operation kind that occurred, prefixed with the engine's name
+void replay_print(FILE* out, const replay_engine_t* engine, const replay_result_t* result);
+
+#endif // REPLAY_H
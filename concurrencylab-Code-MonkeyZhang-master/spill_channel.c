@@ -0,0 +1,366 @@
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "spill_channel.h"
+
+// A record on disk is its payload length followed by the payload, padded to a multiple of 8
+// A segment ends at SPILL_END, or where fewer than RECORD_HEADER bytes are left
+#define RECORD_HEADER sizeof(uint64_t)
+#define SPILL_END UINT64_MAX
+// Drained segments kept for reuse instead of being unmapped
+#define SPILL_FREE_SEGMENTS 2
+
+struct spill_segment
+{
+    int fd;
+    char *base;
+    size_t read_offset;
+    size_t write_offset;
+    spill_segment_t *next;
+};
+
+// A message in the in-memory ring
+typedef struct
+{
+    size_t size;
+    char data[];
+} spill_message_t;
+
+static size_t record_size(size_t size)
+{
+    return RECORD_HEADER + ((size + 7) & ~(size_t)7);
+}
+
+spill_channel_t *spill_channel_create(size_t capacity, const char *directory, size_t segment_size, size_t max_segments)
+{
+    // a segment must hold at least one record, and mmap works in pages
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (directory == NULL || segment_size < 2 * RECORD_HEADER || segment_size % (size_t)page_size != 0)
+    {
+        return NULL;
+    }
+    spill_channel_t *channel = malloc(sizeof(spill_channel_t));
+    if (channel == NULL)
+    {
+        return NULL;
+    }
+    channel->buffer = buffer_create(capacity);
+    pthread_mutex_init(&channel->mutex, NULL);
+    pthread_cond_init(&channel->send_cond, NULL);
+    pthread_cond_init(&channel->recv_cond, NULL);
+    channel->is_closed = false;
+    channel->directory = strdup(directory);
+    channel->segment_size = segment_size;
+    channel->max_segments = max_segments;
+    channel->read_segment = NULL;
+    channel->write_segment = NULL;
+    channel->free_segments = NULL;
+    channel->num_segments = 0;
+    channel->num_free_segments = 0;
+    channel->spilled_messages = 0;
+    return channel;
+}
+
+// Creates a segment file; it is unlinked right away, so it disappears with the channel or the process
+static spill_segment_t *segment_create(spill_channel_t *channel)
+{
+    size_t length = strlen(channel->directory) + sizeof("/spill-XXXXXX");
+    char *path = malloc(length);
+    if (path == NULL)
+    {
+        return NULL;
+    }
+    snprintf(path, length, "%s/spill-XXXXXX", channel->directory);
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        free(path);
+        return NULL;
+    }
+    unlink(path);
+    free(path);
+    spill_segment_t *segment = malloc(sizeof(spill_segment_t));
+    if (segment == NULL || ftruncate(fd, (off_t)channel->segment_size) != 0)
+    {
+        free(segment);
+        close(fd);
+        return NULL;
+    }
+    segment->base = mmap(NULL, channel->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (segment->base == MAP_FAILED)
+    {
+        free(segment);
+        close(fd);
+        return NULL;
+    }
+    segment->fd = fd;
+    channel->num_segments++;
+    return segment;
+}
+
+static void segment_free(spill_channel_t *channel, spill_segment_t *segment)
+{
+    munmap(segment->base, channel->segment_size);
+    close(segment->fd);
+    free(segment);
+    channel->num_segments--;
+}
+
+// Returns a drained segment to the free list, or to the file system if enough are kept already
+static void segment_recycle(spill_channel_t *channel, spill_segment_t *segment)
+{
+    if (channel->num_free_segments < SPILL_FREE_SEGMENTS)
+    {
+        segment->next = channel->free_segments;
+        channel->free_segments = segment;
+        channel->num_free_segments++;
+    }
+    else
+    {
+        segment_free(channel, segment);
+    }
+    pthread_cond_broadcast(&channel->send_cond);
+}
+
+// Appends a record to the write segment, starting a new segment when it does not fit
+// Returns SUCCESS, CHANNEL_FULL if that would exceed max_segments, or GEN_ERROR
+static enum channel_status spill_append(spill_channel_t *channel, const void *data, size_t size)
+{
+    spill_segment_t *segment = channel->write_segment;
+    size_t needed = record_size(size);
+    if (segment == NULL || segment->write_offset + needed > channel->segment_size)
+    {
+        if (segment != NULL && segment->write_offset + RECORD_HEADER <= channel->segment_size)
+        {
+            *(uint64_t *)(segment->base + segment->write_offset) = SPILL_END;
+        }
+        size_t in_use = channel->num_segments - channel->num_free_segments;
+        if (channel->max_segments > 0 && in_use >= channel->max_segments)
+        {
+            return CHANNEL_FULL;
+        }
+        spill_segment_t *next = channel->free_segments;
+        if (next != NULL)
+        {
+            channel->free_segments = next->next;
+            channel->num_free_segments--;
+        }
+        else
+        {
+            next = segment_create(channel);
+            if (next == NULL)
+            {
+                return GEN_ERROR;
+            }
+        }
+        next->read_offset = 0;
+        next->write_offset = 0;
+        next->next = NULL;
+        if (segment != NULL)
+        {
+            segment->next = next;
+        }
+        else
+        {
+            channel->read_segment = next;
+        }
+        channel->write_segment = next;
+        segment = next;
+    }
+    *(uint64_t *)(segment->base + segment->write_offset) = size;
+    memcpy(segment->base + segment->write_offset + RECORD_HEADER, data, size);
+    segment->write_offset += needed;
+    channel->spilled_messages++;
+    return SUCCESS;
+}
+
+// Reads the oldest spilled record; there must be one
+static enum channel_status spill_read(spill_channel_t *channel, void *data, size_t capacity, size_t *size)
+{
+    spill_segment_t *segment = channel->read_segment;
+    while (segment->read_offset + RECORD_HEADER > channel->segment_size ||
+           *(uint64_t *)(segment->base + segment->read_offset) == SPILL_END)
+    {
+        // the writer moved on to the next segment, so this one is drained
+        channel->read_segment = segment->next;
+        segment_recycle(channel, segment);
+        segment = channel->read_segment;
+        assert(segment != NULL);
+    }
+    uint64_t length = *(uint64_t *)(segment->base + segment->read_offset);
+    *size = (size_t)length;
+    if (length > capacity)
+    {
+        return GEN_ERROR;
+    }
+    memcpy(data, segment->base + segment->read_offset + RECORD_HEADER, (size_t)length);
+    segment->read_offset += record_size((size_t)length);
+    if (--channel->spilled_messages == 0)
+    {
+        // the last segment is empty again: rewind it instead of moving on
+        assert(segment == channel->write_segment);
+        segment->read_offset = 0;
+        segment->write_offset = 0;
+        pthread_cond_broadcast(&channel->send_cond);
+    }
+    return SUCCESS;
+}
+
+enum channel_status spill_channel_send(spill_channel_t *channel, const void *data, size_t size)
+{
+    if (record_size(size) > channel->segment_size)
+    {
+        return GEN_ERROR;
+    }
+    // copied before locking, in case the message goes to the ring
+    spill_message_t *message = malloc(sizeof(spill_message_t) + size);
+    if (message == NULL)
+    {
+        return GEN_ERROR;
+    }
+    message->size = size;
+    memcpy(message->data, data, size);
+
+    pthread_mutex_lock(&channel->mutex);
+    enum channel_status status;
+    while (true)
+    {
+        if (channel->is_closed)
+        {
+            status = CLOSED_ERROR;
+            break;
+        }
+        // nothing may overtake a spilled message
+        if (channel->spilled_messages == 0 && buffer_add(channel->buffer, message) == BUFFER_SUCCESS)
+        {
+            message = NULL;
+            status = SUCCESS;
+            break;
+        }
+        status = spill_append(channel, data, size);
+        if (status != CHANNEL_FULL)
+        {
+            break;
+        }
+        pthread_cond_wait(&channel->send_cond, &channel->mutex);
+    }
+    if (status == SUCCESS)
+    {
+        pthread_cond_signal(&channel->recv_cond);
+    }
+    pthread_mutex_unlock(&channel->mutex);
+    free(message);
+    return status;
+}
+
+// Takes the oldest message if there is one; returns CHANNEL_EMPTY otherwise
+static enum channel_status try_receive(spill_channel_t *channel, void *data, size_t capacity, size_t *size)
+{
+    void *head = NULL;
+    if (buffer_peek_head(channel->buffer, &head) == BUFFER_SUCCESS)
+    {
+        // ring messages are older than spilled ones; look at the head before taking it
+        spill_message_t *message = head;
+        *size = message->size;
+        if (message->size > capacity)
+        {
+            return GEN_ERROR;
+        }
+        void *removed = NULL;
+        buffer_remove(channel->buffer, &removed);
+        memcpy(data, message->data, message->size);
+        free(message);
+        return SUCCESS;
+    }
+    if (channel->spilled_messages > 0)
+    {
+        return spill_read(channel, data, capacity, size);
+    }
+    return CHANNEL_EMPTY;
+}
+
+enum channel_status spill_channel_receive(spill_channel_t *channel, void *data, size_t capacity, size_t *size)
+{
+    pthread_mutex_lock(&channel->mutex);
+    enum channel_status status;
+    while (true)
+    {
+        if (channel->is_closed)
+        {
+            status = CLOSED_ERROR;
+            break;
+        }
+        status = try_receive(channel, data, capacity, size);
+        if (status != CHANNEL_EMPTY)
+        {
+            break;
+        }
+        pthread_cond_wait(&channel->recv_cond, &channel->mutex);
+    }
+    pthread_mutex_unlock(&channel->mutex);
+    return status;
+}
+
+enum channel_status spill_channel_non_blocking_receive(spill_channel_t *channel, void *data, size_t capacity, size_t *size)
+{
+    pthread_mutex_lock(&channel->mutex);
+    enum channel_status status = channel->is_closed ? CLOSED_ERROR : try_receive(channel, data, capacity, size);
+    pthread_mutex_unlock(&channel->mutex);
+    return status;
+}
+
+void spill_channel_stats(spill_channel_t *channel, spill_channel_stats_t *stats)
+{
+    pthread_mutex_lock(&channel->mutex);
+    stats->memory_messages = buffer_current_size(channel->buffer);
+    stats->spilled_messages = channel->spilled_messages;
+    stats->segments = channel->num_segments;
+    pthread_mutex_unlock(&channel->mutex);
+}
+
+enum channel_status spill_channel_close(spill_channel_t *channel)
+{
+    pthread_mutex_lock(&channel->mutex);
+    if (channel->is_closed)
+    {
+        pthread_mutex_unlock(&channel->mutex);
+        return CLOSED_ERROR;
+    }
+    channel->is_closed = true;
+    pthread_cond_broadcast(&channel->send_cond);
+    pthread_cond_broadcast(&channel->recv_cond);
+    pthread_mutex_unlock(&channel->mutex);
+    return SUCCESS;
+}
+
+enum channel_status spill_channel_destroy(spill_channel_t *channel)
+{
+    if (!channel->is_closed)
+    {
+        return DESTROY_ERROR;
+    }
+    void *message = NULL;
+    while (buffer_remove(channel->buffer, &message) == BUFFER_SUCCESS)
+    {
+        free(message);
+    }
+    buffer_free(channel->buffer);
+    spill_segment_t *lists[] = {channel->read_segment, channel->free_segments};
+    for (size_t i = 0; i < 2; i++)
+    {
+        while (lists[i] != NULL)
+        {
+            spill_segment_t *next = lists[i]->next;
+            segment_free(channel, lists[i]);
+            lists[i] = next;
+        }
+    }
+    assert(channel->num_segments == 0);
+    pthread_cond_destroy(&channel->send_cond);
+    pthread_cond_destroy(&channel->recv_cond);
+    pthread_mutex_destroy(&channel->mutex);
+    free(channel->directory);
+    free(channel);
+    return SUCCESS;
+}
@@ -0,0 +1,76 @@
+#ifndef SPILL_CHANNEL_H
+#define SPILL_CHANNEL_H
+
+#include <stddef.h>
+#include "channel.h"
+
+// A channel that never blocks its senders on a slow receiver: messages are copied into a bounded
+// in-memory buffer_t ring, and once that is full they are appended to memory-mapped segment files on
+// local disk, which receivers read back in order. Messages are byte strings copied in and out
+// (inline payloads), since pointers cannot be spilled. Drained segments are reused.
+//
+// Order is kept by sending everything to disk while anything is on disk: every message in the ring
+// is older than every spilled one, and senders go back to the ring once the receivers caught up.
+typedef struct spill_segment spill_segment_t;
+
+typedef struct
+{
+    buffer_t *buffer; // in-memory ring of spill_message_t *
+
+    pthread_mutex_t mutex;
+    pthread_cond_t send_cond; // disk space was freed
+    pthread_cond_t recv_cond; // a message arrived
+    bool is_closed;
+
+    char *directory;
+    size_t segment_size;
+    size_t max_segments; // 0 for no limit on disk use
+    // segments in use, oldest (read) first; the last one is being written
+    spill_segment_t *read_segment;
+    spill_segment_t *write_segment;
+    spill_segment_t *free_segments;
+    size_t num_segments; // in use and free
+    size_t num_free_segments;
+    size_t spilled_messages; // messages on disk
+} spill_channel_t;
+
+typedef struct
+{
+    size_t memory_messages;
+    size_t spilled_messages;
+    size_t segments; // segment files open, in use or kept for reuse
+} spill_channel_stats_t;
+
+// Creates a spill channel with an in-memory ring of capacity messages and segment files of
+// segment_size bytes created in directory; with max_segments > 0, senders block once that many
+// segments are full of unread messages
+// Returns NULL if the arguments are invalid
+spill_channel_t *spill_channel_create(size_t capacity, const char *directory, size_t segment_size, size_t max_segments);
+
+// Copies size bytes of data into the channel
+// Only blocks while the disk limit is reached
+// Returns SUCCESS, CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR if the message cannot fit in a segment or a segment file cannot be created
+enum channel_status spill_channel_send(spill_channel_t *channel, const void *data, size_t size);
+
+// Copies the oldest message into data (capacity bytes) and stores its length in size
+// Blocks while the channel is empty
+// Returns SUCCESS, CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR if the message is larger than capacity; size is then set and the message is kept
+enum channel_status spill_channel_receive(spill_channel_t *channel, void *data, size_t capacity, size_t *size);
+
+// Same as spill_channel_receive, but returns CHANNEL_EMPTY instead of blocking
+enum channel_status spill_channel_non_blocking_receive(spill_channel_t *channel, void *data, size_t capacity, size_t *size);
+
+// Stores the current number of messages in memory and on disk, and the number of segment files
+void spill_channel_stats(spill_channel_t *channel, spill_channel_stats_t *stats);
+
+// Closes the channel and wakes up all blocked calls, which return CLOSED_ERROR
+// Returns SUCCESS, or CLOSED_ERROR if the channel is already closed
+enum channel_status spill_channel_close(spill_channel_t *channel);
+
+// Frees the channel and removes its segment files
+// Returns SUCCESS, or DESTROY_ERROR if the channel is still open
+enum channel_status spill_channel_destroy(spill_channel_t *channel);
+
+#endif // SPILL_CHANNEL_H
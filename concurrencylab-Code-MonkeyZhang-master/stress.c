@@ -1,54 +1,90 @@
-#include <unistd.h>
 #include <pthread.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include "channel.h"
 #include "stress.h"
+#include "floyd_warshall.h"
+#include "arena.h"
+#include "graph.h"
+#include "msg_pool.h"
+#include "placement.h"
+#include "reactor.h"
 
-typedef unsigned int distance_t;
 typedef struct {
     size_t src;
     size_t epoch;
     distance_t dist[0];
 } distance_vector_t;
 
+// Delta mode: a router sends only the entries that improved since its last broadcast
+typedef struct {
+    uint32_t dst;
+    distance_t dist;
+} delta_entry_t;
+
+typedef struct {
+    size_t src;
+    size_t count;
+    delta_entry_t entries[0];
+} delta_message_t;
+
+// Every DELTA_FULL_SYNC-th broadcast of a router carries its whole distance vector
+#define DELTA_FULL_SYNC 64
+
 static const distance_t inf_distance = 0x7fffffff;
-static distance_t* topology;
+static graph_t* topology;
+// Distance vectors and delta messages are shared by all receivers of a broadcast and go back
+// to the pool of the sending thread once the last receiver released them
+static msg_pool_t* vector_pool;
+static msg_pool_t* delta_pool;
+// dense all-pairs solution, or NULL when sparse graphs are verified with Dijkstra
 static distance_t* solution;
 static size_t num_channel;
 static channel_t** channels;
 static channel_t* done_channel;
 static channel_t* completed_channel;
+// router threads are pinned when CHANNEL_PLACEMENT is set, and the convergence time is printed with it
+static placement_t* placement;
 
-distance_t get_link_distance(size_t src, size_t dst) {
-    return topology[src * num_channel + dst];
-}
+// Termination is detected by credit counting: credits holds one credit per active router
+// (one with something left to broadcast) plus one per distance vector not yet processed.
+// A router takes the credits for a whole broadcast before sending it while it still holds its
+// own, and a receiver takes its own credit before giving back the one of the vector that
+// woke it up, so the count only reaches zero once the network is quiescent. The router that
+// gives back the last credit notifies the controller, which happens exactly once per run.
+static atomic_size_t credits;
 
-void set_link_distance(size_t src, size_t dst, distance_t distance) {
-    topology[src * num_channel + dst] = distance;
+static void release_credits(size_t count)
+{
+    if (atomic_fetch_sub(&credits, count) == count) {
+        enum channel_status status = channel_send(completed_channel, NULL);
+        assert(status == SUCCESS);
+    }
 }
 
-distance_t get_solution_distance(size_t src, size_t dst) {
-    return solution[src * num_channel + dst];
+distance_t get_link_distance(size_t src, size_t dst) {
+    return graph_link_distance(topology, src, dst);
 }
 
-void set_solution_distance(size_t src, size_t dst, distance_t distance) {
-    solution[src * num_channel + dst] = distance;
+// Stores the shortest distance from src to every router in dist
+void get_solution_row(size_t src, distance_t* dist) {
+    if (solution != NULL) {
+        memcpy(dist, &solution[src * num_channel], sizeof(distance_t) * num_channel);
+    } else {
+        graph_dijkstra(topology, src, dist);
+    }
 }
 
 void floyd_warshall()
 {
-    memcpy(solution, topology, sizeof(distance_t) * num_channel * num_channel);
-    for (size_t intermediate = 0; intermediate < num_channel; intermediate++) {
-        for (size_t src = 0; src < num_channel; src++) {
-            for (size_t dst = 0; dst < num_channel; dst++) {
-                if (get_solution_distance(src, intermediate) + get_solution_distance(intermediate, dst) < get_solution_distance(src, dst)) {
-                    set_solution_distance(src, dst, get_solution_distance(src, intermediate) + get_solution_distance(intermediate, dst));
-                }
-            }
-        }
-    }
+    graph_to_dense(topology, solution);
+    // tiled and multithreaded; floyd_warshall_scalar() is the reference it is tested against
+    floyd_warshall_blocked(solution, num_channel, 0);
 }
 
 void print_graph()
@@ -70,9 +106,12 @@ void print_graph()
 void print_solution()
 {
     printf("SOLUTION\n");
+    distance_t* row = malloc(sizeof(distance_t) * num_channel);
+    assert(row != NULL);
     for (size_t src = 0; src < num_channel; src++) {
+        get_solution_row(src, row);
         for (size_t dst = 0; dst < num_channel; dst++) {
-            distance_t distance = get_solution_distance(src, dst);
+            distance_t distance = row[dst];
             if (distance == inf_distance) {
                 printf("inf ");
             } else {
@@ -81,80 +120,72 @@ void print_solution()
         }
         printf("\n");
     }
+    free(row);
 }
 
 bool create_topology(const char* filename)
 {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
+    topology = graph_read(filename);
+    if (topology == NULL) {
         printf("Could not open topology file: %s\n", filename);
         return false;
     }
-    int num_scanned = fscanf(file, "%zu", &num_channel);
-    assert(num_scanned == 1);
+    num_channel = topology->num_nodes;
     assert(num_channel > 0);
-    topology = malloc(sizeof(distance_t) * num_channel * num_channel);
-    assert(topology != NULL);
-    solution = malloc(sizeof(distance_t) * num_channel * num_channel);
-    assert(solution != NULL);
-    // populate topology
-    for (size_t src = 0; src < num_channel; src++) {
-        for (size_t dst = 0; dst < num_channel; dst++) {
-            distance_t distance;
-            num_scanned = fscanf(file, "%d", (int*)&distance);
-            assert(num_scanned == 1);
-            // negative values get converted to inf_distance
-            if (distance > inf_distance) {
-                distance = inf_distance;
-            }
-            set_link_distance(src, dst, distance);
-        }
+    // all-pairs Floyd-Warshall is O(n^3) time and O(n^2) memory, so only dense graphs use it;
+    // sparse graphs are checked per source with Dijkstra once the routers converged
+    if (topology->num_edges * 16 >= num_channel * num_channel) {
+        solution = malloc(sizeof(distance_t) * num_channel * num_channel);
+        assert(solution != NULL);
+        floyd_warshall();
+    } else {
+        solution = NULL;
     }
-    fclose(file);
-    // calculate solution using Floyd-Warshall algorithm
-    floyd_warshall();
     return true;
 }
 
 void destroy_topology()
 {
-    free(topology);
+    graph_free(topology);
     free(solution);
 }
 
+// Sets the distances a router knows before hearing from anyone: its own links
+void init_distance_vector(distance_vector_t* state, size_t index)
+{
+    for (size_t i = 0; i < num_channel; i++) {
+        state->dist[i] = inf_distance;
+    }
+    state->dist[index] = 0;
+    for (size_t e = topology->row_start[index]; e < topology->row_start[index + 1]; e++) {
+        state->dist[topology->dst[e]] = topology->weight[e];
+    }
+}
+
 void* router(void* arg)
 {
     bool changed = false;
     size_t index = (size_t)arg;
+    placement_pin(placement, index);
     size_t selected_index;
-    distance_vector_t* prev_prev_state = malloc(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
-    assert(prev_prev_state != NULL);
-    distance_vector_t* prev_state = malloc(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
-    assert(prev_state != NULL);
-    distance_vector_t* curr_state = malloc(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
-    assert(curr_state != NULL);
-    distance_vector_t* next_state = malloc(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
-    assert(next_state != NULL);
-    prev_prev_state->src = index;
-    prev_state->src = index;
+    // curr_state is the vector being broadcast, which the receivers hold a reference to until they
+    // processed it; next_state collects the improvements that go into the next broadcast
+    distance_vector_t* curr_state = msg_alloc(vector_pool);
+    distance_vector_t* next_state = msg_alloc(vector_pool);
     curr_state->src = index;
     next_state->src = index;
-    prev_prev_state->epoch = 0;
-    prev_state->epoch = 1;
-    curr_state->epoch = 2;
-    next_state->epoch = 3;
-    for (size_t i = 0; i < num_channel; i++) {
-        prev_prev_state->dist[i] = get_link_distance(index, i);
-        prev_state->dist[i] = get_link_distance(index, i);
-        curr_state->dist[i] = get_link_distance(index, i);
-        next_state->dist[i] = get_link_distance(index, i);
-    }
-    size_t total_select_count = 2;
-    for (size_t i = 0; i < num_channel; i++) {
-        if ((i != index) && get_link_distance(index, i) != inf_distance) {
-            total_select_count++;
-        }
-    }
+    curr_state->epoch = 0;
+    next_state->epoch = 1;
+    init_distance_vector(curr_state, index);
+    init_distance_vector(next_state, index);
+    // neighbours come straight from the CSR row instead of scanning every router
+    size_t first_edge = topology->row_start[index];
+    size_t last_edge = topology->row_start[index + 1];
+    size_t total_select_count = 2 + (last_edge - first_edge);
+    // the credit of this router was taken by run_stress; take those of the first broadcast
+    bool active = true;
+    atomic_fetch_add(&credits, last_edge - first_edge);
+    msg_retain(curr_state, last_edge - first_edge);
     select_t* select_list = malloc(sizeof(select_t) * total_select_count);
     assert(select_list != NULL);
     size_t select_count = 0;
@@ -166,15 +197,17 @@ void* router(void* arg)
     select_list[select_count].dir = RECV;
     select_list[select_count].data = NULL;
     select_count++;
-    for (size_t i = 0; i < num_channel; i++) {
-        if ((i != index) && get_link_distance(index, i) != inf_distance) {
-            select_list[select_count].channel = channels[i];
-            select_list[select_count].dir = SEND;
-            select_list[select_count].data = curr_state;
-            select_count++;
-        }
+    for (size_t e = first_edge; e < last_edge; e++) {
+        select_list[select_count].channel = channels[topology->dst[e]];
+        select_list[select_count].dir = SEND;
+        select_list[select_count].data = curr_state;
+        select_count++;
     }
     while (true) {
+        if (active && select_count == 2 && !changed) {
+            active = false;
+            release_credits(1);
+        }
         enum channel_status status = channel_select(select_list, select_count, &selected_index);
         if (status == SUCCESS) {
             assert(selected_index != 0);
@@ -191,8 +224,14 @@ void* router(void* arg)
                             changed = true;
                         }
                     }
+                    msg_release(neighbor_state);
+                    if (changed && !active) {
+                        active = true;
+                        atomic_fetch_add(&credits, 1);
+                    }
+                    release_credits(1);
                 } else {
-                    // special message sent to test convergence
+                    // special message sent by the controller to collect the result
                     bool converged = (select_count == 2) && !changed;
                     status = channel_send(completed_channel, converged ? curr_state : NULL);
                     assert(status == SUCCESS);
@@ -208,18 +247,17 @@ void* router(void* arg)
             if (select_count == 2) {
                 // check if we want to reset
                 if (changed) {
-                    // cycle triple buffer
-                    distance_vector_t* temp_state = curr_state;
+                    // receivers of the last broadcast that are still behind keep it alive
+                    msg_release(curr_state);
                     curr_state = next_state;
-                    next_state = prev_prev_state;
-                    prev_prev_state = prev_state;
-                    prev_state = temp_state;
+                    next_state = msg_alloc(vector_pool);
+                    next_state->src = index;
                     next_state->epoch = curr_state->epoch + 1;
-                    for (size_t i = 0; i < num_channel; i++) {
-                        next_state->dist[i] = curr_state->dist[i];
-                    }
+                    memcpy(next_state->dist, curr_state->dist, sizeof(distance_t) * num_channel);
                     // reset to broadcast again
                     select_count = total_select_count;
+                    atomic_fetch_add(&credits, total_select_count - 2);
+                    msg_retain(curr_state, total_select_count - 2);
                     for (size_t i = 2; i < select_count; i++) {
                         select_list[i].data = curr_state;
                     }
@@ -234,72 +272,337 @@ void* router(void* arg)
         }
     }
     free(select_list);
-    free(prev_prev_state);
-    free(prev_state);
-    free(curr_state);
-    free(next_state);
+    msg_release(curr_state);
+    msg_release(next_state);
+    return NULL;
+}
+
+// Router of the delta mode
+// The router keeps a single distance vector and remembers which entries improved (dirty);
+// a broadcast sends those entries in one pooled message shared by all neighbours.
+// Since distances only ever decrease and every decrease is sent, a neighbour ends up with the
+// final value of every entry; the periodic full sync makes up for anything a receiver missed.
+void* router_delta(void* arg)
+{
+    size_t index = (size_t)arg;
+    placement_pin(placement, index);
+    size_t selected_index;
+    assert(num_channel <= UINT32_MAX);
+    distance_vector_t* state = malloc(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
+    assert(state != NULL);
+    state->src = index;
+    state->epoch = 0;
+    init_distance_vector(state, index);
+    bool* dirty = calloc(num_channel, sizeof(bool));
+    assert(dirty != NULL);
+    uint32_t* dirty_list = malloc(sizeof(uint32_t) * num_channel);
+    assert(dirty_list != NULL);
+    size_t dirty_count = 0;
+    size_t first_edge = topology->row_start[index];
+    size_t last_edge = topology->row_start[index + 1];
+    size_t total_select_count = 2 + (last_edge - first_edge);
+    select_t* select_list = malloc(sizeof(select_t) * total_select_count);
+    assert(select_list != NULL);
+    select_list[0].channel = done_channel;
+    select_list[0].dir = RECV;
+    select_list[1].channel = channels[index];
+    select_list[1].dir = RECV;
+    // the credit of this router was taken by run_stress
+    size_t select_count = 2;
+    bool active = true;
+    while (true) {
+        // the first broadcast is unconditional; every DELTA_FULL_SYNC-th one is a full sync
+        if (select_count == 2 && (dirty_count > 0 || state->epoch == 0)) {
+            bool full_sync = state->epoch % DELTA_FULL_SYNC == 0;
+            delta_message_t* message = NULL;
+            if (last_edge > first_edge) {
+                message = msg_alloc(delta_pool);
+                message->src = index;
+                message->count = 0;
+                msg_retain(message, last_edge - first_edge - 1);
+                if (full_sync) {
+                    for (size_t i = 0; i < num_channel; i++) {
+                        if (state->dist[i] != inf_distance) {
+                            message->entries[message->count].dst = (uint32_t)i;
+                            message->entries[message->count].dist = state->dist[i];
+                            message->count++;
+                        }
+                    }
+                } else {
+                    for (size_t i = 0; i < dirty_count; i++) {
+                        message->entries[message->count].dst = dirty_list[i];
+                        message->entries[message->count].dist = state->dist[dirty_list[i]];
+                        message->count++;
+                    }
+                }
+                atomic_fetch_add(&credits, last_edge - first_edge);
+                for (size_t e = first_edge; e < last_edge; e++) {
+                    select_list[select_count].channel = channels[topology->dst[e]];
+                    select_list[select_count].dir = SEND;
+                    select_list[select_count].data = message;
+                    select_count++;
+                }
+            }
+            for (size_t i = 0; i < dirty_count; i++) {
+                dirty[dirty_list[i]] = false;
+            }
+            dirty_count = 0;
+            state->epoch++;
+        }
+        if (active && select_count == 2) {
+            active = false;
+            release_credits(1);
+        }
+        enum channel_status status = channel_select(select_list, select_count, &selected_index);
+        if (status == SUCCESS) {
+            assert(selected_index != 0);
+            if (selected_index == 1) {
+                if (select_list[selected_index].data) {
+                    delta_message_t* message = select_list[selected_index].data;
+                    distance_t neighbor_dist = get_link_distance(index, message->src);
+                    assert(neighbor_dist != inf_distance);
+                    for (size_t i = 0; i < message->count; i++) {
+                        uint32_t dst = message->entries[i].dst;
+                        distance_t new_dist = neighbor_dist + message->entries[i].dist;
+                        if (new_dist < state->dist[dst]) {
+                            state->dist[dst] = new_dist;
+                            if (!dirty[dst]) {
+                                dirty[dst] = true;
+                                dirty_list[dirty_count++] = dst;
+                            }
+                        }
+                    }
+                    msg_release(message);
+                    if (dirty_count > 0 && !active) {
+                        active = true;
+                        atomic_fetch_add(&credits, 1);
+                    }
+                    release_credits(1);
+                } else {
+                    // special message sent by the controller to collect the result
+                    bool converged = (select_count == 2) && dirty_count == 0;
+                    status = channel_send(completed_channel, converged ? state : NULL);
+                    assert(status == SUCCESS);
+                }
+            } else {
+                select_count--;
+                // swap last element and selected element
+                channel_t* temp = select_list[select_count].channel;
+                select_list[select_count].channel = select_list[selected_index].channel;
+                select_list[selected_index].channel = temp;
+            }
+        } else {
+            assert(status == CLOSED_ERROR);
+            assert(selected_index == 0);
+            assert(dirty_count == 0);
+            break;
+        }
+    }
+    free(select_list);
+    free(dirty_list);
+    free(dirty);
+    free(state);
     return NULL;
 }
 
-bool check_done()
+// Router of the reactor mode: the same algorithm as router(), as a non-blocking state machine
+// that the reactor's workers step whenever one of its channels becomes ready
+typedef struct {
+    reactor_task_t task; // first member, so the task pointer is the router pointer
+    size_t index;
+    bool watching;
+    bool changed;
+    bool active;
+    distance_vector_t* curr_state;
+    distance_vector_t* next_state;
+    // pending broadcast sends are select_list[2 .. select_count), as in router()
+    select_t* select_list;
+    size_t select_count;
+    size_t total_select_count;
+} router_task_t;
+
+// Messages handled per step before the router goes to the back of the run queue
+#define ROUTER_STEP_BUDGET 64
+
+static router_task_t* router_task_create(size_t index)
+{
+    router_task_t* router = malloc(sizeof(router_task_t));
+    assert(router != NULL);
+    router->index = index;
+    router->watching = false;
+    router->changed = false;
+    router->active = true;
+    distance_vector_t** states[] = {&router->curr_state, &router->next_state};
+    for (size_t i = 0; i < 2; i++) {
+        *states[i] = msg_alloc(vector_pool);
+        (*states[i])->src = index;
+        (*states[i])->epoch = i;
+        init_distance_vector(*states[i], index);
+    }
+    size_t first_edge = topology->row_start[index];
+    size_t last_edge = topology->row_start[index + 1];
+    router->total_select_count = 2 + (last_edge - first_edge);
+    router->select_list = malloc(sizeof(select_t) * router->total_select_count);
+    assert(router->select_list != NULL);
+    router->select_list[0].channel = done_channel;
+    router->select_list[0].dir = RECV;
+    router->select_list[1].channel = channels[index];
+    router->select_list[1].dir = RECV;
+    for (size_t e = first_edge; e < last_edge; e++) {
+        router->select_list[2 + e - first_edge].channel = channels[topology->dst[e]];
+        router->select_list[2 + e - first_edge].dir = SEND;
+        router->select_list[2 + e - first_edge].data = router->curr_state;
+    }
+    router->select_count = router->total_select_count;
+    // the credit of this router was taken by run_stress; take those of the first broadcast
+    atomic_fetch_add(&credits, last_edge - first_edge);
+    msg_retain(router->curr_state, last_edge - first_edge);
+    return router;
+}
+
+static void router_task_destroy(router_task_t* router)
+{
+    for (size_t i = 0; i < router->total_select_count; i++) {
+        channel_unwatch(router->select_list[i].channel, router->select_list[i].dir, &router->task.watch);
+    }
+    free(router->select_list);
+    msg_release(router->curr_state);
+    msg_release(router->next_state);
+    free(router);
+}
+
+static void router_task_handle(router_task_t* router, void* data)
+{
+    if (data) {
+        // update next_state with new data
+        distance_vector_t* neighbor_state = data;
+        distance_t neighbor_dist = get_link_distance(router->index, neighbor_state->src);
+        assert(neighbor_dist != inf_distance);
+        for (size_t i = 0; i < num_channel; i++) {
+            distance_t new_dist = neighbor_dist + neighbor_state->dist[i];
+            if (new_dist < router->next_state->dist[i]) {
+                router->next_state->dist[i] = new_dist;
+                router->changed = true;
+            }
+        }
+        msg_release(neighbor_state);
+        if (router->changed && !router->active) {
+            router->active = true;
+            atomic_fetch_add(&credits, 1);
+        }
+        release_credits(1);
+    } else {
+        // special message sent by the controller to collect the result; the controller
+        // is already waiting in channel_receive, so this blocking send completes
+        bool converged = (router->select_count == 2) && !router->changed;
+        enum channel_status status = channel_send(completed_channel, converged ? router->curr_state : NULL);
+        assert(status == SUCCESS);
+    }
+}
+
+static enum reactor_step router_step(reactor_task_t* task)
+{
+    router_task_t* router = (router_task_t*)task;
+    if (!router->watching) {
+        // watching from inside the first step means no readiness can be missed before it
+        for (size_t i = 0; i < router->total_select_count; i++) {
+            enum channel_status status = channel_watch(router->select_list[i].channel, router->select_list[i].dir, &task->watch);
+            assert(status == SUCCESS);
+        }
+        router->watching = true;
+    }
+    for (size_t budget = 0; budget < ROUTER_STEP_BUDGET; budget++) {
+        bool progress = false;
+        void* data = NULL;
+        enum channel_status status = channel_non_blocking_receive(channels[router->index], &data);
+        assert(status != CLOSED_ERROR);
+        if (status == SUCCESS) {
+            router_task_handle(router, data);
+            progress = true;
+        }
+        for (size_t i = 2; i < router->select_count;) {
+            status = channel_non_blocking_send(router->select_list[i].channel, router->select_list[i].data);
+            assert(status != CLOSED_ERROR);
+            if (status == SUCCESS) {
+                router->select_count--;
+                // swap last element and sent element
+                channel_t* temp = router->select_list[router->select_count].channel;
+                router->select_list[router->select_count].channel = router->select_list[i].channel;
+                router->select_list[i].channel = temp;
+                progress = true;
+            } else {
+                i++;
+            }
+        }
+        if (router->select_count == 2 && router->changed) {
+            // receivers of the last broadcast that are still behind keep it alive
+            msg_release(router->curr_state);
+            router->curr_state = router->next_state;
+            router->next_state = msg_alloc(vector_pool);
+            router->next_state->src = router->index;
+            router->next_state->epoch = router->curr_state->epoch + 1;
+            memcpy(router->next_state->dist, router->curr_state->dist, sizeof(distance_t) * num_channel);
+            // reset to broadcast again
+            router->select_count = router->total_select_count;
+            atomic_fetch_add(&credits, router->total_select_count - 2);
+            msg_retain(router->curr_state, router->total_select_count - 2);
+            for (size_t i = 2; i < router->select_count; i++) {
+                router->select_list[i].data = router->curr_state;
+            }
+            router->changed = false;
+            progress = true;
+        }
+        if (router->active && router->select_count == 2 && !router->changed) {
+            router->active = false;
+            release_credits(1);
+        }
+        if (!progress) {
+            // idle routers are the only ones that need to look for the stop signal
+            status = channel_non_blocking_receive(done_channel, &data);
+            if (status == CLOSED_ERROR) {
+                assert(!router->changed);
+                router_task_destroy(router);
+                return REACTOR_DONE;
+            }
+            return REACTOR_WAIT;
+        }
+    }
+    return REACTOR_YIELD;
+}
+
+// Collects the final distance vector of every router and checks it against the solution
+void check_results()
 {
-    bool valid = true;
     enum channel_status status;
     distance_vector_t** completed = malloc(sizeof(distance_vector_t*) * num_channel);
     assert(completed != NULL);
-    // validate by sending special NULL message to flush channels
     for (size_t i = 0; i < num_channel; i++) {
         status = channel_send(channels[i], NULL);
         assert(status == SUCCESS);
     }
-    // receive special response
     for (size_t i = 0; i < num_channel; i++) {
         void* data = NULL;
         status = channel_receive(completed_channel, &data);
         assert(status == SUCCESS);
-        if (data == NULL) {
-            valid = false;
-        } else {
-            distance_vector_t* new_data = (distance_vector_t*)data;
-            size_t index = new_data->src;
-            completed[index] = new_data;
-        }
+        // the network is quiescent, so every router must have converged
+        assert(data != NULL);
+        distance_vector_t* new_data = (distance_vector_t*)data;
+        completed[new_data->src] = new_data;
     }
-    if (valid) {
-        // ensure epoch hasn't changed since first validation
-        for (size_t i = 0; i < num_channel; i++) {
-            status = channel_send(channels[i], NULL);
-            assert(status == SUCCESS);
-        }
-        // receive special response
-        for (size_t i = 0; i < num_channel; i++) {
-            void* data = NULL;
-            status = channel_receive(completed_channel, &data);
-            assert(status == SUCCESS);
-            if (data == NULL) {
-                valid = false;
-            } else {
-                distance_vector_t* new_data = (distance_vector_t*)data;
-                size_t index = new_data->src;
-                if (completed[index]->epoch != new_data->epoch) {
-                    valid = false;
-                }
-            }
-        }
-        if (valid) {
-            // check results
-            for (size_t src = 0; src < num_channel; src++) {
-                for (size_t dst = 0; dst < num_channel; dst++) {
-                    assert(completed[src]->dist[dst] == get_solution_distance(src, dst));
-                }
-            }
+    distance_t* expected = malloc(sizeof(distance_t) * num_channel);
+    assert(expected != NULL);
+    for (size_t src = 0; src < num_channel; src++) {
+        get_solution_row(src, expected);
+        for (size_t dst = 0; dst < num_channel; dst++) {
+            assert(completed[src]->dist[dst] == expected[dst]);
         }
     }
+    free(expected);
     free(completed);
-    return valid;
 }
 
-void run_stress(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename)
+// Runs one thread per router with router_fn, or every router as a task of reactor if it is not NULL
+static void run_routers(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename, void* (*router_fn)(void*), reactor_t* reactor)
 {
     assert(main_buffer_size <= 1); // only support up to a buffer size of 1
     assert(secondary_buffer_size <= 1); // only support up to a buffer size of 1
@@ -309,33 +612,71 @@ void run_stress(size_t main_buffer_size, size_t secondary_buffer_size, const cha
     assert(initialized);
     channels = malloc(sizeof(channel_t*) * num_channel);
     assert(channels != NULL);
+    // the channels live exactly as long as this run, so they and their list nodes come from one arena
+    arena_t* arena = arena_create(64 * 1024);
+    allocator_t allocator = arena_allocator(arena);
     for (size_t i = 0; i < num_channel; i++) {
-        channels[i] = channel_create(main_buffer_size);
+        channels[i] = channel_create_with_allocator(main_buffer_size, &allocator);
         assert(channels[i] != NULL);
     }
-    done_channel = channel_create(secondary_buffer_size);
+    done_channel = channel_create_with_allocator(secondary_buffer_size, &allocator);
     assert(done_channel != NULL);
-    completed_channel = channel_create(secondary_buffer_size);
+    completed_channel = channel_create_with_allocator(secondary_buffer_size, &allocator);
     assert(completed_channel != NULL);
 
     pthread_t* pid = malloc(sizeof(pthread_t) * num_channel);
     assert(pid != NULL);
+    vector_pool = msg_pool_create(sizeof(distance_vector_t) + sizeof(distance_t) * num_channel);
+    // a delta message never holds more than one entry per router
+    delta_pool = msg_pool_create(sizeof(delta_message_t) + sizeof(delta_entry_t) * num_channel);
+    // the reactor's workers are not tied to routers, so only router threads are placed
+    placement = reactor == NULL ? placement_from_env(num_channel) : NULL;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // every router starts out active
+    atomic_store(&credits, num_channel);
     for (size_t i = 0; i < num_channel; i++) {
-        pthread_status = pthread_create(&pid[i], NULL, router, (void*)i);
-        assert(pthread_status == 0);
+        if (reactor != NULL) {
+            router_task_t* router = router_task_create(i);
+            reactor_spawn(reactor, &router->task, router_step);
+        } else {
+            pthread_status = pthread_create(&pid[i], NULL, router_fn, (void*)i);
+            assert(pthread_status == 0);
+        }
     }
 
-    // wait for convergence
-    while (!check_done()) {
-        usleep(1000);
+    // wait for convergence; the last router to go passive sends a single message
+    void* data = NULL;
+    status = channel_receive(completed_channel, &data);
+    assert(status == SUCCESS);
+    assert(data == NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    check_results();
+    if (placement != NULL) {
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        size_t pair_counts[CPU_DISTANCES + 1] = {0};
+        for (size_t src = 0; src < num_channel; src++) {
+            for (size_t e = topology->row_start[src]; e < topology->row_start[src + 1]; e++) {
+                // count each undirected link once
+                if (src < topology->dst[e]) {
+                    pair_counts[placement_distance(placement, src, topology->dst[e])]++;
+                }
+            }
+        }
+        printf("stress %s routers %zu: converged in %.3f s\n", filename, num_channel, seconds);
+        placement_print(stdout, placement, pair_counts);
     }
 
     // stop threads
     status = channel_close(done_channel);
     assert(status == SUCCESS);
     // join threads
-    for (size_t i = 0; i < num_channel; i++) {
-        pthread_join(pid[i], NULL);
+    if (reactor != NULL) {
+        reactor_wait(reactor);
+    } else {
+        for (size_t i = 0; i < num_channel; i++) {
+            pthread_join(pid[i], NULL);
+        }
     }
     // cleanup
     status = channel_destroy(done_channel);
@@ -350,7 +691,30 @@ void run_stress(size_t main_buffer_size, size_t secondary_buffer_size, const cha
         status = channel_destroy(channels[i]);
         assert(status == SUCCESS);
     }
+    arena_destroy(arena);
+    // every message is back in its pool once the network is quiescent and the routers are gone
+    msg_pool_destroy(vector_pool);
+    msg_pool_destroy(delta_pool);
+    placement_free(placement);
+    placement = NULL;
     free(pid);
     free(channels);
     destroy_topology();
 }
+
+void run_stress(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename)
+{
+    run_routers(main_buffer_size, secondary_buffer_size, filename, router, NULL);
+}
+
+void run_stress_delta(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename)
+{
+    run_routers(main_buffer_size, secondary_buffer_size, filename, router_delta, NULL);
+}
+
+void run_stress_reactor(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename, size_t num_threads)
+{
+    reactor_t* reactor = reactor_create(num_threads);
+    run_routers(main_buffer_size, secondary_buffer_size, filename, NULL, reactor);
+    reactor_destroy(reactor);
+}
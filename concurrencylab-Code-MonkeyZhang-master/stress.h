@@ -3,4 +3,11 @@
 
 void run_stress(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename);
 
+// Same as run_stress, but routers send only the distances that improved since their last broadcast
+void run_stress_delta(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename);
+
+// Same as run_stress, but routers are non-blocking state machines run by a pool of num_threads
+// workers (0 picks the number of online CPUs) that steps a router when one of its channels is ready
+void run_stress_reactor(size_t main_buffer_size, size_t secondary_buffer_size, const char* filename, size_t num_threads);
+
 #endif // STRESS_H
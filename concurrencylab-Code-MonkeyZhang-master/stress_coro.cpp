@@ -0,0 +1,225 @@
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "channel_coro.hpp"
+#include "stress_coro.h"
+
+// Port of stress.c to coroutines: every router is a chan::Task instead of a pthread,
+// and all routers share the threads of one chan::Executor
+// The controller (check_done) still runs on the calling thread with blocking operations
+
+extern "C" {
+#include "graph.h"
+}
+
+namespace
+{
+
+struct DistanceVector
+{
+    size_t src;
+    size_t epoch;
+    std::vector<distance_t> dist;
+};
+
+typedef chan::Channel<DistanceVector *, 1> RouterChannel;
+
+const distance_t inf_distance = 0x7fffffff;
+
+struct StressContext
+{
+    size_t num_channel = 0;
+    graph_t *topology = nullptr;
+    std::vector<distance_t> solution;
+    std::vector<RouterChannel *> channels;
+    RouterChannel *done_channel = nullptr;
+    RouterChannel *completed_channel = nullptr;
+
+    distance_t get_link_distance(size_t src, size_t dst) const { return graph_link_distance(topology, src, dst); }
+};
+
+// Same topology loader and solution as stress.c: the graph.c reader, blocked Floyd-Warshall
+// for dense graphs, and Dijkstra per source (in check_done) for sparse ones
+bool create_topology(StressContext &ctx, const char *filename)
+{
+    ctx.topology = graph_read(filename);
+    if (ctx.topology == NULL) {
+        printf("Could not open topology file: %s\n", filename);
+        return false;
+    }
+    ctx.num_channel = ctx.topology->num_nodes;
+    assert(ctx.num_channel > 0);
+    if (ctx.topology->num_edges * 16 >= ctx.num_channel * ctx.num_channel) {
+        ctx.solution.resize(ctx.num_channel * ctx.num_channel);
+        graph_to_dense(ctx.topology, ctx.solution.data());
+        floyd_warshall_blocked(ctx.solution.data(), ctx.num_channel, 0);
+    }
+    return true;
+}
+
+// Same algorithm as router() in stress.c; every blocking call became a co_await
+chan::Task router(StressContext &ctx, size_t index)
+{
+    size_t n = ctx.num_channel;
+    bool changed = false;
+    size_t selected_index;
+    DistanceVector states[4];
+    DistanceVector *prev_prev_state = &states[0];
+    DistanceVector *prev_state = &states[1];
+    DistanceVector *curr_state = &states[2];
+    DistanceVector *next_state = &states[3];
+    for (size_t i = 0; i < 4; i++) {
+        states[i].src = index;
+        states[i].epoch = i;
+        states[i].dist.resize(n);
+        for (size_t j = 0; j < n; j++) {
+            states[i].dist[j] = ctx.get_link_distance(index, j);
+        }
+    }
+    std::vector<chan::SelectEntry<DistanceVector *, 1>> select_list;
+    select_list.push_back({ctx.done_channel, RECV, nullptr});
+    select_list.push_back({ctx.channels[index], RECV, nullptr});
+    for (size_t e = ctx.topology->row_start[index]; e < ctx.topology->row_start[index + 1]; e++) {
+        select_list.push_back({ctx.channels[ctx.topology->dst[e]], SEND, curr_state});
+    }
+    size_t total_select_count = select_list.size();
+    size_t select_count = total_select_count;
+    while (true) {
+        enum channel_status status = co_await chan::async_select(select_list.data(), select_count, selected_index);
+        if (status == SUCCESS) {
+            assert(selected_index != 0);
+            if (selected_index == 1) {
+                if (select_list[selected_index].data) {
+                    // update next_state with new data
+                    DistanceVector *neighbor_state = select_list[selected_index].data;
+                    distance_t neighbor_dist = ctx.get_link_distance(index, neighbor_state->src);
+                    assert(neighbor_dist != inf_distance);
+                    for (size_t i = 0; i < n; i++) {
+                        distance_t new_dist = neighbor_dist + neighbor_state->dist[i];
+                        if (new_dist < next_state->dist[i]) {
+                            next_state->dist[i] = new_dist;
+                            changed = true;
+                        }
+                    }
+                } else {
+                    // special message sent to test convergence
+                    bool converged = (select_count == 2) && !changed;
+                    status = co_await chan::async_send(*ctx.completed_channel, converged ? curr_state : nullptr);
+                    assert(status == SUCCESS);
+                }
+            } else {
+                select_count--;
+                // swap last element and selected element
+                std::swap(select_list[select_count].channel, select_list[selected_index].channel);
+            }
+            // check if we've sent to everyone
+            if (select_count == 2 && changed) {
+                // cycle triple buffer
+                DistanceVector *temp_state = curr_state;
+                curr_state = next_state;
+                next_state = prev_prev_state;
+                prev_prev_state = prev_state;
+                prev_state = temp_state;
+                next_state->epoch = curr_state->epoch + 1;
+                next_state->dist = curr_state->dist;
+                // reset to broadcast again
+                select_count = total_select_count;
+                for (size_t i = 2; i < select_count; i++) {
+                    select_list[i].data = curr_state;
+                }
+                changed = false;
+            }
+        } else {
+            assert(status == CLOSED_ERROR);
+            assert(selected_index == 0);
+            assert(changed == false);
+            break;
+        }
+    }
+}
+
+bool check_done(StressContext &ctx)
+{
+    size_t n = ctx.num_channel;
+    bool valid = true;
+    enum channel_status status;
+    std::vector<DistanceVector *> completed(n);
+    // validate by sending special NULL message to flush channels
+    for (size_t round = 0; round < 2 && valid; round++) {
+        for (size_t i = 0; i < n; i++) {
+            status = ctx.channels[i]->send(nullptr);
+            assert(status == SUCCESS);
+        }
+        // receive special response
+        for (size_t i = 0; i < n; i++) {
+            DistanceVector *data = nullptr;
+            status = ctx.completed_channel->receive(data);
+            assert(status == SUCCESS);
+            if (data == nullptr) {
+                valid = false;
+            } else if (round == 0) {
+                completed[data->src] = data;
+            } else if (completed[data->src]->epoch != data->epoch) {
+                // epoch changed since the first validation
+                valid = false;
+            }
+        }
+    }
+    if (valid) {
+        // check results
+        std::vector<distance_t> row(n);
+        for (size_t src = 0; src < n; src++) {
+            if (ctx.solution.empty()) {
+                graph_dijkstra(ctx.topology, src, row.data());
+            } else {
+                std::copy(ctx.solution.begin() + (ptrdiff_t)(src * n), ctx.solution.begin() + (ptrdiff_t)((src + 1) * n), row.begin());
+            }
+            for (size_t dst = 0; dst < n; dst++) {
+                assert(completed[src]->dist[dst] == row[dst]);
+            }
+        }
+    }
+    return valid;
+}
+
+} // namespace
+
+void run_stress_coro(size_t num_threads, const char *filename)
+{
+    StressContext ctx;
+    bool initialized = create_topology(ctx, filename);
+    assert(initialized);
+    (void)initialized;
+    for (size_t i = 0; i < ctx.num_channel; i++) {
+        ctx.channels.push_back(new RouterChannel());
+    }
+    ctx.done_channel = new RouterChannel();
+    ctx.completed_channel = new RouterChannel();
+
+    {
+        chan::Executor executor(num_threads);
+        for (size_t i = 0; i < ctx.num_channel; i++) {
+            executor.spawn(router(ctx, i));
+        }
+
+        // wait for convergence
+        while (!check_done(ctx)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // stop routers; the executor destructor waits for them to finish
+        enum channel_status status = ctx.done_channel->close();
+        assert(status == SUCCESS);
+        (void)status;
+    }
+
+    delete ctx.done_channel;
+    delete ctx.completed_channel;
+    for (RouterChannel *channel : ctx.channels) {
+        delete channel;
+    }
+    graph_free(ctx.topology);
+}
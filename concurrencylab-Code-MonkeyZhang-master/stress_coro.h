@@ -0,0 +1,9 @@
+#ifndef STRESS_CORO_H
+#define STRESS_CORO_H
+
+#include <stddef.h>
+
+// Runs the stress.c routing workload with every router as a coroutine on num_threads threads
+void run_stress_coro(size_t num_threads, const char* filename);
+
+#endif // STRESS_CORO_H
@@ -4,17 +4,24 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdatomic.h>
+#include <time.h>
 #include "channel.h"
+#include "placement.h"
 #include "stress_send_recv.h"
 
 static size_t num_channel;
 static channel_t** channels;
 static atomic_bool done;
 static channel_t* main_channel;
+// set from CHANNEL_PLACEMENT; when it is, the throughput of the ring is printed with the placement
+static placement_t* placement;
+static size_t* hops;
 
 void* worker_thread(void* arg)
 {
     size_t index = (size_t)arg;
+    placement_pin(placement, index);
+    size_t passed = 0;
     size_t next_index = index + 1;
     if (next_index >= num_channel) {
         next_index = 0;
@@ -49,8 +56,10 @@ void* worker_thread(void* arg)
             // Pass along message to next thread in ring
             status = channel_send(next_channel, data);
             assert(status == SUCCESS);
+            passed++;
         }
     }
+    hops[index] = passed;
     return NULL;
 }
 
@@ -72,6 +81,9 @@ void run_stress_send_recv(size_t buffer_size, size_t num_threads, double load, u
     }
     main_channel = channel_create(buffer_size);
     assert(main_channel != NULL);
+    placement = placement_from_env(num_channel);
+    hops = calloc(num_channel, sizeof(size_t));
+    assert(hops != NULL);
 
     pthread_t* pid = malloc(sizeof(pthread_t) * num_channel);
     assert(pid != NULL);
@@ -93,10 +105,13 @@ void run_stress_send_recv(size_t buffer_size, size_t num_threads, double load, u
     }
 
     // wait for duration
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     usleep(duration_usec);
 
     // stop test
     atomic_store(&done, true);
+    clock_gettime(CLOCK_MONOTONIC, &end);
     for (size_t msg = 1; msg <= num_msgs; msg++) {
         // pull data from threads
         size_t data = 0;
@@ -119,6 +134,18 @@ void run_stress_send_recv(size_t buffer_size, size_t num_threads, double load, u
         pthread_join(pid[i], NULL);
     }
 
+    if (placement != NULL) {
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        size_t total_hops = 0;
+        size_t pair_counts[CPU_DISTANCES + 1] = {0};
+        for (size_t i = 0; i < num_channel; i++) {
+            total_hops += hops[i];
+            pair_counts[placement_distance(placement, i, (i + 1) % num_channel)]++;
+        }
+        printf("stress_send_recv buffer %zu threads %zu msgs %zu: %.0f hops/s\n", buffer_size, num_channel, num_msgs, (double)total_hops / seconds);
+        placement_print(stdout, placement, pair_counts);
+    }
+
     // cleanup
     status = channel_close(main_channel);
     assert(status == SUCCESS);
@@ -130,6 +157,9 @@ void run_stress_send_recv(size_t buffer_size, size_t num_threads, double load, u
         status = channel_destroy(channels[i]);
         assert(status == SUCCESS);
     }
+    placement_free(placement);
+    placement = NULL;
+    free(hops);
     free(msg_check);
     free(pid);
     free(channels);
@@ -0,0 +1,289 @@
+#include <assert.h>
+#include <sched.h>
+#include "ebr.h"
+#include "lf_queue.h"
+#include "task_pool.h"
+#include "ws_deque.h"
+
+#define CACHE_LINE 64
+// Initial deque size, as a power of 2
+#define DEQUE_LOG_SIZE 8
+// Rounds of looking for work, yielding in between, before a worker goes to sleep
+#define IDLE_ROUNDS 64
+
+typedef struct
+{
+    task_fn_t fn;
+    void *arg;
+    task_group_t *group;
+} task_t;
+
+typedef struct
+{
+    _Alignas(CACHE_LINE) pthread_t thread;
+    task_pool_t *pool;
+    ws_deque_t *deque;
+    uint64_t random; // xorshift state for picking victims
+    // only the worker writes its counters; they are atomic so that stats can read them at any time
+    atomic_size_t executed;
+    atomic_size_t stolen;
+    atomic_size_t sleeps;
+} task_worker_t;
+
+struct task_pool
+{
+    size_t num_workers;
+    task_worker_t *workers;
+    ebr_t *ebr;
+    lf_queue_t *injected;
+    atomic_size_t num_injected;
+    // spawned tasks not yet taken by a worker; a worker only sleeps when it is 0
+    _Alignas(CACHE_LINE) atomic_size_t queued;
+    atomic_size_t sleepers;
+    atomic_bool stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond; // a task was spawned, or the pool is stopping
+    pthread_cond_t done_cond; // a group's last task finished
+};
+
+// The worker running on this thread, or NULL outside any pool
+static _Thread_local task_worker_t *current_worker;
+
+static task_worker_t *worker_of(task_pool_t *pool)
+{
+    return current_worker != NULL && current_worker->pool == pool ? current_worker : NULL;
+}
+
+void task_group_init(task_group_t *group)
+{
+    atomic_init(&group->pending, 0);
+    atomic_init(&group->waiters, 0);
+}
+
+void task_pool_spawn(task_pool_t *pool, task_group_t *group, task_fn_t fn, void *arg)
+{
+    task_t *task = malloc(sizeof(task_t));
+    assert(task != NULL);
+    task->fn = fn;
+    task->arg = arg;
+    task->group = group;
+    atomic_fetch_add(&group->pending, 1);
+    // counted before it is visible, so a worker that saw queued == 0 is sure to be woken below
+    atomic_fetch_add(&pool->queued, 1);
+    task_worker_t *worker = worker_of(pool);
+    if (worker != NULL)
+    {
+        ws_deque_push(worker->deque, task);
+    }
+    else
+    {
+        lf_queue_enqueue(pool->injected, task);
+        atomic_fetch_add_explicit(&pool->num_injected, 1, memory_order_relaxed);
+    }
+    if (atomic_load(&pool->sleepers) > 0)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->work_cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+static uint64_t next_random(task_worker_t *worker)
+{
+    uint64_t x = worker->random;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    worker->random = x;
+    return x;
+}
+
+// Takes a task from the worker's own deque, the injection queue or a random victim, in that order
+static task_t *find_task(task_pool_t *pool, task_worker_t *worker)
+{
+    void *task = NULL;
+    bool found = ws_deque_pop(worker->deque, &task) == SUCCESS || lf_queue_dequeue(pool->injected, &task) == SUCCESS;
+    if (!found)
+    {
+        size_t start = (size_t)(next_random(worker) % pool->num_workers);
+        for (size_t i = 0; i < pool->num_workers && !found; i++)
+        {
+            task_worker_t *victim = &pool->workers[(start + i) % pool->num_workers];
+            if (victim != worker && ws_deque_steal(victim->deque, &task) == SUCCESS)
+            {
+                atomic_fetch_add_explicit(&worker->stolen, 1, memory_order_relaxed);
+                found = true;
+            }
+        }
+    }
+    if (!found)
+    {
+        return NULL;
+    }
+    atomic_fetch_sub(&pool->queued, 1);
+    return task;
+}
+
+static void run_task(task_pool_t *pool, task_worker_t *worker, task_t *task)
+{
+    task_group_t *group = task->group;
+    task->fn(pool, task->arg);
+    free(task);
+    atomic_fetch_add_explicit(&worker->executed, 1, memory_order_relaxed);
+    // a waiter counts itself before checking pending, so one of the two sees the other
+    if (atomic_fetch_sub(&group->pending, 1) == 1 && atomic_load(&group->waiters) > 0)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_broadcast(&pool->done_cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    task_worker_t *worker = arg;
+    task_pool_t *pool = worker->pool;
+    current_worker = worker;
+    size_t idle = 0;
+    while (!atomic_load(&pool->stop))
+    {
+        task_t *task = find_task(pool, worker);
+        if (task != NULL)
+        {
+            run_task(pool, worker, task);
+            idle = 0;
+        }
+        else if (++idle < IDLE_ROUNDS)
+        {
+            sched_yield();
+        }
+        else
+        {
+            pthread_mutex_lock(&pool->mutex);
+            atomic_fetch_add(&pool->sleepers, 1);
+            if (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop))
+            {
+                atomic_fetch_add_explicit(&worker->sleeps, 1, memory_order_relaxed);
+                pthread_cond_wait(&pool->work_cond, &pool->mutex);
+            }
+            atomic_fetch_sub(&pool->sleepers, 1);
+            pthread_mutex_unlock(&pool->mutex);
+            idle = 0;
+        }
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+task_pool_t *task_pool_create(size_t num_workers)
+{
+    assert(num_workers > 0);
+    task_pool_t *pool = malloc(sizeof(task_pool_t));
+    assert(pool != NULL);
+    pool->num_workers = num_workers;
+    pool->ebr = ebr_create();
+    pool->injected = lf_queue_create(pool->ebr);
+    atomic_init(&pool->num_injected, 0);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stop, false);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->workers = aligned_alloc(CACHE_LINE, sizeof(task_worker_t) * num_workers);
+    assert(pool->workers != NULL);
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        task_worker_t *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->deque = ws_deque_create(DEQUE_LOG_SIZE);
+        worker->random = 0x9e3779b97f4a7c15ull * (i + 1);
+        atomic_init(&worker->executed, 0);
+        atomic_init(&worker->stolen, 0);
+        atomic_init(&worker->sleeps, 0);
+    }
+    // every deque exists before a worker may try to steal from it
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]);
+    }
+    return pool;
+}
+
+void task_pool_wait(task_pool_t *pool, task_group_t *group)
+{
+    task_worker_t *worker = worker_of(pool);
+    if (worker != NULL)
+    {
+        // blocking would take a worker away from the tasks being waited for: run them instead
+        while (atomic_load(&group->pending) > 0)
+        {
+            task_t *task = find_task(pool, worker);
+            if (task != NULL)
+            {
+                run_task(pool, worker, task);
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    atomic_fetch_add(&group->waiters, 1);
+    while (atomic_load(&group->pending) > 0)
+    {
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    atomic_fetch_sub(&group->waiters, 1);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void task_pool_feed(task_pool_t *pool, task_group_t *group, channel_t *channel, task_fn_t fn)
+{
+    void *message;
+    while (channel_receive(channel, &message) == SUCCESS)
+    {
+        task_pool_spawn(pool, group, fn, message);
+    }
+}
+
+void task_pool_stats(task_pool_t *pool, task_pool_stats_t *stats)
+{
+    stats->workers = pool->num_workers;
+    stats->executed = 0;
+    stats->stolen = 0;
+    stats->sleeps = 0;
+    for (size_t i = 0; i < pool->num_workers; i++)
+    {
+        stats->executed += atomic_load_explicit(&pool->workers[i].executed, memory_order_relaxed);
+        stats->stolen += atomic_load_explicit(&pool->workers[i].stolen, memory_order_relaxed);
+        stats->sleeps += atomic_load_explicit(&pool->workers[i].sleeps, memory_order_relaxed);
+    }
+    stats->injected = atomic_load(&pool->num_injected);
+}
+
+void task_pool_destroy(task_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    atomic_store(&pool->stop, true);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->num_workers; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    // only now can no one be stealing from a deque
+    for (size_t i = 0; i < pool->num_workers; i++)
+    {
+        ws_deque_destroy(pool->workers[i].deque);
+    }
+    free(pool->workers);
+    lf_queue_destroy(pool->injected);
+    ebr_destroy(pool->ebr);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
@@ -0,0 +1,55 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "channel.h"
+
+// Fork/join pool of worker threads built on work-stealing deques. A task spawned by a worker goes to
+// the bottom of that worker's own deque and is usually run by the same worker, most recent first,
+// while its cache is still warm; idle workers steal the oldest tasks of a random victim, which in a
+// fork/join tree are the biggest pieces of work left. Tasks spawned from outside the pool go through a
+// shared injection queue. Workers that find nothing to run or steal sleep until a task is spawned.
+typedef struct task_pool task_pool_t;
+
+typedef void (*task_fn_t)(task_pool_t *pool, void *arg);
+
+// Counts the unfinished tasks spawned into it, so their spawner can join them
+typedef struct
+{
+    atomic_size_t pending;
+    atomic_size_t waiters; // threads outside the pool blocked in task_pool_wait, to be woken at the end
+} task_group_t;
+
+typedef struct
+{
+    size_t workers;
+    size_t executed; // tasks run to completion
+    size_t stolen;   // tasks taken from another worker's deque
+    size_t injected; // tasks spawned from outside the pool
+    size_t sleeps;   // times a worker ran out of work and went to sleep
+} task_pool_stats_t;
+
+// Starts num_workers workers
+task_pool_t *task_pool_create(size_t num_workers);
+
+void task_group_init(task_group_t *group);
+
+// Spawns fn(pool, arg) into group; callable from any thread, including from a running task
+void task_pool_spawn(task_pool_t *pool, task_group_t *group, task_fn_t fn, void *arg);
+
+// Returns once every task spawned into group, and every task those spawned into it, has finished
+// A worker waiting here keeps running other tasks instead of blocking; any other thread blocks
+void task_pool_wait(task_pool_t *pool, task_group_t *group);
+
+// Adapter for producers that already speak channels: receives messages from channel and spawns
+// fn(pool, message) for each into group until the channel is closed, then returns
+// Call it from a thread outside the pool; messages still buffered when the channel is closed are not spawned
+void task_pool_feed(task_pool_t *pool, task_group_t *group, channel_t *channel, task_fn_t fn);
+
+void task_pool_stats(task_pool_t *pool, task_pool_stats_t *stats);
+
+// Stops the workers and frees the pool; every group must have been waited for
+void task_pool_destroy(task_pool_t *pool);
+
+#endif // TASK_POOL_H
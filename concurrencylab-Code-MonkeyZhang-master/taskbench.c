@@ -0,0 +1,198 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "channel.h"
+#include "task_pool.h"
+
+// Runs a binary fork/join tree of tasks on the work-stealing pool and on worker threads sharing one
+// MPMC channel of tasks, the way stress_send_recv shares channels, and prints the throughput of each
+#define DEFAULT_DEPTH 16
+#define DEFAULT_LEAF_WORK 1000
+
+static size_t leaf_work;
+static atomic_size_t leaves;
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [WORKERS] [DEPTH] [LEAF_WORK]\n", name);
+}
+
+static double seconds_since(const struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void work()
+{
+    volatile size_t sum = 0;
+    for (size_t i = 0; i < leaf_work; i++) {
+        sum += i;
+    }
+    atomic_fetch_add_explicit(&leaves, 1, memory_order_relaxed);
+}
+
+// Work stealing: a node spawns its two children and joins them, running other tasks meanwhile
+static void pool_node(task_pool_t* pool, void* arg)
+{
+    uintptr_t depth = (uintptr_t)arg;
+    if (depth == 0) {
+        work();
+        return;
+    }
+    task_group_t children;
+    task_group_init(&children);
+    task_pool_spawn(pool, &children, pool_node, (void*)(depth - 1));
+    task_pool_spawn(pool, &children, pool_node, (void*)(depth - 1));
+    task_pool_wait(pool, &children);
+}
+
+// Shared channel: a worker cannot block in a join without starving the tree, so a node instead counts
+// its unfinished children and the last child to finish completes its parent
+typedef struct channel_node {
+    uintptr_t depth;
+    struct channel_node* parent;
+    atomic_size_t pending;
+} channel_node_t;
+
+static channel_t* task_channel;
+static channel_t* done_channel;
+
+static void run_channel_node(channel_node_t* node);
+
+static void complete(channel_node_t* node)
+{
+    while (node != NULL) {
+        channel_node_t* parent = node->parent;
+        free(node);
+        if (parent == NULL) {
+            enum channel_status status = channel_send(done_channel, NULL);
+            assert(status == SUCCESS);
+        } else if (atomic_fetch_sub(&parent->pending, 1) != 1) {
+            break;
+        }
+        node = parent;
+    }
+}
+
+static void submit(uintptr_t depth, channel_node_t* parent)
+{
+    channel_node_t* node = malloc(sizeof(channel_node_t));
+    assert(node != NULL);
+    node->depth = depth;
+    node->parent = parent;
+    atomic_init(&node->pending, 2);
+    // a worker blocked on a full channel could never drain it, so an overflowing task runs right here
+    if (channel_non_blocking_send(task_channel, node) != SUCCESS) {
+        run_channel_node(node);
+    }
+}
+
+static void run_channel_node(channel_node_t* node)
+{
+    if (node->depth == 0) {
+        work();
+        complete(node);
+        return;
+    }
+    submit(node->depth - 1, node);
+    submit(node->depth - 1, node);
+}
+
+static void* channel_worker(void* arg)
+{
+    void* node;
+    while (channel_receive(task_channel, &node) == SUCCESS) {
+        run_channel_node(node);
+    }
+    return NULL;
+}
+
+static double run_pool(size_t workers, uintptr_t depth, task_pool_stats_t* stats)
+{
+    task_pool_t* pool = task_pool_create(workers);
+    task_group_t root;
+    task_group_init(&root);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    task_pool_spawn(pool, &root, pool_node, (void*)depth);
+    task_pool_wait(pool, &root);
+    double seconds = seconds_since(&start);
+    task_pool_stats(pool, stats);
+    task_pool_destroy(pool);
+    return seconds;
+}
+
+static double run_channel(size_t workers, uintptr_t depth, size_t capacity)
+{
+    task_channel = channel_create(capacity);
+    done_channel = channel_create(1);
+    assert(task_channel != NULL && done_channel != NULL);
+    pthread_t* threads = malloc(sizeof(pthread_t) * workers);
+    assert(threads != NULL);
+    for (size_t i = 0; i < workers; i++) {
+        pthread_create(&threads[i], NULL, channel_worker, NULL);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    submit(depth, NULL);
+    void* done;
+    enum channel_status status = channel_receive(done_channel, &done);
+    assert(status == SUCCESS);
+    double seconds = seconds_since(&start);
+    channel_close(task_channel);
+    for (size_t i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    channel_close(done_channel);
+    channel_destroy(task_channel);
+    channel_destroy(done_channel);
+    free(threads);
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = cpus > 0 ? (size_t)cpus : 1;
+    uintptr_t depth = DEFAULT_DEPTH;
+    leaf_work = DEFAULT_LEAF_WORK;
+    if (argc > 1) {
+        workers = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        depth = strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        leaf_work = strtoul(argv[3], NULL, 10);
+    }
+    if (argc > 4 || workers == 0 || depth > 30) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t tasks = ((size_t)2 << depth) - 1;
+    printf("fork/join tree: depth %zu, %zu tasks, leaf work %zu, %zu workers\n", (size_t)depth, tasks, leaf_work, workers);
+
+    atomic_store(&leaves, 0);
+    task_pool_stats_t stats;
+    double seconds = run_pool(workers, depth, &stats);
+    assert(atomic_load(&leaves) == (size_t)1 << depth);
+    printf("work stealing          %8.3f s  %12.0f tasks/s  (%zu stolen, %zu sleeps)\n",
+           seconds, (double)tasks / seconds, stats.stolen, stats.sleeps);
+
+    const size_t capacities[] = {16, 1024};
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        atomic_store(&leaves, 0);
+        seconds = run_channel(workers, depth, capacities[c]);
+        assert(atomic_load(&leaves) == (size_t)1 << depth);
+        printf("channel, capacity %-4zu %8.3f s  %12.0f tasks/s\n", capacities[c], seconds, (double)tasks / seconds);
+    }
+    return 0;
+}
@@ -8,8 +8,25 @@
 #include <sys/resource.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include "stress.h"
 #include "stress_send_recv.h"
+#include "floyd_warshall.h"
+#include "graph.h"
+#include "histogram.h"
+#include "open_loop.h"
+#include "msg_pool.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "spill_channel.h"
+#include "arena.h"
+#include "ebr.h"
+#include "lf_queue.h"
+#include "consumer_pool.h"
+#include "replay.h"
+#include "ws_deque.h"
+#include "task_pool.h"
 
 #define mu_str_(text) #text
 #define mu_str(text) mu_str_(text)
@@ -41,6 +58,7 @@ typedef struct {
 
 typedef struct {
     long double data;
+    perf_sample_t perf;
     pthread_t pid;
 } cpu_args;
 
@@ -171,16 +189,25 @@ uint64_t getTime()
     return convertTimespecToTime(&now);
 }
 
+// Prints the CPU time of a test phase with the perf counters of the same phase,
+// so that high CPU use can be told apart as spinning, cache misses or context switches
+void report_cpu_utilization(const char* test_name, long double cpu_usec, const perf_sample_t* perf) {
+    printf("%s: CPU time %.0Lf us\n", test_name, cpu_usec);
+    perf_sample_print(stdout, test_name, perf);
+}
+
 void* average_cpu_utilization(cpu_args* myargs) {
 
     struct rusage usage1;
     struct rusage usage2;
 
+    perf_phase_t* phase = perf_phase_start();
     getrusage(RUSAGE_SELF, &usage1);
     struct timeval start = usage1.ru_utime;
     struct timeval start_s = usage1.ru_stime;
     sleep(20);
     getrusage(RUSAGE_SELF, &usage2);
+    perf_phase_stop(phase, &myargs->perf);
     struct timeval end = usage2.ru_utime;
     struct timeval end_s = usage2.ru_stime;
     
@@ -1005,6 +1032,7 @@ char* test_cpu_utilization_send() {
 
     sleep(20);
     pthread_join(cpu_pid, NULL);
+    report_cpu_utilization(__func__, args.data, &args.perf);
 
     for (int i = 0; i < THREADS; i++) {
         void* data;
@@ -1045,6 +1073,7 @@ char* test_cpu_utilization_receive() {
 
     sleep(20);
     pthread_join(cpu_pid, NULL);
+    report_cpu_utilization(__func__, args.data, &args.perf);
 
     for (int i = 0; i < THREADS; i++) {
         channel_send(channel, "Message");
@@ -1101,6 +1130,7 @@ char* test_cpu_utilization_select() {
 
     sleep(20);
     pthread_join(cpu_pid, NULL);
+    report_cpu_utilization(__func__, args.data, &args.perf);
 
     for (int i = 0; i < THREADS; i++) {
         channel_send(channel[0], "Message");
@@ -1330,6 +1360,1122 @@ char* test_stress_send_recv_unbuffered() {
     return NULL;
 }
 
+char* test_floyd_warshall_blocked() {
+    print_test_details(__func__, "Testing tiled Floyd-Warshall against the scalar version");
+
+    /* Random sparse graphs whose sizes are not multiples of the tile size,
+     * solved with different thread counts, must match the plain triple loop exactly
+     */
+    size_t sizes[] = {1, 5, 63, 64, 65, 130, 257};
+    size_t threads[] = {1, 3};
+    unsigned int seed = 1;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        distance_t* expected = malloc(sizeof(distance_t) * n * n);
+        distance_t* actual = malloc(sizeof(distance_t) * n * n);
+        for (size_t src = 0; src < n; src++) {
+            for (size_t dst = 0; dst < n; dst++) {
+                distance_t distance = 0x7fffffff;
+                if (src == dst) {
+                    distance = 0;
+                } else if (rand_r(&seed) % 10 < 2) {
+                    distance = (distance_t)(rand_r(&seed) % 100 + 1);
+                }
+                expected[src * n + dst] = distance;
+            }
+        }
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            memcpy(actual, expected, sizeof(distance_t) * n * n);
+            floyd_warshall_blocked(actual, n, threads[t]);
+            if (t == 0) {
+                floyd_warshall_scalar(expected, n);
+            }
+            mu_assert("test_floyd_warshall_blocked: Distances differ from the scalar version", memcmp(actual, expected, sizeof(distance_t) * n * n) == 0);
+        }
+        free(expected);
+        free(actual);
+    }
+    return NULL;
+}
+
+char* test_graph_dijkstra() {
+    print_test_details(__func__, "Testing sparse graph shortest paths against Floyd-Warshall");
+
+    /* Every generated graph must be connected, and Dijkstra from each source
+     * must match Floyd-Warshall on the dense copy of the same graph
+     */
+    graph_t* graphs[] = {graph_generate_random(150, 4, 100, 3),
+                         graph_generate_grid(9, 13, 100, 5),
+                         graph_generate_power_law(200, 2, 100, 7)};
+    for (size_t g = 0; g < sizeof(graphs) / sizeof(graphs[0]); g++) {
+        graph_t* graph = graphs[g];
+        size_t n = graph->num_nodes;
+        distance_t* dense = malloc(sizeof(distance_t) * n * n);
+        distance_t* row = malloc(sizeof(distance_t) * n);
+        graph_to_dense(graph, dense);
+        for (size_t src = 0; src < n; src++) {
+            for (size_t dst = 0; dst < n; dst++) {
+                mu_assert("test_graph_dijkstra: Link distance differs from the dense matrix", graph_link_distance(graph, src, dst) == dense[src * n + dst]);
+            }
+        }
+        floyd_warshall_scalar(dense, n);
+        for (size_t src = 0; src < n; src++) {
+            graph_dijkstra(graph, src, row);
+            mu_assert("test_graph_dijkstra: Distances differ from Floyd-Warshall", memcmp(row, &dense[src * n], sizeof(distance_t) * n) == 0);
+            for (size_t dst = 0; dst < n; dst++) {
+                mu_assert("test_graph_dijkstra: Generated graph is not connected", row[dst] != 0x7fffffff);
+            }
+        }
+        free(dense);
+        free(row);
+        graph_free(graph);
+    }
+    return NULL;
+}
+
+char* test_stress_delta() {
+    print_test_details(__func__, "Stress Testing for routers that send only changed distances");
+    run_stress_delta(1, 1, "topology.txt");
+    run_stress_delta(1, 1, "connected_topology.txt");
+    run_stress_delta(1, 1, "random_topology.txt");
+    run_stress_delta(1, 1, "random_topology_1.txt");
+    run_stress_delta(1, 1, "big_graph.txt");
+    run_stress_delta(1, 1, "grid_topology.txt");
+    run_stress_delta(1, 1, "power_law_topology.txt");
+    return NULL;
+}
+
+static void count_notification(void* arg) {
+    (*(size_t*)arg)++;
+}
+
+char* test_channel_watch() {
+    print_test_details(__func__, "Testing readiness watches");
+
+    /* A RECV watch fires on every send and a SEND watch on every receive,
+     * both fire on close, and an unwatched watch no longer fires
+     */
+    size_t recv_count = 0;
+    size_t send_count = 0;
+    channel_watch_t recv_watch = {count_notification, &recv_count};
+    channel_watch_t send_watch = {count_notification, &send_count};
+    channel_t* channel = channel_create(2);
+    mu_assert("test_channel_watch: Could not watch an open channel", channel_watch(channel, RECV, &recv_watch) == SUCCESS);
+    mu_assert("test_channel_watch: Could not watch an open channel", channel_watch(channel, SEND, &send_watch) == SUCCESS);
+    void* data = NULL;
+    channel_send(channel, "1");
+    channel_non_blocking_send(channel, "2");
+    mu_assert("test_channel_watch: RECV watch should fire once per send", recv_count == 2 && send_count == 0);
+    channel_receive(channel, &data);
+    channel_non_blocking_receive(channel, &data);
+    mu_assert("test_channel_watch: SEND watch should fire once per receive", recv_count == 2 && send_count == 2);
+    mu_assert("test_channel_watch: Failed receive should not fire", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY && send_count == 2);
+    channel_unwatch(channel, SEND, &send_watch);
+    channel_close(channel);
+    mu_assert("test_channel_watch: Close should fire the remaining watch only", recv_count == 3 && send_count == 2);
+    mu_assert("test_channel_watch: Closed channel cannot be watched", channel_watch(channel, SEND, &send_watch) == CLOSED_ERROR);
+    channel_unwatch(channel, RECV, &recv_watch);
+    channel_destroy(channel);
+    return NULL;
+}
+
+char* test_stress_reactor() {
+    print_test_details(__func__, "Stress Testing for routers run by a fixed pool of reactor threads");
+    size_t threads[] = {1, 4};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        run_stress_reactor(1, 1, "topology.txt", threads[t]);
+        run_stress_reactor(1, 1, "connected_topology.txt", threads[t]);
+        run_stress_reactor(1, 1, "random_topology.txt", threads[t]);
+        run_stress_reactor(1, 1, "random_topology_1.txt", threads[t]);
+        run_stress_reactor(1, 1, "big_graph.txt", threads[t]);
+        run_stress_reactor(1, 1, "grid_topology.txt", threads[t]);
+        run_stress_reactor(1, 1, "power_law_topology.txt", threads[t]);
+    }
+    return NULL;
+}
+
+static bool graph_equal(graph_t* a, graph_t* b) {
+    if (a->num_nodes != b->num_nodes || a->num_edges != b->num_edges) {
+        return false;
+    }
+    return memcmp(a->row_start, b->row_start, sizeof(size_t) * (a->num_nodes + 1)) == 0 &&
+           memcmp(a->dst, b->dst, sizeof(size_t) * a->num_edges) == 0 &&
+           memcmp(a->weight, b->weight, sizeof(distance_t) * a->num_edges) == 0;
+}
+
+char* test_graph_read_formats() {
+    print_test_details(__func__, "Testing text and binary topology files load the same graph");
+
+    /* A dense text file and a generated sparse graph must come back unchanged
+     * through the edge-list text format and the binary format (dense and edge list encodings)
+     */
+    const char* text_file = "test_graph_read_formats.txt";
+    const char* binary_file = "test_graph_read_formats.bin";
+    graph_t* dense = graph_read("random_topology.txt");
+    mu_assert("test_graph_read_formats: Could not read the dense text file", dense != NULL);
+    mu_assert("test_graph_read_formats: Could not write the binary file", graph_write_binary(dense, binary_file));
+    graph_t* copy = graph_read(binary_file);
+    mu_assert("test_graph_read_formats: Dense binary file differs", copy != NULL && graph_equal(dense, copy));
+    graph_free(copy);
+    graph_free(dense);
+
+    graph_t* sparse = graph_generate_power_law(500, 3, 100, 13);
+    mu_assert("test_graph_read_formats: Could not write the edge-list file", graph_write_edges(sparse, text_file));
+    copy = graph_read(text_file);
+    mu_assert("test_graph_read_formats: Edge-list text file differs", copy != NULL && graph_equal(sparse, copy));
+    graph_free(copy);
+    mu_assert("test_graph_read_formats: Could not write the binary file", graph_write_binary(sparse, binary_file));
+    copy = graph_read(binary_file);
+    mu_assert("test_graph_read_formats: Edge-list binary file differs", copy != NULL && graph_equal(sparse, copy));
+    graph_free(copy);
+    graph_free(sparse);
+
+    mu_assert("test_graph_read_formats: Missing file should not load", graph_read("does_not_exist.txt") == NULL);
+    remove(text_file);
+    remove(binary_file);
+    return NULL;
+}
+
+char* test_histogram() {
+    print_test_details(__func__, "Testing histogram percentiles stay within the bucket precision");
+    histogram_t* histogram = malloc(sizeof(histogram_t));
+    histogram_t* merged = malloc(sizeof(histogram_t));
+    histogram_init(histogram);
+    histogram_init(merged);
+    mu_assert("test_histogram: Empty histogram should report 0", histogram_percentile(histogram, 50.0) == 0);
+    for (uint64_t value = 1; value <= 100; value++) {
+        histogram_record(histogram, value);
+    }
+    mu_assert("test_histogram: Small values should be exact", histogram_percentile(histogram, 50.0) == 50 &&
+                                                             histogram_percentile(histogram, 100.0) == 100);
+    histogram_init(histogram);
+    for (uint64_t value = 1; value <= 1000000; value++) {
+        histogram_record(value % 2 ? histogram : merged, value * 1000);
+    }
+    histogram_merge(histogram, merged);
+    mu_assert("test_histogram: Wrong count", histogram->count == 1000000);
+    mu_assert("test_histogram: Wrong min or max", histogram->min == 1000 && histogram->max == 1000000000);
+    double percentiles[] = {1.0, 50.0, 90.0, 99.0, 99.9};
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        double exact = percentiles[i] * 1e7;
+        double reported = (double)histogram_percentile(histogram, percentiles[i]);
+        mu_assert("test_histogram: Percentile off by more than the bucket precision",
+                  reported >= exact && reported <= exact * (1.0 + 1.0 / 64));
+    }
+    mu_assert("test_histogram: 100th percentile should be the max", histogram_percentile(histogram, 100.0) == histogram->max);
+    mu_assert("test_histogram: Wrong mean", histogram_mean(histogram) == 500000.5 * 1000);
+    histogram_record(histogram, UINT64_MAX);
+    mu_assert("test_histogram: Largest value should be counted", histogram_percentile(histogram, 100.0) == UINT64_MAX);
+    free(histogram);
+    free(merged);
+    return NULL;
+}
+
+typedef struct {
+    channel_t* channel;
+    size_t count;
+} msg_pool_args;
+
+// Releases count messages received on the channel; the last reference of each is dropped here
+static void* msg_pool_releaser(void* arg) {
+    msg_pool_args* args = arg;
+    for (size_t i = 0; i < args->count; i++) {
+        void* data = NULL;
+        channel_receive(args->channel, &data);
+        msg_release(data);
+    }
+    return NULL;
+}
+
+char* test_msg_pool() {
+    print_test_details(__func__, "Testing message pools recycle objects released on other threads");
+    const size_t count = 64;
+    msg_pool_t* pool = msg_pool_create(sizeof(size_t) * 3);
+    void** sent = malloc(sizeof(void*) * count);
+    channel_t* channel = channel_create(count);
+    msg_pool_args args = {channel, count};
+    for (size_t round = 0; round < 4; round++) {
+        for (size_t i = 0; i < count; i++) {
+            size_t* message = msg_alloc(pool);
+            mu_assert("test_msg_pool: Objects should be aligned like malloc's", (uintptr_t)message % _Alignof(max_align_t) == 0);
+            message[0] = i;
+            message[2] = i;
+            // one reference for this thread, one for the releaser
+            msg_retain(message, 1);
+            if (round == 0) {
+                sent[i] = message;
+            } else {
+                bool recycled = false;
+                for (size_t j = 0; j < count; j++) {
+                    recycled |= sent[j] == message;
+                }
+                mu_assert("test_msg_pool: Released objects should be reused by the allocating thread", recycled);
+            }
+            channel_send(channel, message);
+        }
+        // the last reference of each message is dropped by the releaser in odd rounds, here in even ones
+        if (round % 2 == 1) {
+            for (size_t i = 0; i < count; i++) {
+                msg_release(sent[i]);
+            }
+        }
+        pthread_t pid;
+        pthread_create(&pid, NULL, msg_pool_releaser, &args);
+        pthread_join(pid, NULL);
+        if (round % 2 == 0) {
+            for (size_t i = 0; i < count; i++) {
+                msg_release(sent[i]);
+            }
+        }
+    }
+    channel_close(channel);
+    channel_destroy(channel);
+    free(sent);
+    msg_pool_destroy(pool);
+    return NULL;
+}
+
+char* test_placement() {
+    print_test_details(__func__, "Testing thread placement policies on a two-package machine");
+    // 2 packages x 2 cores x 2 SMT threads, numbered the way Linux usually does
+    cpu_info_t cpus[] = {{0, 0, 0}, {1, 0, 1}, {2, 1, 0}, {3, 1, 1}, {4, 0, 0}, {5, 0, 1}, {6, 1, 0}, {7, 1, 1}};
+    cpu_topology_t machine = {8, cpus};
+    int compact[] = {0, 4, 1, 5, 2, 6, 3, 7};
+    int scatter[] = {0, 2, 1, 3, 4, 6, 5, 7};
+    placement_t* placement = placement_create(&machine, PLACEMENT_COMPACT, 10);
+    for (size_t i = 0; i < 10; i++) {
+        mu_assert("test_placement: Wrong compact placement", placement->cpu_of[i].cpu == compact[i % 8]);
+    }
+    mu_assert("test_placement: Compact neighbours should be SMT siblings", placement_distance(placement, 0, 1) == CPU_SMT_SIBLING);
+    mu_assert("test_placement: Wrong distance across packages", placement_distance(placement, 0, 4) == CPU_OTHER_PACKAGE);
+    placement_free(placement);
+    placement = placement_create(&machine, PLACEMENT_SCATTER, 8);
+    for (size_t i = 0; i < 8; i++) {
+        mu_assert("test_placement: Wrong scatter placement", placement->cpu_of[i].cpu == scatter[i]);
+    }
+    mu_assert("test_placement: Scatter neighbours should be in different packages", placement_distance(placement, 0, 1) == CPU_OTHER_PACKAGE);
+    placement_free(placement);
+    placement = placement_create(&machine, PLACEMENT_RING, 16);
+    for (size_t i = 0; i < 16; i++) {
+        mu_assert("test_placement: Ring placement should keep neighbours together", placement->cpu_of[i].cpu == compact[i / 2]);
+    }
+    mu_assert("test_placement: Wrong distance within a package", placement_distance(placement, 1, 2) == CPU_SMT_SIBLING &&
+                                                                   placement_distance(placement, 3, 4) == CPU_SAME_PACKAGE);
+    placement_free(placement);
+    placement = placement_create(&machine, PLACEMENT_NONE, 4);
+    mu_assert("test_placement: None should not pin", placement->cpu_of == NULL && placement_distance(placement, 0, 1) == CPU_DISTANCES);
+    placement_free(placement);
+
+    enum placement_policy policy;
+    mu_assert("test_placement: Policy names should parse", placement_parse("ring", &policy) && policy == PLACEMENT_RING &&
+                                                           strcmp(placement_name(PLACEMENT_SCATTER), "scatter") == 0);
+    mu_assert("test_placement: Unknown policy should not parse", !placement_parse("spread", &policy));
+    cpu_topology_t* topology = cpu_topology_read();
+    mu_assert("test_placement: This process should be allowed on some CPU", topology != NULL && topology->num_cpus > 0);
+    cpu_topology_free(topology);
+    return NULL;
+}
+
+typedef struct {
+    channel_t* ping;
+    channel_t* pong;
+    size_t rounds;
+} ping_pong_args;
+
+static void* ping_pong_echo(void* arg) {
+    ping_pong_args* args = arg;
+    for (size_t i = 0; i < args->rounds; i++) {
+        void* data = NULL;
+        channel_receive(args->ping, &data);
+        channel_send(args->pong, data);
+    }
+    return NULL;
+}
+
+char* test_perf_counters() {
+    print_test_details(__func__, "Testing perf counters are collected over every thread of a phase");
+    ping_pong_args args = {channel_create(1), channel_create(1), 1000};
+    // the echo thread starts inside the phase and is counted through the counters it inherits
+    perf_phase_t* phase = perf_phase_start();
+    pthread_t pid;
+    pthread_create(&pid, NULL, ping_pong_echo, &args);
+    for (size_t i = 0; i < args.rounds; i++) {
+        void* data = NULL;
+        channel_send(args.ping, "Message");
+        channel_receive(args.pong, &data);
+        mu_assert("test_perf_counters: Invalid message", string_equal(data, "Message"));
+    }
+    pthread_join(pid, NULL);
+    perf_sample_t perf;
+    perf_phase_stop(phase, &perf);
+    perf_sample_print(stdout, __func__, &perf);
+    mu_assert("test_perf_counters: The calling thread should be counted", perf.threads >= 1);
+    // every round trip blocks one side or the other
+    mu_assert("test_perf_counters: Blocking ping-pong should switch contexts",
+              !perf.available[PERF_CONTEXT_SWITCHES] || perf.value[PERF_CONTEXT_SWITCHES] > 0);
+    channel_close(args.ping);
+    channel_destroy(args.ping);
+    channel_close(args.pong);
+    channel_destroy(args.pong);
+    return NULL;
+}
+
+// Fills message with a pattern that depends on its sequence number; returns its length
+static size_t spill_test_message(size_t seq, char* message) {
+    size_t size = 1 + (seq * 37) % 300;
+    for (size_t i = 0; i < size; i++) {
+        message[i] = (char)(seq + i);
+    }
+    return size;
+}
+
+typedef struct {
+    spill_channel_t* channel;
+    size_t count;
+} spill_args;
+
+static void* spill_sender(void* arg) {
+    spill_args* args = arg;
+    char message[512];
+    for (size_t seq = 0; seq < args->count; seq++) {
+        size_t size = spill_test_message(seq, message);
+        enum channel_status status = spill_channel_send(args->channel, message, size);
+        assert(status == SUCCESS);
+    }
+    return NULL;
+}
+
+// Receives count messages and checks they arrive complete and in order
+static bool spill_receive_all(spill_channel_t* channel, size_t count) {
+    char expected[512];
+    char message[512];
+    for (size_t seq = 0; seq < count; seq++) {
+        size_t size = 0;
+        if (spill_channel_receive(channel, message, sizeof(message), &size) != SUCCESS) {
+            return false;
+        }
+        if (size != spill_test_message(seq, expected) || memcmp(message, expected, size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+char* test_spill_channel() {
+    print_test_details(__func__, "Testing the spill channel overflows to disk and reads back in order");
+    const size_t count = 5000;
+    size_t segment_size = (size_t)sysconf(_SC_PAGESIZE);
+    mu_assert("test_spill_channel: Segments must be whole pages", spill_channel_create(4, ".", segment_size + 1, 0) == NULL);
+    spill_channel_t* channel = spill_channel_create(4, ".", segment_size, 0);
+    mu_assert("test_spill_channel: Could not create the channel", channel != NULL);
+    char message[512];
+    size_t size = 0;
+    mu_assert("test_spill_channel: Oversized message should be rejected",
+              spill_channel_send(channel, message, segment_size) == GEN_ERROR);
+    mu_assert("test_spill_channel: Empty channel", spill_channel_non_blocking_receive(channel, message, sizeof(message), &size) == CHANNEL_EMPTY);
+
+    // a burst without a receiver never blocks the sender
+    spill_args args = {channel, count};
+    spill_sender(&args);
+    spill_channel_stats_t stats;
+    spill_channel_stats(channel, &stats);
+    mu_assert("test_spill_channel: The ring should be full", stats.memory_messages == 4);
+    mu_assert("test_spill_channel: The rest should be on disk", stats.spilled_messages == count - 4 && stats.segments > 1);
+    mu_assert("test_spill_channel: Small receive buffer should keep the message",
+              spill_channel_non_blocking_receive(channel, message, 0, &size) == GEN_ERROR && size == spill_test_message(0, message));
+    mu_assert("test_spill_channel: Messages out of order", spill_receive_all(channel, count));
+    spill_channel_stats(channel, &stats);
+    mu_assert("test_spill_channel: Drained segments should be released", stats.spilled_messages == 0 && stats.segments <= 3);
+
+    // concurrent sender and receiver, with the disk limited to two segments
+    spill_channel_t* limited = spill_channel_create(4, ".", segment_size, 2);
+    args.channel = limited;
+    pthread_t pid;
+    pthread_create(&pid, NULL, spill_sender, &args);
+    usleep(100000);
+    spill_channel_stats(limited, &stats);
+    mu_assert("test_spill_channel: Sender should block at the disk limit", stats.segments <= 2 && stats.spilled_messages < count);
+    mu_assert("test_spill_channel: Messages out of order", spill_receive_all(limited, count));
+    pthread_join(pid, NULL);
+
+    mu_assert("test_spill_channel: Open channel should not be destroyed", spill_channel_destroy(channel) == DESTROY_ERROR);
+    spill_channel_close(channel);
+    mu_assert("test_spill_channel: Closed channel", spill_channel_send(channel, message, 1) == CLOSED_ERROR &&
+                                                    spill_channel_receive(channel, message, sizeof(message), &size) == CLOSED_ERROR);
+    mu_assert("test_spill_channel: Destroy failed", spill_channel_destroy(channel) == SUCCESS);
+    spill_channel_close(limited);
+    spill_channel_destroy(limited);
+    return NULL;
+}
+
+char* test_select_policy() {
+    print_test_details(__func__, "Testing select policies when several channels are ready");
+    const size_t CHANNELS = 3;
+    const size_t ROUNDS = 600;
+    channel_t* channel[CHANNELS];
+    select_t list[CHANNELS];
+    for (size_t i = 0; i < CHANNELS; i++) {
+        channel[i] = channel_create(ROUNDS);
+        list[i].channel = channel[i];
+        list[i].dir = RECV;
+    }
+    enum select_policy kinds[] = {SELECT_FIRST, SELECT_ROUND_ROBIN, SELECT_RANDOM, SELECT_WEIGHTED};
+    unsigned int weights[] = {1, 2, 0};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        // every channel stays ready for the whole round
+        for (size_t i = 0; i < CHANNELS; i++) {
+            while (channel_non_blocking_send(channel[i], "Message") == SUCCESS) {
+            }
+        }
+        select_policy_t policy;
+        select_policy_init(&policy, kinds[k], weights, 42);
+        size_t counts[3] = {0, 0, 0};
+        for (size_t round = 0; round < ROUNDS / 2; round++) {
+            size_t index = CHANNELS;
+            mu_assert("test_select_policy: Select failed", channel_select_policy(list, CHANNELS, &index, &policy) == SUCCESS);
+            mu_assert("test_select_policy: Invalid message", string_equal(list[index].data, "Message"));
+            if (kinds[k] == SELECT_ROUND_ROBIN) {
+                mu_assert("test_select_policy: Round robin should cycle through the entries", index == round % CHANNELS);
+            }
+            counts[index]++;
+            // refill so the entry stays ready
+            channel_non_blocking_send(channel[index], "Message");
+        }
+        if (kinds[k] == SELECT_FIRST) {
+            mu_assert("test_select_policy: First should always pick index 0", counts[0] == ROUNDS / 2);
+        } else if (kinds[k] == SELECT_RANDOM) {
+            for (size_t i = 0; i < CHANNELS; i++) {
+                mu_assert("test_select_policy: Random should spread over all entries", counts[i] > ROUNDS / 12);
+            }
+        } else if (kinds[k] == SELECT_WEIGHTED) {
+            mu_assert("test_select_policy: Weight 0 should lose to ready entries", counts[2] == 0);
+            mu_assert("test_select_policy: Weighted selection should follow the weights", counts[1] > counts[0] * 3 / 2 && counts[1] < counts[0] * 3);
+        }
+        for (size_t i = 0; i < CHANNELS; i++) {
+            void* data;
+            while (channel_non_blocking_receive(channel[i], &data) == SUCCESS) {
+            }
+        }
+    }
+
+    // a weight 0 entry is still selected when it is the only one ready
+    channel_non_blocking_send(channel[2], "Message");
+    select_policy_t policy;
+    select_policy_init(&policy, SELECT_WEIGHTED, weights, 7);
+    size_t index = 0;
+    mu_assert("test_select_policy: Only ready entry should be selected", channel_select_policy(list, CHANNELS, &index, &policy) == SUCCESS && index == 2);
+    mu_assert("test_select_policy: NULL policy should behave like channel_select",
+              channel_non_blocking_send(channel[1], "Message") == SUCCESS && channel_select_policy(list, CHANNELS, &index, NULL) == SUCCESS && index == 1);
+    for (size_t i = 0; i < CHANNELS; i++) {
+        channel_close(channel[i]);
+        channel_destroy(channel[i]);
+    }
+    return NULL;
+}
+
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t bytes; // outstanding
+} counting_allocator_t;
+
+static void* counting_alloc(void* ctx, size_t size)
+{
+    counting_allocator_t* counts = ctx;
+    counts->allocs++;
+    counts->bytes += size;
+    return malloc(size);
+}
+
+static void counting_free(void* ctx, void* ptr, size_t size)
+{
+    counting_allocator_t* counts = ctx;
+    counts->frees++;
+    counts->bytes -= size;
+    free(ptr);
+}
+
+static void ignore_notify(void* arg)
+{
+}
+
+char* test_allocator() {
+    print_test_details(__func__, "Testing allocator hooks and the bump arena");
+    counting_allocator_t counts = {0, 0, 0};
+    allocator_t allocator = {counting_alloc, counting_free, &counts};
+
+    // per channel: the channel, its buffer and its list nodes all go through the hooks
+    channel_t* channel = channel_create_with_allocator(4, &allocator);
+    size_t created = counts.allocs;
+    mu_assert("test_allocator: Channel creation should use the allocator", created > 0);
+    channel_watch_t watch = {ignore_notify, NULL};
+    mu_assert("test_allocator: Watch failed", channel_watch(channel, RECV, &watch) == SUCCESS);
+    mu_assert("test_allocator: List nodes should use the allocator", counts.allocs == created + 1);
+    channel_unwatch(channel, RECV, &watch);
+    mu_assert("test_allocator: Send failed", channel_send(channel, "Message") == SUCCESS);
+    void* data = NULL;
+    mu_assert("test_allocator: Receive failed", channel_receive(channel, &data) == SUCCESS);
+    channel_close(channel);
+    channel_destroy(channel);
+    mu_assert("test_allocator: Destroy should free everything it allocated", counts.allocs == counts.frees && counts.bytes == 0);
+
+    // globally: channels created afterwards use the default, and keep it after it is restored
+    allocator_set_default(&allocator);
+    channel = channel_create(0);
+    allocator_set_default(NULL);
+    mu_assert("test_allocator: Default allocator should be used", counts.allocs == 2 * created + 1);
+    channel_close(channel);
+    channel_destroy(channel);
+    mu_assert("test_allocator: Default allocator should free everything", counts.allocs == counts.frees && counts.bytes == 0);
+    list_t* list = list_create();
+    list_insert(list, NULL);
+    list_destroy(list);
+    mu_assert("test_allocator: Restored default should not use the hooks", counts.allocs == 2 * created + 1);
+
+    // arena: churning list nodes reuses freed blocks instead of growing
+    arena_t* arena = arena_create(4096);
+    allocator = arena_allocator(arena);
+    channel_t* channels[8];
+    for (size_t i = 0; i < 8; i++) {
+        channels[i] = channel_create_with_allocator(i, &allocator);
+    }
+    arena_stats_t before, after;
+    arena_stats(arena, &before);
+    for (size_t i = 0; i < 10000; i++) {
+        channel_watch(channels[i % 8], SEND, &watch);
+        channel_unwatch(channels[i % 8], SEND, &watch);
+    }
+    arena_stats(arena, &after);
+    mu_assert("test_allocator: Arena should reuse freed list nodes", after.chunks == before.chunks && after.allocated == before.allocated);
+    // an allocation larger than a chunk gets one of its own
+    channel_t* large = channel_create_with_allocator(4096, &allocator);
+    mu_assert("test_allocator: Large buffer should be usable", channel_send(large, "Message") == SUCCESS && channel_receive(large, &data) == SUCCESS);
+    for (size_t i = 0; i < 8; i++) {
+        channel_close(channels[i]);
+        channel_destroy(channels[i]);
+    }
+    channel_close(large);
+    channel_destroy(large);
+    arena_stats(arena, &after);
+    mu_assert("test_allocator: Arena should account for every free", after.allocated == 0);
+    arena_destroy(arena);
+    return NULL;
+}
+
+static void ebr_test_free(void* ptr, void* ctx)
+{
+    atomic_fetch_add((atomic_size_t*)ctx, 1);
+    free(ptr);
+}
+
+typedef struct {
+    ebr_t* ebr;
+    channel_t* entered;
+    channel_t* leave;
+} ebr_reader_args_t;
+
+static void* ebr_reader(void* arg)
+{
+    ebr_reader_args_t* args = arg;
+    ebr_enter(args->ebr);
+    channel_send(args->entered, NULL);
+    void* data;
+    channel_receive(args->leave, &data);
+    ebr_exit(args->ebr);
+    return NULL;
+}
+
+char* test_ebr() {
+    print_test_details(__func__, "Testing that retired nodes outlive the critical sections that may read them");
+    ebr_t* ebr = ebr_create();
+    atomic_size_t freed;
+    atomic_init(&freed, 0);
+    ebr_reader_args_t args = {ebr, channel_create(1), channel_create(1)};
+    pthread_t reader;
+    pthread_create(&reader, NULL, ebr_reader, &args);
+    void* data;
+    channel_receive(args.entered, &data);
+
+    // several batches, so the epoch is tried many times, but the reader holds it back
+    const size_t RETIRED = 1000;
+    for (size_t i = 0; i < RETIRED; i++) {
+        ebr_retire(ebr, malloc(16), ebr_test_free, &freed);
+    }
+    ebr_stats_t stats;
+    ebr_stats(ebr, &stats);
+    mu_assert("test_ebr: Nothing may be freed while a reader is in its critical section", atomic_load(&freed) == 0 && stats.freed == 0);
+    mu_assert("test_ebr: Epoch should not pass a reader by more than one", stats.epoch <= 1);
+
+    channel_send(args.leave, NULL);
+    pthread_join(reader, NULL);
+    ebr_synchronize(ebr);
+    ebr_stats(ebr, &stats);
+    mu_assert("test_ebr: Synchronize should free everything retired", atomic_load(&freed) == RETIRED && stats.retired == RETIRED && stats.freed == RETIRED);
+    mu_assert("test_ebr: Both threads should have a record", stats.threads == 2);
+
+    // without readers the batches free themselves as they go
+    for (size_t i = 0; i < RETIRED; i++) {
+        ebr_enter(ebr);
+        ebr_retire(ebr, malloc(16), ebr_test_free, &freed);
+        ebr_exit(ebr);
+    }
+    mu_assert("test_ebr: Retired nodes should be freed in batches", atomic_load(&freed) > RETIRED);
+    ebr_destroy(ebr);
+    mu_assert("test_ebr: Destroy should free the rest", atomic_load(&freed) == 2 * RETIRED);
+    channel_close(args.entered);
+    channel_destroy(args.entered);
+    channel_close(args.leave);
+    channel_destroy(args.leave);
+    return NULL;
+}
+
+#define LF_QUEUE_THREADS 4
+#define LF_QUEUE_MESSAGES 20000
+
+typedef struct {
+    lf_queue_t* queue;
+    size_t id;
+    atomic_size_t* received;
+    size_t* counts; // LF_QUEUE_THREADS * LF_QUEUE_MESSAGES, written once per message
+} lf_queue_args_t;
+
+static void* lf_queue_producer(void* arg)
+{
+    lf_queue_args_t* args = arg;
+    for (size_t i = 0; i < LF_QUEUE_MESSAGES; i++) {
+        // 1-based, so no message is NULL
+        lf_queue_enqueue(args->queue, (void*)(args->id * LF_QUEUE_MESSAGES + i + 1));
+    }
+    return NULL;
+}
+
+static void* lf_queue_consumer(void* arg)
+{
+    lf_queue_args_t* args = arg;
+    size_t last[LF_QUEUE_THREADS];
+    for (size_t i = 0; i < LF_QUEUE_THREADS; i++) {
+        last[i] = 0;
+    }
+    while (atomic_load(args->received) < LF_QUEUE_THREADS * LF_QUEUE_MESSAGES) {
+        void* data;
+        if (lf_queue_dequeue(args->queue, &data) != SUCCESS) {
+            sched_yield();
+            continue;
+        }
+        size_t message = (size_t)data - 1;
+        size_t producer = message / LF_QUEUE_MESSAGES;
+        // a consumer sees the messages of each producer in the order they were sent
+        assert(message % LF_QUEUE_MESSAGES + 1 > last[producer]);
+        last[producer] = message % LF_QUEUE_MESSAGES + 1;
+        args->counts[message]++;
+        atomic_fetch_add(args->received, 1);
+    }
+    return NULL;
+}
+
+char* test_lf_queue() {
+    print_test_details(__func__, "Testing the lock-free queue and the reclamation of its segments");
+    ebr_t* ebr = ebr_create();
+    lf_queue_t* queue = lf_queue_create(ebr);
+    void* data;
+    mu_assert("test_lf_queue: New queue should be empty", lf_queue_dequeue(queue, &data) == CHANNEL_EMPTY);
+
+    atomic_size_t received;
+    atomic_init(&received, 0);
+    size_t* counts = calloc(LF_QUEUE_THREADS * LF_QUEUE_MESSAGES, sizeof(size_t));
+    pthread_t producers[LF_QUEUE_THREADS], consumers[LF_QUEUE_THREADS];
+    lf_queue_args_t args[LF_QUEUE_THREADS];
+    for (size_t i = 0; i < LF_QUEUE_THREADS; i++) {
+        args[i] = (lf_queue_args_t){queue, i, &received, counts};
+        pthread_create(&consumers[i], NULL, lf_queue_consumer, &args[i]);
+        pthread_create(&producers[i], NULL, lf_queue_producer, &args[i]);
+    }
+    for (size_t i = 0; i < LF_QUEUE_THREADS; i++) {
+        pthread_join(producers[i], NULL);
+        pthread_join(consumers[i], NULL);
+    }
+    for (size_t i = 0; i < LF_QUEUE_THREADS * LF_QUEUE_MESSAGES; i++) {
+        mu_assert("test_lf_queue: Every message should be received exactly once", counts[i] == 1);
+    }
+    mu_assert("test_lf_queue: Drained queue should be empty", lf_queue_dequeue(queue, &data) == CHANNEL_EMPTY);
+    ebr_stats_t stats;
+    ebr_stats(ebr, &stats);
+    mu_assert("test_lf_queue: Drained segments should be retired", stats.retired > 0 && stats.freed <= stats.retired);
+    lf_queue_destroy(queue);
+    ebr_destroy(ebr);
+    free(counts);
+    return NULL;
+}
+
+static void slow_consume(void* message, void* arg)
+{
+    // about 200us of work per message
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < 200000);
+    atomic_fetch_add((atomic_size_t*)arg, 1);
+}
+
+char* test_consumer_pool() {
+    print_test_details(__func__, "Testing that the consumer pool grows on a backlog and shrinks when idle");
+    const size_t MESSAGES = 2000;
+    channel_t* channel = channel_create(256);
+    atomic_size_t consumed;
+    atomic_init(&consumed, 0);
+    consumer_pool_config_t config = {1, 4, 32, 0.002, 3, 0.05};
+    consumer_pool_t* pool = consumer_pool_create(channel, &config, slow_consume, &consumed);
+
+    // a burst builds a backlog
+    for (size_t i = 0; i < MESSAGES; i++) {
+        mu_assert("test_consumer_pool: Send failed", channel_send(channel, "Message") == SUCCESS);
+    }
+    while (atomic_load(&consumed) < MESSAGES) {
+        usleep(1000);
+    }
+    consumer_pool_stats_t stats;
+    consumer_pool_stats(pool, &stats);
+    mu_assert("test_consumer_pool: Every message should be consumed once", stats.consumed == MESSAGES && atomic_load(&consumed) == MESSAGES);
+    mu_assert("test_consumer_pool: Backlog should add workers", stats.scale_ups > 0 && stats.peak_workers > 1 && stats.peak_workers <= 4);
+    mu_assert("test_consumer_pool: Scale up should be recorded", stats.num_events > 0 && stats.events[0].kind == CONSUMER_POOL_SCALE_UP && stats.events[0].depth >= 32);
+
+    // idle workers retire after the cool-down, one at a time, down to the minimum
+    for (size_t waited = 0; waited < 5000; waited++) {
+        consumer_pool_stats(pool, &stats);
+        if (stats.workers == 1) {
+            break;
+        }
+        usleep(1000);
+    }
+    mu_assert("test_consumer_pool: Idle workers should retire down to the minimum", stats.workers == 1);
+    mu_assert("test_consumer_pool: Every added worker should retire", stats.scale_downs == stats.peak_workers - 1);
+    consumer_pool_event_t last = stats.events[stats.num_events - 1];
+    mu_assert("test_consumer_pool: Scale down should be recorded", last.kind == CONSUMER_POOL_SCALE_DOWN && last.workers == 1);
+    for (size_t i = 1; i < stats.num_events; i++) {
+        if (stats.events[i].kind == CONSUMER_POOL_SCALE_DOWN) {
+            mu_assert("test_consumer_pool: Scale downs should be a cool-down apart from the previous event", stats.events[i].time - stats.events[i - 1].time >= 0.05);
+        }
+    }
+
+    channel_close(channel);
+    consumer_pool_destroy(pool);
+    channel_destroy(channel);
+    return NULL;
+}
+
+// Appends a record for thread on channel 0
+static void trace_op(channel_trace_record_t* records, size_t* count, uint64_t time_ns, uint32_t thread,
+                     enum channel_trace_op op, uint32_t arg, enum channel_status status)
+{
+    records[*count] = (channel_trace_record_t){time_ns, thread, 0, arg, (uint8_t)op, (int8_t)status, 0};
+    (*count)++;
+}
+
+char* test_trace_replay() {
+    print_test_details(__func__, "Testing that recorded channel traces replay against every engine");
+    const size_t MESSAGES = 100;
+    channel_trace_record_t records[2 * MESSAGES + 8];
+    size_t count = 0;
+    // a producer and a consumer 1ms apart, then an empty poll and a close well after the last message
+    const uint64_t GAP = 1000000;
+    const uint64_t END = GAP * MESSAGES + 50000000;
+    trace_op(records, &count, 0, 0, TRACE_CREATE, 1, SUCCESS);
+    for (size_t i = 0; i < MESSAGES; i++) {
+        trace_op(records, &count, GAP * i, 0, i % 2 ? TRACE_SEND : TRACE_SELECT_SEND, 1, SUCCESS);
+        trace_op(records, &count, GAP * i + GAP / 2, 1, i % 2 ? TRACE_RECEIVE : TRACE_SELECT_RECV, 1, SUCCESS);
+    }
+    trace_op(records, &count, END, 1, TRACE_NB_RECEIVE, 0, CHANNEL_EMPTY);
+    trace_op(records, &count, END + GAP, 0, TRACE_CLOSE, 0, SUCCESS);
+    trace_op(records, &count, END + 2 * GAP, 1, TRACE_RECEIVE, 0, CLOSED_ERROR);
+    trace_op(records, &count, END + 3 * GAP, 0, TRACE_DESTROY, 0, SUCCESS);
+
+    char path[] = "/tmp/channel-trace-XXXXXX";
+    int fd = mkstemp(path);
+    mu_assert("test_trace_replay: Could not create a temporary file", fd >= 0);
+    close(fd);
+    mu_assert("test_trace_replay: Write failed", channel_trace_write(path, records, count) == 0);
+    channel_trace_t* trace = channel_trace_load(path);
+    mu_assert("test_trace_replay: Load failed", trace != NULL && trace->num_records == count);
+    // a record naming a channel past the header's count is rejected, not replayed out of bounds
+    channel_trace_record_t bad = records[1];
+    bad.channel = 5;
+    FILE* file = fopen(path, "r+b");
+    mu_assert("test_trace_replay: Could not corrupt the trace", file != NULL &&
+              fseek(file, -(long)(sizeof(channel_trace_record_t) * (count - 1)), SEEK_END) == 0 &&
+              fwrite(&bad, sizeof(bad), 1, file) == 1);
+    fclose(file);
+    mu_assert("test_trace_replay: Out of range channel should fail to load", channel_trace_load(path) == NULL);
+    unlink(path);
+    mu_assert("test_trace_replay: Header should count threads and channels", trace->num_threads == 2 && trace->num_channels == 1);
+    mu_assert("test_trace_replay: Records should survive the round trip", memcmp(trace->records, records, sizeof(channel_trace_record_t) * count) == 0);
+
+    replay_result_t* result = malloc(sizeof(replay_result_t));
+    replay_config_t config = {1.0, 2.0};
+    for (size_t e = 0; e < replay_num_engines; e++) {
+        replay_run(trace, &replay_engines[e], &config, result);
+        mu_assert("test_trace_replay: Every operation but create and destroy should be replayed", result->operations == count - 2);
+        mu_assert("test_trace_replay: Replay should match the recording", result->mismatches == 0 && !result->forced_close);
+        mu_assert("test_trace_replay: Latency should be recorded per operation",
+                  result->latency[TRACE_SEND].count == MESSAGES / 2 && result->latency[TRACE_SELECT_RECV].count == MESSAGES / 2 &&
+                  result->latency[TRACE_CLOSE].count == 1);
+        mu_assert("test_trace_replay: Replay should keep the recorded pace", result->seconds >= (double)END / 1e9);
+    }
+    channel_trace_free(trace);
+
+    // a receive the recording saw complete has no sender here: the replay is unblocked by closing
+    count = 0;
+    trace_op(records, &count, 0, 0, TRACE_CREATE, 0, SUCCESS);
+    trace_op(records, &count, 1000, 0, TRACE_RECEIVE, 0, SUCCESS);
+    channel_trace_t stuck = {count, 1, 1, records};
+    config.grace = 0.05;
+    replay_run(&stuck, &replay_engines[0], &config, result);
+    mu_assert("test_trace_replay: Blocked replay should be force-closed", result->forced_close && result->mismatches == 1);
+    free(result);
+    return NULL;
+}
+
+#define WS_DEQUE_THIEVES 3
+#define WS_DEQUE_ELEMENTS 100000
+
+typedef struct {
+    ws_deque_t* deque;
+    atomic_bool* done;
+    size_t* counts; // per thief, so that counting needs no synchronization
+    size_t stolen;
+} ws_deque_args_t;
+
+static void* ws_deque_thief(void* arg)
+{
+    ws_deque_args_t* args = arg;
+    while (true) {
+        // read before stealing, so nothing pushed before done is missed
+        bool done = atomic_load(args->done);
+        void* data;
+        if (ws_deque_steal(args->deque, &data) == SUCCESS) {
+            args->counts[(size_t)data - 1]++;
+            args->stolen++;
+        } else if (done) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+char* test_ws_deque() {
+    print_test_details(__func__, "Testing the work-stealing deque with an owner and concurrent thieves");
+    // 4 slots, so it has to grow while thieves are reading
+    ws_deque_t* deque = ws_deque_create(2);
+    void* data;
+    mu_assert("test_ws_deque: New deque should be empty", ws_deque_pop(deque, &data) == CHANNEL_EMPTY && ws_deque_steal(deque, &data) == CHANNEL_EMPTY);
+    ws_deque_push(deque, (void*)1);
+    ws_deque_push(deque, (void*)2);
+    ws_deque_push(deque, (void*)3);
+    mu_assert("test_ws_deque: Owner should pop the newest", ws_deque_pop(deque, &data) == SUCCESS && data == (void*)3);
+    mu_assert("test_ws_deque: Thief should steal the oldest", ws_deque_steal(deque, &data) == SUCCESS && data == (void*)1);
+    mu_assert("test_ws_deque: Size should count what is left", ws_deque_size(deque) == 1);
+    mu_assert("test_ws_deque: Last element should be popped", ws_deque_pop(deque, &data) == SUCCESS && data == (void*)2);
+    mu_assert("test_ws_deque: Drained deque should be empty", ws_deque_pop(deque, &data) == CHANNEL_EMPTY);
+
+    atomic_bool done;
+    atomic_init(&done, false);
+    size_t* owner_counts = calloc(WS_DEQUE_ELEMENTS, sizeof(size_t));
+    pthread_t thieves[WS_DEQUE_THIEVES];
+    ws_deque_args_t args[WS_DEQUE_THIEVES];
+    for (size_t i = 0; i < WS_DEQUE_THIEVES; i++) {
+        args[i] = (ws_deque_args_t){deque, &done, calloc(WS_DEQUE_ELEMENTS, sizeof(size_t)), 0};
+        pthread_create(&thieves[i], NULL, ws_deque_thief, &args[i]);
+    }
+    for (size_t i = 1; i <= WS_DEQUE_ELEMENTS; i++) {
+        ws_deque_push(deque, (void*)i);
+        // the owner pops now and then, racing the thieves for the bottom
+        if (i % 3 == 0 && ws_deque_pop(deque, &data) == SUCCESS) {
+            owner_counts[(size_t)data - 1]++;
+        }
+    }
+    // the thieves drain what is left
+    atomic_store(&done, true);
+    size_t stolen = 0;
+    for (size_t i = 0; i < WS_DEQUE_THIEVES; i++) {
+        pthread_join(thieves[i], NULL);
+        stolen += args[i].stolen;
+        for (size_t j = 0; j < WS_DEQUE_ELEMENTS; j++) {
+            owner_counts[j] += args[i].counts[j];
+        }
+        free(args[i].counts);
+    }
+    for (size_t i = 0; i < WS_DEQUE_ELEMENTS; i++) {
+        mu_assert("test_ws_deque: Every element should be taken exactly once", owner_counts[i] == 1);
+    }
+    mu_assert("test_ws_deque: Thieves should have stolen", stolen > 0);
+    mu_assert("test_ws_deque: Drained deque should be empty", ws_deque_size(deque) == 0 && ws_deque_steal(deque, &data) == CHANNEL_EMPTY);
+    ws_deque_destroy(deque);
+    free(owner_counts);
+    return NULL;
+}
+
+#define WS_DEQUE_ROUNDS 100000
+
+char* test_ws_deque_last_element() {
+    print_test_details(__func__, "Testing the owner's pop racing thieves for the deque's only element");
+    ws_deque_t* deque = ws_deque_create(2);
+    atomic_bool done;
+    atomic_init(&done, false);
+    size_t* owner_counts = calloc(WS_DEQUE_ROUNDS, sizeof(size_t));
+    pthread_t thieves[WS_DEQUE_THIEVES];
+    ws_deque_args_t args[WS_DEQUE_THIEVES];
+    for (size_t i = 0; i < WS_DEQUE_THIEVES; i++) {
+        args[i] = (ws_deque_args_t){deque, &done, calloc(WS_DEQUE_ROUNDS, sizeof(size_t)), 0};
+        pthread_create(&thieves[i], NULL, ws_deque_thief, &args[i]);
+    }
+    for (size_t i = 1; i <= WS_DEQUE_ROUNDS; i++) {
+        // every round, the pushed element is the only one left
+        ws_deque_push(deque, (void*)i);
+        void* data = NULL;
+        if (ws_deque_pop(deque, &data) == SUCCESS) {
+            owner_counts[(size_t)data - 1]++;
+        } else {
+            mu_assert("test_ws_deque_last_element: A lost pop should not hand out the element", data == NULL);
+        }
+    }
+    atomic_store(&done, true);
+    for (size_t i = 0; i < WS_DEQUE_THIEVES; i++) {
+        pthread_join(thieves[i], NULL);
+        for (size_t j = 0; j < WS_DEQUE_ROUNDS; j++) {
+            owner_counts[j] += args[i].counts[j];
+        }
+        free(args[i].counts);
+    }
+    for (size_t i = 0; i < WS_DEQUE_ROUNDS; i++) {
+        mu_assert("test_ws_deque_last_element: Every element should be taken exactly once", owner_counts[i] == 1);
+    }
+    ws_deque_destroy(deque);
+    free(owner_counts);
+    return NULL;
+}
+
+#define TASK_POOL_DEPTH 12
+#define TASK_POOL_MESSAGES 1000
+
+typedef struct {
+    atomic_size_t leaves;
+    atomic_size_t fed;
+} task_pool_counts_t;
+
+static task_pool_counts_t task_pool_counts;
+
+static void tree_task(task_pool_t* pool, void* arg)
+{
+    uintptr_t depth = (uintptr_t)arg;
+    if (depth == 0) {
+        atomic_fetch_add(&task_pool_counts.leaves, 1);
+        return;
+    }
+    task_group_t children;
+    task_group_init(&children);
+    task_pool_spawn(pool, &children, tree_task, (void*)(depth - 1));
+    task_pool_spawn(pool, &children, tree_task, (void*)(depth - 1));
+    // a worker joining its children keeps running tasks, so the tree cannot run out of workers
+    task_pool_wait(pool, &children);
+}
+
+static void fed_task(task_pool_t* pool, void* message)
+{
+    atomic_fetch_add(&task_pool_counts.fed, (size_t)message);
+}
+
+typedef struct {
+    task_pool_t* pool;
+    task_group_t* group;
+    channel_t* channel;
+} task_pool_feed_args_t;
+
+static void* task_pool_feeder(void* arg)
+{
+    task_pool_feed_args_t* args = arg;
+    task_pool_feed(args->pool, args->group, args->channel, fed_task);
+    return NULL;
+}
+
+char* test_task_pool() {
+    print_test_details(__func__, "Testing fork/join on the work-stealing pool and feeding it from a channel");
+    atomic_init(&task_pool_counts.leaves, 0);
+    atomic_init(&task_pool_counts.fed, 0);
+    task_pool_t* pool = task_pool_create(4);
+
+    // two trees spawned from outside the pool, joined by one group
+    task_group_t group;
+    task_group_init(&group);
+    task_pool_spawn(pool, &group, tree_task, (void*)TASK_POOL_DEPTH);
+    task_pool_spawn(pool, &group, tree_task, (void*)TASK_POOL_DEPTH);
+    task_pool_wait(pool, &group);
+    mu_assert("test_task_pool: Every leaf should run once", atomic_load(&task_pool_counts.leaves) == (size_t)2 << TASK_POOL_DEPTH);
+    task_pool_stats_t stats;
+    task_pool_stats(pool, &stats);
+    size_t tasks = ((size_t)4 << TASK_POOL_DEPTH) - 2;
+    mu_assert("test_task_pool: Every task should be executed", stats.workers == 4 && stats.executed == tasks);
+    mu_assert("test_task_pool: Only the roots should be injected", stats.injected == 2);
+
+    // the channel adapter
+    channel_t* channel = channel_create(16);
+    task_group_t fed;
+    task_group_init(&fed);
+    task_pool_feed_args_t args = {pool, &fed, channel};
+    pthread_t feeder;
+    pthread_create(&feeder, NULL, task_pool_feeder, &args);
+    for (size_t i = 1; i <= TASK_POOL_MESSAGES; i++) {
+        mu_assert("test_task_pool: Send failed", channel_send(channel, (void*)i) == SUCCESS);
+    }
+    // messages still buffered at the close would not be fed: wait for the feeder to drain the channel
+    size_t messages = 1, blocked = 0;
+    while (messages > 0) {
+        channel_occupancy(channel, &messages, &blocked);
+        sched_yield();
+    }
+    mu_assert("test_task_pool: Close failed", channel_close(channel) == SUCCESS);
+    pthread_join(feeder, NULL);
+    task_pool_wait(pool, &fed);
+    mu_assert("test_task_pool: Every message should become a task", atomic_load(&task_pool_counts.fed) == TASK_POOL_MESSAGES * (TASK_POOL_MESSAGES + 1) / 2);
+    task_pool_stats(pool, &stats);
+    mu_assert("test_task_pool: Fed tasks should be injected", stats.injected == 2 + TASK_POOL_MESSAGES);
+    mu_assert("test_task_pool: Destroy failed", channel_destroy(channel) == SUCCESS);
+    task_pool_destroy(pool);
+    return NULL;
+}
+
+char* test_open_loop() {
+    print_test_details(__func__, "Testing the open-loop load generator at a light load");
+    open_loop_result_t* result = malloc(sizeof(open_loop_result_t));
+    open_loop_config_t config;
+    config.capacity = 16;
+    config.rate = 2000;
+    config.duration = 0.25;
+    config.seed = 3;
+    enum open_loop_engine engines[] = {OPEN_LOOP_RECEIVE, OPEN_LOOP_SELECT};
+    enum open_loop_arrival arrivals[] = {OPEN_LOOP_CONSTANT, OPEN_LOOP_POISSON};
+    for (size_t e = 0; e < 2; e++) {
+        for (size_t a = 0; a < 2; a++) {
+            config.engine = engines[e];
+            config.arrival = arrivals[a];
+            open_loop_run(&config, result);
+            mu_assert("test_open_loop: Every scheduled message should be received", result->latency.count == 500);
+            mu_assert("test_open_loop: Light load should not saturate the channel", result->achieved_rate > 0.9 * config.rate);
+            mu_assert("test_open_loop: Latency should be measured from the intended send time", result->latency.max < 1000000000);
+        }
+    }
+    free(result);
+    return NULL;
+}
+
+char* test_stress_sparse() {
+    print_test_details(__func__, "Stress Testing for buffered channels on generated sparse topologies");
+    run_stress(1, 1, "grid_topology.txt");
+    run_stress(1, 1, "power_law_topology.txt");
+    return NULL;
+}
+
 char* test_cpu_utilization_overall() {
     print_test_details(__func__, "Testing overall CPU utilization (takes around 20 seconds)");
 
@@ -1378,6 +2524,7 @@ char* test_cpu_utilization_overall() {
     struct rusage usage1;
     struct rusage usage2;
 
+    perf_phase_t* phase = perf_phase_start();
     getrusage(RUSAGE_SELF, &usage1);
     struct timeval start = usage1.ru_utime;
     struct timeval start_s = usage1.ru_stime;
@@ -1388,10 +2535,13 @@ char* test_cpu_utilization_overall() {
         usleep(10000);
     }
     getrusage(RUSAGE_SELF, &usage2);
+    perf_sample_t perf;
+    perf_phase_stop(phase, &perf);
     struct timeval end = usage2.ru_utime;
     struct timeval end_s = usage2.ru_stime;
     
     long double result = (end.tv_sec - start.tv_sec)*1000000L + end.tv_usec - start.tv_usec + (end_s.tv_sec - start_s.tv_sec)*1000000L + end_s.tv_usec - start_s.tv_usec;
+    report_cpu_utilization(__func__, result, &perf);
     mu_assert("test_cpu_utilization_overall: CPU Utilization is higher than required", result < 2000000);
     
     for (size_t i = 0; i < THREADS; i++) {
@@ -1431,6 +2581,7 @@ char* test_for_too_many_wakeups() {
     sleep(2);
 
     struct rusage usage1;
+    perf_phase_t* phase = perf_phase_start();
     getrusage(RUSAGE_SELF, &usage1);
     struct timeval start = usage1.ru_utime;
     struct timeval start_s = usage1.ru_stime;
@@ -1444,10 +2595,13 @@ char* test_for_too_many_wakeups() {
 
     struct rusage usage2;
     getrusage(RUSAGE_SELF, &usage2);
+    perf_sample_t perf;
+    perf_phase_stop(phase, &perf);
     struct timeval end = usage2.ru_utime;
     struct timeval end_s = usage2.ru_stime;
 
     long double result = (end.tv_sec - start.tv_sec)*1000000L + end.tv_usec - start.tv_usec + (end_s.tv_sec - start_s.tv_sec)*1000000L + end_s.tv_usec - start_s.tv_usec;
+    report_cpu_utilization(__func__, result, &perf);
     mu_assert("test_for_too_many_wakeups: CPU Utilization is higher than required", result < 200000);
 
     for (size_t i = 0; i < THREADS; i++) {
@@ -2053,6 +3207,28 @@ test_t tests[] = {{"test_initialization", test_initialization},
                   {"test_cpu_utilization_select", test_cpu_utilization_select},
                   {"test_cpu_utilization_overall", test_cpu_utilization_overall},
                   {"test_for_too_many_wakeups", test_for_too_many_wakeups},
+                  {"test_floyd_warshall_blocked", test_floyd_warshall_blocked},
+                  {"test_graph_dijkstra", test_graph_dijkstra},
+                  {"test_stress_sparse", test_stress_sparse},
+                  {"test_graph_read_formats", test_graph_read_formats},
+                  {"test_stress_delta", test_stress_delta},
+                  {"test_channel_watch", test_channel_watch},
+                  {"test_stress_reactor", test_stress_reactor},
+                  {"test_histogram", test_histogram},
+                  {"test_open_loop", test_open_loop},
+                  {"test_msg_pool", test_msg_pool},
+                  {"test_placement", test_placement},
+                  {"test_perf_counters", test_perf_counters},
+                  {"test_spill_channel", test_spill_channel},
+                  {"test_select_policy", test_select_policy},
+                  {"test_allocator", test_allocator},
+                  {"test_ebr", test_ebr},
+                  {"test_lf_queue", test_lf_queue},
+                  {"test_consumer_pool", test_consumer_pool},
+                  {"test_trace_replay", test_trace_replay},
+                  {"test_ws_deque", test_ws_deque},
+                  {"test_ws_deque_last_element", test_ws_deque_last_element},
+                  {"test_task_pool", test_task_pool},
                   //{"test_unbuffered", test_unbuffered},
                   //{"test_non_blocking_unbuffered", test_non_blocking_unbuffered},
                   //{"test_stress_send_recv_unbuffered", test_stress_send_recv_unbuffered},
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "channel.hpp"
+#include "channel_coro.hpp"
+#include "stress_coro.h"
+
+#define mu_str_(text) #text
+#define mu_str(text) mu_str_(text)
+#define mu_assert(message, test) do { if (!(test)) return "FAILURE: See " __FILE__ " Line " mu_str(__LINE__) ": " message; } while (0)
+#define mu_run_test(test) do { const char *message = test(); tests_run++; \
+                                if (message) return message; } while (0)
+
+int tests_run = 0;
+
+static void print_test_details(const char* test_name, const char* message) {
+    printf("Running test case: %s : %s ...\n", test_name, message);
+}
+
+static void wait_a_bit() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+const char* test_cpp_buffered() {
+    print_test_details(__func__, "Testing Channel<T, N> send/receive order and capacity");
+
+    chan::Channel<int, 4> channel;
+    static_assert(chan::Channel<int, 4>::capacity == 4, "capacity is a compile-time constant");
+    for (int i = 0; i < 4; i++) {
+        mu_assert("test_cpp_buffered: Could not send", channel.send(i) == SUCCESS);
+    }
+    mu_assert("test_cpp_buffered: Non-blocking send on a full channel", channel.try_send(4) == CHANNEL_FULL);
+    mu_assert("test_cpp_buffered: Size is not as expected", channel.size() == 4);
+
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        mu_assert("test_cpp_buffered: Could not receive", channel.receive(value) == SUCCESS);
+        mu_assert("test_cpp_buffered: Values are not FIFO", value == i);
+    }
+    mu_assert("test_cpp_buffered: Non-blocking receive on an empty channel", channel.try_receive(value) == CHANNEL_EMPTY);
+
+    // a blocked receiver is woken by a send from another thread
+    enum channel_status out = GEN_ERROR;
+    std::thread receiver([&] { out = channel.receive(value); });
+    wait_a_bit();
+    mu_assert("test_cpp_buffered: Receive did not block", out == GEN_ERROR);
+    channel.send(42);
+    receiver.join();
+    mu_assert("test_cpp_buffered: Receive did not succeed", out == SUCCESS && value == 42);
+
+    mu_assert("test_cpp_buffered: Could not close", channel.close() == SUCCESS);
+    mu_assert("test_cpp_buffered: Closed twice", channel.close() == CLOSED_ERROR);
+    return NULL;
+}
+
+const char* test_cpp_move_only() {
+    print_test_details(__func__, "Testing move-only values through a single-slot channel");
+
+    chan::Channel<std::unique_ptr<int>, 1> channel;
+    const int MESSAGES = 1000;
+    long sum = 0;
+    std::thread receiver([&] {
+        for (int i = 0; i < MESSAGES; i++) {
+            std::unique_ptr<int> value;
+            channel.receive(value);
+            sum += *value;
+        }
+    });
+    for (int i = 0; i < MESSAGES; i++) {
+        channel.send(std::make_unique<int>(i));
+    }
+    receiver.join();
+    mu_assert("test_cpp_move_only: Lost or duplicated values", sum == (long)MESSAGES * (MESSAGES - 1) / 2);
+
+    // a failed non-blocking send must not consume the value
+    std::unique_ptr<int> first = std::make_unique<int>(1);
+    std::unique_ptr<int> second = std::make_unique<int>(2);
+    mu_assert("test_cpp_move_only: Could not send", channel.try_send(first) == SUCCESS);
+    mu_assert("test_cpp_move_only: Send on a full channel", channel.try_send(second) == CHANNEL_FULL);
+    mu_assert("test_cpp_move_only: Failed send moved the value", second != nullptr && *second == 2);
+
+    // values still buffered are destroyed with the channel
+    channel.close();
+    return NULL;
+}
+
+const char* test_cpp_rendezvous() {
+    print_test_details(__func__, "Testing unbuffered Channel<T, 0>");
+
+    chan::Channel<std::string, 0> channel;
+    mu_assert("test_cpp_rendezvous: Send without a receiver", channel.try_send(std::string("early")) == CHANNEL_FULL);
+
+    // send only returns once the receiver has the value
+    enum channel_status out = GEN_ERROR;
+    std::thread sender([&] { out = channel.send(std::string("Message")); });
+    wait_a_bit();
+    mu_assert("test_cpp_rendezvous: Send did not block", out == GEN_ERROR);
+    std::string value;
+    mu_assert("test_cpp_rendezvous: Could not receive", channel.receive(value) == SUCCESS);
+    sender.join();
+    mu_assert("test_cpp_rendezvous: Send did not succeed", out == SUCCESS);
+    mu_assert("test_cpp_rendezvous: Incorrect message", value == "Message");
+
+    // non-blocking send hands off to a blocked receiver
+    std::thread receiver([&] { out = channel.receive(value); });
+    std::string message = "Handoff";
+    enum channel_status sent = CHANNEL_FULL;
+    while (sent == CHANNEL_FULL) {
+        wait_a_bit();
+        sent = channel.try_send(message);
+    }
+    receiver.join();
+    mu_assert("test_cpp_rendezvous: Non-blocking send failed", sent == SUCCESS && out == SUCCESS);
+    mu_assert("test_cpp_rendezvous: Incorrect message", value == "Handoff");
+
+    // close releases a sender whose value was never taken
+    out = GEN_ERROR;
+    sender = std::thread([&] { out = channel.send(std::string("Dropped")); });
+    wait_a_bit();
+    channel.close();
+    sender.join();
+    mu_assert("test_cpp_rendezvous: Send did not see the close", out == CLOSED_ERROR);
+    return NULL;
+}
+
+const char* test_cpp_select() {
+    print_test_details(__func__, "Testing select over channels of different types");
+
+    chan::Channel<int, 1> numbers;
+    chan::Channel<std::string, 2> words;
+    chan::Channel<std::unique_ptr<int>, 1> boxes;
+    int number = 0;
+    std::string word;
+
+    // blocks until one of the channels has data
+    size_t index = 99;
+    enum channel_status out = GEN_ERROR;
+    std::thread selector([&] { out = chan::select(index, chan::recv_case(numbers, number), chan::recv_case(words, word)); });
+    wait_a_bit();
+    mu_assert("test_cpp_select: It isn't blocked as expected", out == GEN_ERROR);
+    words.send("Message");
+    selector.join();
+    mu_assert("test_cpp_select: Returned value doesn't match", out == SUCCESS && index == 1 && word == "Message");
+
+    // the first ready case wins, mixing send and receive cases
+    numbers.send(7);
+    out = chan::select(index, chan::send_case(boxes, std::make_unique<int>(3)), chan::recv_case(numbers, number));
+    mu_assert("test_cpp_select: Did not pick the first ready case", out == SUCCESS && index == 0);
+    out = chan::select(index, chan::send_case(boxes, std::make_unique<int>(4)), chan::recv_case(numbers, number));
+    mu_assert("test_cpp_select: Did not skip the full channel", out == SUCCESS && index == 1 && number == 7);
+
+    // close propagates through select with the index of the closed channel
+    out = GEN_ERROR;
+    selector = std::thread([&] { out = chan::select(index, chan::recv_case(numbers, number), chan::recv_case(words, word)); });
+    wait_a_bit();
+    numbers.close();
+    selector.join();
+    mu_assert("test_cpp_select: Close was not propagated", out == CLOSED_ERROR && index == 0);
+    out = chan::select(index, chan::recv_case(words, word), chan::recv_case(numbers, number));
+    mu_assert("test_cpp_select: Select on a closed channel", out == CLOSED_ERROR && index == 1);
+
+    words.close();
+    boxes.close();
+    return NULL;
+}
+
+// Passes a token around a ring of tasks; every hop suspends the receiving coroutine
+static chan::Task ring_stage(chan::Channel<int, 1>& in, chan::Channel<int, 1>& out, int hops, int* last) {
+    for (int i = 0; i < hops; i++) {
+        int token = 0;
+        co_await chan::async_receive(in, token);
+        *last = token;
+        co_await chan::async_send(out, token + 1);
+    }
+}
+
+static chan::Task select_collector(chan::Channel<int, 1>& numbers, chan::Channel<std::string, 1>& words, int* count) {
+    while (true) {
+        int number;
+        std::string word;
+        size_t index;
+        enum channel_status status = co_await chan::async_select(index, chan::recv_case(numbers, number), chan::recv_case(words, word));
+        if (status != SUCCESS) {
+            break;
+        }
+        (*count)++;
+    }
+}
+
+static chan::Task producer(chan::Channel<int, 1>& numbers, int messages) {
+    for (int i = 0; i < messages; i++) {
+        co_await chan::async_send(numbers, i);
+    }
+}
+
+const char* test_cpp_coro() {
+    print_test_details(__func__, "Testing co_await channel operations on a small executor");
+
+    // many more tasks than threads: a blocked task must not hold a thread
+    const int STAGES = 1000;
+    const int HOPS = 20;
+    std::vector<chan::Channel<int, 1>> ring(STAGES);
+    std::vector<int> last(STAGES, -1);
+    {
+        chan::Executor executor(2);
+        for (int i = 0; i < STAGES; i++) {
+            executor.spawn(ring_stage(ring[(size_t)i], ring[(size_t)(i + 1) % STAGES], HOPS, &last[(size_t)i]));
+        }
+        // inject the token from a plain thread; blocking and coroutine operations interoperate
+        ring[0].send(0);
+        executor.wait();
+    }
+    int token = -1;
+    mu_assert("test_cpp_coro: Token did not come back", ring[0].try_receive(token) == SUCCESS);
+    mu_assert("test_cpp_coro: Token was not passed along every hop", token == STAGES * HOPS);
+    mu_assert("test_cpp_coro: Stage saw the wrong token", last[STAGES - 1] == STAGES * HOPS - 1);
+
+    // select resumes on whichever channel gets data and sees close
+    chan::Channel<int, 1> numbers;
+    chan::Channel<std::string, 1> words;
+    int count = 0;
+    {
+        chan::Executor executor(2);
+        executor.spawn(select_collector(numbers, words, &count));
+        executor.spawn(producer(numbers, 100));
+        for (int i = 0; i < 100; i++) {
+            words.send("Message");
+        }
+        // wait until the collector drained everything, then close to stop it
+        while (numbers.size() > 0 || words.size() > 0 || count < 200) {
+            wait_a_bit();
+        }
+        numbers.close();
+    }
+    mu_assert("test_cpp_coro: Select lost messages", count == 200);
+    words.close();
+    return NULL;
+}
+
+const char* test_cpp_stress_coro() {
+    print_test_details(__func__, "Stress Testing routers as coroutines on 2 threads");
+    const char* files[] = {"topology.txt", "connected_topology.txt", "random_topology.txt", "random_topology_1.txt", "big_graph.txt"};
+    for (const char* file : files) {
+        auto start = std::chrono::steady_clock::now();
+        run_stress_coro(2, file);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("  %s: converged in %.1f ms\n", file, elapsed);
+    }
+    return NULL;
+}
+
+typedef const char* (*test_fn_t)();
+typedef struct {
+    const char* name;
+    test_fn_t test;
+} test_t;
+
+test_t tests[] = {{"test_cpp_buffered", test_cpp_buffered},
+                  {"test_cpp_move_only", test_cpp_move_only},
+                  {"test_cpp_rendezvous", test_cpp_rendezvous},
+                  {"test_cpp_select", test_cpp_select},
+                  {"test_cpp_coro", test_cpp_coro},
+                  {"test_cpp_stress_coro", test_cpp_stress_coro},
+};
+
+size_t num_tests = sizeof(tests)/sizeof(tests[0]);
+
+const char* single_test(test_fn_t test, size_t iters) {
+    for (size_t i = 0; i < iters; i++) {
+        mu_run_test(test);
+    }
+    return NULL;
+}
+
+const char* all_tests(size_t iters) {
+    for (size_t i = 0; i < num_tests; i++) {
+        const char* result = single_test(tests[i].test, iters);
+        if (result != NULL) {
+            return result;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    const char* result = NULL;
+    size_t iters = 1;
+    if (argc == 1) {
+        result = all_tests(iters);
+    } else {
+        if (argc == 3) {
+            iters = (size_t)atoi(argv[2]);
+        }
+        result = "Did not find test";
+        for (size_t i = 0; i < num_tests; i++) {
+            if (strcmp(argv[1], tests[i].name) == 0) {
+                result = single_test(tests[i].test, iters);
+                break;
+            }
+        }
+    }
+    if (result) {
+        printf("%s\n", result);
+    } else {
+        printf("ALL TESTS PASSED\n");
+    }
+    printf("Tests run: %d\n", tests_run);
+    return result != NULL;
+}
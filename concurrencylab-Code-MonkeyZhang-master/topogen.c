@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph.h"
+
+// Generates large sparse topologies for the stress test as edge-list files,
+// and converts any topology file to the binary format that loads without parsing
+// Weights are drawn from 1..MAX_WEIGHT, matching the hand-written topology files
+#define MAX_WEIGHT 100
+
+static void usage(const char* name)
+{
+    printf("Usage: %s random   NODES AVG_DEGREE SEED FILE\n", name);
+    printf("       %s grid     ROWS COLS SEED FILE\n", name);
+    printf("       %s powerlaw NODES EDGES_PER_NODE SEED FILE\n", name);
+    printf("       %s convert  IN_FILE OUT_FILE\n", name);
+}
+
+static int convert(const char* in_filename, const char* out_filename)
+{
+    graph_t* graph = graph_read(in_filename);
+    if (graph == NULL) {
+        printf("Could not open topology file: %s\n", in_filename);
+        return 1;
+    }
+    if (!graph_write_binary(graph, out_filename)) {
+        printf("Could not write topology file: %s\n", out_filename);
+        graph_free(graph);
+        return 1;
+    }
+    printf("%zu nodes, %zu directed edges written to %s\n", graph->num_nodes, graph->num_edges, out_filename);
+    graph_free(graph);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && strcmp(argv[1], "convert") == 0) {
+        return convert(argv[2], argv[3]);
+    }
+    if (argc != 6) {
+        usage(argv[0]);
+        return 1;
+    }
+    size_t a = (size_t)strtoull(argv[2], NULL, 10);
+    size_t b = (size_t)strtoull(argv[3], NULL, 10);
+    unsigned int seed = (unsigned int)strtoul(argv[4], NULL, 10);
+    const char* filename = argv[5];
+
+    graph_t* graph;
+    if (strcmp(argv[1], "random") == 0) {
+        graph = graph_generate_random(a, b, MAX_WEIGHT, seed);
+    } else if (strcmp(argv[1], "grid") == 0) {
+        graph = graph_generate_grid(a, b, MAX_WEIGHT, seed);
+    } else if (strcmp(argv[1], "powerlaw") == 0) {
+        graph = graph_generate_power_law(a, b, MAX_WEIGHT, seed);
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+    if (graph == NULL || graph->num_nodes == 0) {
+        printf("Graph must have at least one node\n");
+        graph_free(graph);
+        return 1;
+    }
+    if (!graph_write_edges(graph, filename)) {
+        printf("Could not write topology file: %s\n", filename);
+        graph_free(graph);
+        return 1;
+    }
+    printf("%zu nodes, %zu directed edges written to %s\n", graph->num_nodes, graph->num_edges, filename);
+    graph_free(graph);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+// Replays a channel trace recorded with `make trace` against one engine, or against every engine
+// in turn so their latencies can be compared on the same workload
+static void usage(const char* name)
+{
+    printf("Usage: %s TRACE [ENGINE|all] [SPEED]\n", name);
+    printf("Engines:");
+    for (size_t i = 0; i < replay_num_engines; i++) {
+        printf(" %s", replay_engines[i].name);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    replay_config_t config = {1.0, 1.0};
+    const replay_engine_t* engine = NULL;
+    if (argc > 2 && strcmp(argv[2], "all") != 0) {
+        engine = replay_engine_find(argv[2]);
+        if (engine == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc > 3) {
+        config.speed = strtod(argv[3], NULL);
+    }
+    channel_trace_t* trace = channel_trace_load(argv[1]);
+    if (trace == NULL) {
+        fprintf(stderr, "%s is not a channel trace\n", argv[1]);
+        return 1;
+    }
+    printf("%s: %zu records, %u threads, %u channels\n", argv[1], trace->num_records, trace->num_threads,
+           trace->num_channels);
+    replay_result_t* result = malloc(sizeof(replay_result_t));
+    for (size_t i = 0; i < replay_num_engines; i++) {
+        if (engine == NULL || engine == &replay_engines[i]) {
+            replay_run(trace, &replay_engines[i], &config, result);
+            replay_print(stdout, &replay_engines[i], result);
+        }
+    }
+    free(result);
+    channel_trace_free(trace);
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ws_deque.h"
+
+#define CACHE_LINE 64
+
+typedef struct ws_array
+{
+    size_t mask; // size - 1, the size being a power of 2
+    struct ws_array *previous; // the array this one replaced, kept until the deque is freed
+    _Atomic(void *) slots[];
+} ws_array_t;
+
+// top and bottom only grow, so an index is never reused while a thief may still hold it
+struct ws_deque
+{
+    _Alignas(CACHE_LINE) atomic_llong top;
+    _Alignas(CACHE_LINE) atomic_llong bottom;
+    _Atomic(ws_array_t *) array;
+};
+
+static ws_array_t *array_create(size_t size, ws_array_t *previous)
+{
+    ws_array_t *array = malloc(sizeof(ws_array_t) + size * sizeof(_Atomic(void *)));
+    assert(array != NULL);
+    array->mask = size - 1;
+    array->previous = previous;
+    return array;
+}
+
+static void *array_get(ws_array_t *array, long long index)
+{
+    return atomic_load_explicit(&array->slots[(size_t)index & array->mask], memory_order_relaxed);
+}
+
+static void array_put(ws_array_t *array, long long index, void *data)
+{
+    atomic_store_explicit(&array->slots[(size_t)index & array->mask], data, memory_order_relaxed);
+}
+
+ws_deque_t *ws_deque_create(size_t log_size)
+{
+    ws_deque_t *deque = aligned_alloc(CACHE_LINE, sizeof(ws_deque_t));
+    assert(deque != NULL);
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, array_create((size_t)1 << log_size, NULL));
+    return deque;
+}
+
+// Copies the live elements into an array twice the size; only the owner calls this
+static ws_array_t *grow(ws_deque_t *deque, ws_array_t *array, long long top, long long bottom)
+{
+    ws_array_t *bigger = array_create(2 * (array->mask + 1), array);
+    for (long long i = top; i < bottom; i++)
+    {
+        array_put(bigger, i, array_get(array, i));
+    }
+    atomic_store_explicit(&deque->array, bigger, memory_order_release);
+    return bigger;
+}
+
+void ws_deque_push(ws_deque_t *deque, void *data)
+{
+    assert(data != NULL);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    ws_array_t *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    if ((size_t)(bottom - top) > array->mask)
+    {
+        array = grow(deque, array, top, bottom);
+    }
+    array_put(array, bottom, data);
+    // publishes the element, and whatever it points to, to the thieves
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+}
+
+enum channel_status ws_deque_pop(ws_deque_t *deque, void **data)
+{
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    ws_array_t *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    // claim the bottom element before looking at top, so a thief cannot take it unnoticed
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return CHANNEL_EMPTY;
+    }
+    void *element = array_get(array, bottom);
+    if (top < bottom)
+    {
+        *data = element;
+        return SUCCESS;
+    }
+    // the last element: whoever moves top first gets it, and only the winner hands it out
+    bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                       memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    if (!won)
+    {
+        return CHANNEL_EMPTY;
+    }
+    *data = element;
+    return SUCCESS;
+}
+
+enum channel_status ws_deque_steal(ws_deque_t *deque, void **data)
+{
+    while (true)
+    {
+        long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+        if (top >= bottom)
+        {
+            return CHANNEL_EMPTY;
+        }
+        ws_array_t *array = atomic_load_explicit(&deque->array, memory_order_acquire);
+        void *element = array_get(array, top);
+        if (atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                    memory_order_relaxed))
+        {
+            *data = element;
+            return SUCCESS;
+        }
+        // another thief or the owner took it; the deque may still hold more
+    }
+}
+
+size_t ws_deque_size(ws_deque_t *deque)
+{
+    long long bottom = atomic_load(&deque->bottom);
+    long long top = atomic_load(&deque->top);
+    return bottom > top ? (size_t)(bottom - top) : 0;
+}
+
+void ws_deque_destroy(ws_deque_t *deque)
+{
+    ws_array_t *array = atomic_load(&deque->array);
+    while (array != NULL)
+    {
+        ws_array_t *previous = array->previous;
+        free(array);
+        array = previous;
+    }
+    free(deque);
+}
@@ -0,0 +1,32 @@
+#ifndef WS_DEQUE_H
+#define WS_DEQUE_H
+
+#include "channel.h"
+
+// Chase-Lev work-stealing deque of non-NULL pointers. One owner thread pushes and pops at the bottom
+// without locks or read-modify-writes, except when it races a thief for the last element; any number
+// of thieves steal from the top with a compare-and-swap. The circular array doubles when it fills up;
+// replaced arrays may still be read by a thief, so they are only freed with the deque.
+typedef struct ws_deque ws_deque_t;
+
+// Creates an empty deque with room for 2^log_size elements before it first grows
+ws_deque_t *ws_deque_create(size_t log_size);
+
+// Pushes data, which must not be NULL, at the bottom; owner only
+void ws_deque_push(ws_deque_t *deque, void *data);
+
+// Pops the most recently pushed element into data; owner only
+// Returns SUCCESS, or CHANNEL_EMPTY if the deque is empty
+enum channel_status ws_deque_pop(ws_deque_t *deque, void **data);
+
+// Steals the oldest element into data; any thread
+// Returns SUCCESS, or CHANNEL_EMPTY if the deque is empty
+enum channel_status ws_deque_steal(ws_deque_t *deque, void **data);
+
+// Returns the number of elements, which may be stale by the time it returns
+size_t ws_deque_size(ws_deque_t *deque);
+
+// Frees the deque and every array it used; no thread may use it anymore
+void ws_deque_destroy(ws_deque_t *deque);
+
+#endif // WS_DEQUE_H
@@ -3,11 +3,31 @@
  *
  * Name: Yufeng Zhang
  *
- * - Segregated free list (9 roots, see pick_root() for details)
- * - First fit
+ * - Segregated free lists: NUM_CLASSES (48) size classes below TREE_MIN,
+ *   see pick_root() for details
+ *   - 32 exact classes, every 16 bytes up to 512 bytes
+ *   - 16 log-linear classes above: 4 per power of 2, from 2^9 up to
+ *     2^TREE_LOG (8 KiB)
+ * - A bitmap of non-empty classes, so the first class that can serve a
+ *   request is found with one find-first-set instead of a list walk
+ * - Good fit: any block of a class above the request's fits, so the head of
+ *   the first non-empty one is taken; only when there is none is the
+ *   request's own class walked for a first fit
+ * - Free blocks of TREE_MIN bytes or more are kept in an AVL tree keyed by
+ *   (size, address) instead, whose nodes live in the blocks' payload:
+ *   best fit, insertion and removal are all O(log n)
  * - Coalescing
  * - Splitting
- * - Sorted free list
+ * - LIFO free lists
+ * - Only free blocks have a footer: bit 1 of every header says whether the
+ *   previous block is allocated, and coalesce only reads the previous
+ *   block's footer when it is not
+ * - Mini blocks of 16 bytes for requests of up to 8 bytes: once free they
+ *   hold only a header and a next ptr, and bit 2 of the following header
+ *   says the previous block is one, so coalesce finds it without a footer
+ *   - their list (class 0) is doubly linked all the same: while a mini
+ *     block is in it, bit 3 of its header is set and the size bits hold
+ *     its prev ptr instead, so unlinking one is O(1)
  * 
  */
 #include <assert.h>
@@ -54,9 +74,29 @@
 // Basic constants
 #define WSIZE 8  // Word and header/footer size (bytes)
 #define DSIZE 16 // Double word size (bytes)
-
-static char *heap_listp; // Pointer to beginning of heap
-static char *root_array[9] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+#define MIN_BLOCK DSIZE // a mini block: header and next ptr once free
+
+// Header bits
+#define ALLOC 1      // this block is allocated
+#define PREV_ALLOC 2 // the previous block is allocated
+#define PREV_MINI 4  // the previous block is a mini block
+#define MINI_FREE 8  // a mini block in class 0; the rest of the header is its prev ptr
+
+// Size classes
+#define EXACT_CLASSES 32 // classes 0..31 hold exactly 16, 32, ..., 512 bytes
+#define EXACT_MAX 512    // largest exact class
+#define LOG_BASE 9       // the log-linear classes start at 2^9
+#define SUB_CLASS_BITS 2 // 4 classes per power of 2
+#define TREE_LOG 13      // blocks of 2^13 bytes or more go to the tree
+#define TREE_MIN (1 << TREE_LOG)
+#define NUM_CLASSES (EXACT_CLASSES + ((TREE_LOG - LOG_BASE) << SUB_CLASS_BITS))
+
+// The class heads, the bitmap and the tree root live at the beginning of
+// the heap, since globals are limited to 128 bytes
+static char *heap_listp;     // Pointer to beginning of heap
+static char *root_array;     // NUM_CLASSES list heads, one word each
+static uint64_t *class_mask; // bit i is set when class i is not empty
+static char *tree_root;      // ptr of the word holding the tree's root
 
 // List of SMALL helper functions
 static size_t align(size_t x);                // rounds up to the nearest multiple of ALIGNMENT
@@ -71,6 +111,11 @@ static bool get_alloc(void *ptr);             // given ptr of header or footer,
 static void set_ptr(void *p, char *val);      // given ptr of a word, set prev|next ptr
 static char *get_ptr(void *bp);               // given ptr of a word, read prev|next ptr
 static void set_prevalloc(void *p);           // given ptr of header or footer, set prev alloc bit
+static void clear_prevalloc(void *p);         // given ptr of header or footer, clear prev alloc bit
+static uint64_t get_prevbits(void *p);        // given ptr of header, read its prev alloc & prev mini bits
+static void set_prevmini(void *p, bool mini); // given ptr of header, set or clear prev mini bit
+static char *get_miniprev(void *bp);          // given ptr of a listed mini block, read its prev ptr
+static void set_miniprev(void *p, char *val);  // given ptr of a mini block, list it with prev ptr val
 
 // List of BIG helper functions
 static void *coalesce(char *bp);                           // coalesce helper function
@@ -80,6 +125,14 @@ static void allocate(char *bp, size_t size);               // allocate helper fu
 static void insert_free(char *new_bp, size_t insert_size); // insert free block into free list
 static void reset_free(char *bp);                          // reset free block in free list
 static int pick_root(size_t size);                         // pick root for insert_free
+static char *get_root(int index);                          // ptr of the word holding a class's list head
+static bool class_fits(int index, size_t size);            // whether every block of a class holds size
+
+// Tree of large free blocks; a node is the payload ptr of a free block
+// word 0: left child, word 1: right child, word 2: parent, word 3: height
+static void tree_insert(char *new_node);  // insert a free block into the tree
+static void tree_remove(char *old_node);  // remove a free block from the tree
+static char *tree_best_fit(size_t size);  // smallest block of at least size, or NULL
 
 // List of mm functions
 bool mm_init(void);
@@ -110,6 +163,11 @@ static char *get_header(void *bp)
 static size_t get_size(void *bp)
 {
     // Given ptr of header|footer, read the size of userspace, including header and footer
+    // a listed mini block keeps its prev ptr where the size would be
+    if (*(uint64_t *)bp & MINI_FREE)
+    {
+        return MIN_BLOCK;
+    }
     //&~0xf to get rid of last 4 bits
     return (size_t)(*(uint64_t *)bp & ~0xf);
 }
@@ -130,6 +188,11 @@ static char *get_nextblk(void *bp)
 
 static char *get_prevblk(void *bp)
 {
+    // a mini block has no footer, but its size is known
+    if (get_prevbits(get_header(bp)) & PREV_MINI)
+    {
+        return (char *)bp - MIN_BLOCK;
+    }
     size_t prev_size = get_size((char *)bp - DSIZE); // go to prev footer and read size
     return (char *)bp - prev_size;
 }
@@ -151,63 +214,304 @@ static char *get_ptr(void *bp)
 
 static void set_prevalloc(void *p)
 {
-    *(uint64_t *)p = *(uint64_t *)p | 2;
+    *(uint64_t *)p = *(uint64_t *)p | PREV_ALLOC;
+}
+
+static void clear_prevalloc(void *p)
+{
+    *(uint64_t *)p = *(uint64_t *)p & ~(uint64_t)PREV_ALLOC;
 }
 
 static bool get_prevalloc(void *ptr)
 {
-    return (bool)(*(unsigned int *)(ptr)&0x2);
+    return (bool)(*(unsigned int *)(ptr)&PREV_ALLOC);
+}
+
+static uint64_t get_prevbits(void *p)
+{
+    return *(uint64_t *)p & (PREV_ALLOC | PREV_MINI);
+}
+
+static void set_prevmini(void *p, bool mini)
+{
+    if (mini)
+    {
+        *(uint64_t *)p = *(uint64_t *)p | PREV_MINI;
+    }
+    else
+    {
+        *(uint64_t *)p = *(uint64_t *)p & ~(uint64_t)PREV_MINI;
+    }
+}
+
+static char *get_miniprev(void *bp)
+{
+    // NULL when the block is the head of class 0
+    return (char *)(*(uint64_t *)get_header(bp) & ~(uint64_t)0xf);
+}
+
+static void set_miniprev(void *p, char *val)
+{
+    // payloads are 16-byte aligned, so the low 4 bits are free for the flags
+    put(get_header(p), (uint64_t)val | MINI_FREE | get_prevbits(get_header(p)));
 }
 
 static int pick_root(size_t size)
 {
-    // pick root based on size
-    int root_index = 8;
-    if (size <= 32)
+    // exact classes: every block in the list has the same size
+    if (size <= EXACT_MAX)
+    {
+        return (int)(size / DSIZE) - 1;
+    }
+    // log-linear classes: the power of 2, then which quarter of it
+    int log = 63 - __builtin_clzll(size);
+    int sub = (int)(size >> (log - SUB_CLASS_BITS)) & ((1 << SUB_CLASS_BITS) - 1);
+    return EXACT_CLASSES + ((log - LOG_BASE) << SUB_CLASS_BITS) + sub;
+}
+
+static char *get_root(int index)
+{
+    return root_array + index * WSIZE;
+}
+
+static bool class_fits(int index, size_t size)
+{
+    if (index < EXACT_CLASSES)
+    {
+        return true;
+    }
+    // only the smallest size of a log-linear class is sure to fit in all of its blocks
+    int log = LOG_BASE + ((index - EXACT_CLASSES) >> SUB_CLASS_BITS);
+    size_t sub = (size_t)((index - EXACT_CLASSES) & ((1 << SUB_CLASS_BITS) - 1));
+    size_t smallest = ((size_t)1 << log) + (sub << (log - SUB_CLASS_BITS));
+    if (smallest <= EXACT_MAX)
+    {
+        // the first log-linear class starts where the exact classes end
+        smallest = EXACT_MAX + DSIZE;
+    }
+    return size == smallest;
+}
+
+static char *tree_left(char *node)
+{
+    return get_ptr(node);
+}
+
+static char *tree_right(char *node)
+{
+    return get_ptr(node + WSIZE);
+}
+
+static char *tree_parent(char *node)
+{
+    return get_ptr(node + DSIZE);
+}
+
+static uint64_t tree_height(char *node)
+{
+    return node == NULL ? 0 : *(uint64_t *)(node + 3 * WSIZE);
+}
+
+// order by size, then by address, so that every key is unique
+static bool tree_less(char *a, char *b)
+{
+    size_t a_size = get_size(get_header(a));
+    size_t b_size = get_size(get_header(b));
+    return a_size < b_size || (a_size == b_size && a < b);
+}
+
+// recompute a node's height from its children
+static void tree_update(char *node)
+{
+    uint64_t left = tree_height(tree_left(node));
+    uint64_t right = tree_height(tree_right(node));
+    put(node + 3 * WSIZE, (left > right ? left : right) + 1);
+}
+
+// make new_child take old_child's place below parent, or at the root if parent is NULL
+static void tree_replace_child(char *parent, char *old_child, char *new_child)
+{
+    if (parent == NULL)
     {
-        root_index = 0;
+        set_ptr(tree_root, new_child);
     }
-    else if (size <= 64)
+    else if (tree_left(parent) == old_child)
     {
-        root_index = 1;
+        set_ptr(parent, new_child);
     }
-    else if (size <= 128)
+    else
     {
-        root_index = 2;
+        set_ptr(parent + WSIZE, new_child);
     }
-    else if (size <= 256)
+    if (new_child != NULL)
     {
-        root_index = 3;
+        set_ptr(new_child + DSIZE, parent);
     }
-    else if (size <= 512)
+}
+
+static char *tree_rotate_right(char *node)
+{
+    char *left = tree_left(node);
+    char *moved = tree_right(left);
+    tree_replace_child(tree_parent(node), node, left);
+    set_ptr(node, moved);
+    if (moved != NULL)
+    {
+        set_ptr(moved + DSIZE, node);
+    }
+    set_ptr(left + WSIZE, node);
+    set_ptr(node + DSIZE, left);
+    tree_update(node);
+    tree_update(left);
+    return left;
+}
+
+static char *tree_rotate_left(char *node)
+{
+    char *right = tree_right(node);
+    char *moved = tree_left(right);
+    tree_replace_child(tree_parent(node), node, right);
+    set_ptr(node + WSIZE, moved);
+    if (moved != NULL)
     {
-        root_index = 4;
+        set_ptr(moved + DSIZE, node);
+    }
+    set_ptr(right, node);
+    set_ptr(node + DSIZE, right);
+    tree_update(node);
+    tree_update(right);
+    return right;
+}
+
+// walk up from node restoring heights and the AVL property; a subtree
+// whose height did not change leaves everything above it as it was
+static void tree_rebalance(char *node)
+{
+    while (node != NULL)
+    {
+        uint64_t old_height = tree_height(node);
+        uint64_t left = tree_height(tree_left(node));
+        uint64_t right = tree_height(tree_right(node));
+        if (left > right + 1)
+        {
+            char *child = tree_left(node);
+            if (tree_height(tree_left(child)) < tree_height(tree_right(child)))
+            {
+                tree_rotate_left(child);
+            }
+            node = tree_rotate_right(node);
+        }
+        else if (right > left + 1)
+        {
+            char *child = tree_right(node);
+            if (tree_height(tree_right(child)) < tree_height(tree_left(child)))
+            {
+                tree_rotate_right(child);
+            }
+            node = tree_rotate_left(node);
+        }
+        else
+        {
+            tree_update(node);
+        }
+        if (tree_height(node) == old_height)
+        {
+            return;
+        }
+        node = tree_parent(node);
     }
-    else if (size <= 1024)
+}
+
+static void tree_insert(char *new_node)
+{
+    char *parent = NULL;
+    char *node = get_ptr(tree_root);
+    while (node != NULL)
     {
-        root_index = 5;
+        parent = node;
+        node = tree_less(new_node, node) ? tree_left(node) : tree_right(node);
     }
-    else if (size <= 8192)
+    set_ptr(new_node, NULL);
+    set_ptr(new_node + WSIZE, NULL);
+    set_ptr(new_node + DSIZE, parent);
+    put(new_node + 3 * WSIZE, 1);
+    if (parent == NULL)
     {
-        root_index = 6;
+        set_ptr(tree_root, new_node);
     }
-    else if (size <= 16384)
+    else if (tree_less(new_node, parent))
     {
-        root_index = 7;
+        set_ptr(parent, new_node);
     }
-    else if (size >= 16384)
+    else
     {
-        root_index = 8;
+        set_ptr(parent + WSIZE, new_node);
     }
-    // printf("pick root index: %d for size %zu\n", root_index, size);
-    return root_index;
-    // return 8;
+    tree_rebalance(parent);
+}
+
+// unlink a node in place, without searching for it from the root
+static void tree_remove(char *old_node)
+{
+    char *left = tree_left(old_node);
+    char *right = tree_right(old_node);
+    char *parent = tree_parent(old_node);
+    if (left == NULL || right == NULL)
+    {
+        tree_replace_child(parent, old_node, left != NULL ? left : right);
+        tree_rebalance(parent);
+        return;
+    }
+    // two children: the successor, which has no left child, takes the node's place
+    char *successor = right;
+    while (tree_left(successor) != NULL)
+    {
+        successor = tree_left(successor);
+    }
+    char *start = tree_parent(successor);
+    tree_replace_child(start, successor, tree_right(successor));
+    if (start == old_node)
+    {
+        // the successor was the right child; it keeps its own right subtree
+        start = successor;
+    }
+    set_ptr(successor, tree_left(old_node));
+    set_ptr(successor + WSIZE, tree_right(old_node));
+    put(successor + 3 * WSIZE, tree_height(old_node));
+    set_ptr(tree_left(successor) + DSIZE, successor);
+    if (tree_right(successor) != NULL)
+    {
+        set_ptr(tree_right(successor) + DSIZE, successor);
+    }
+    tree_replace_child(parent, old_node, successor);
+    tree_rebalance(start);
+}
+
+static char *tree_best_fit(size_t size)
+{
+    char *best = NULL;
+    char *node = get_ptr(tree_root);
+    while (node != NULL)
+    {
+        if (get_size(get_header(node)) >= size)
+        {
+            // fits: look for a smaller one on the left
+            best = node;
+            node = tree_left(node);
+        }
+        else
+        {
+            node = tree_right(node);
+        }
+    }
+    return best;
 }
 
 static void *coalesce(char *bp)
 {
 
-    bool prev_alloc = get_alloc(bp - DSIZE);
+    // the previous block's footer only exists when it is free
+    bool prev_alloc = get_prevalloc(get_header(bp));
     bool next_alloc = get_alloc(get_header(get_nextblk(bp)));
 
     // printf("attempt to coalesce %p\n", bp);
@@ -223,10 +527,12 @@ static void *coalesce(char *bp)
         // delete prev block from free list, before header & footer are updated
         reset_free(prev_blk);
 
-        // update prev header
-        put(get_header(prev_blk), pack(coalesce_size, 0));
+        // update prev header; blocks before a free block are allocated
+        put(get_header(prev_blk), pack(coalesce_size, get_prevbits(get_header(prev_blk))));
         // update curr footer
         put(get_footer(bp), pack(coalesce_size, 0));
+        // the merged block is never a mini block
+        set_prevmini(get_header(get_nextblk(prev_blk)), false);
 
         // printf("case 1: prev free, next allocated\n");
         // printf("curr_blk: %p, size: %zu\n", bp, curr_size);
@@ -245,9 +551,10 @@ static void *coalesce(char *bp)
         reset_free(next_blk);
 
         // update curr header
-        put(get_header(bp), pack(coalesce_size, 0));
+        put(get_header(bp), pack(coalesce_size, get_prevbits(get_header(bp))));
         // update next footer
         put(get_footer(next_blk), pack(coalesce_size, 0));
+        set_prevmini(get_header(get_nextblk(bp)), false);
 
         // printf("case 2: prev allocated, next free\n");
         // printf("curr_blk: %p, size: %zu\n", bp, curr_size);
@@ -269,10 +576,11 @@ static void *coalesce(char *bp)
         reset_free(prev_blk);
         reset_free(next_blk);
 
-        // update prev header
-        put(get_header(prev_blk), pack(coalesce_size, 0));
+        // update prev header; blocks before a free block are allocated
+        put(get_header(prev_blk), pack(coalesce_size, get_prevbits(get_header(prev_blk))));
         // update next footer
         put(get_footer(next_blk), pack(coalesce_size, 0));
+        set_prevmini(get_header(get_nextblk(prev_blk)), false);
 
         // printf("case3 : prev free, next free\n");
         // printf("curr_blk: %p, size: %zu\n", bp, curr_size);
@@ -286,69 +594,80 @@ static void *coalesce(char *bp)
     return bp; // case 4: prev allocated, next allocated
 }
 
-// insert free block into free list
+// insert free block into the tree, or at the head of its class's list
 static void insert_free(char *new_bp, size_t insert_size)
 {
+    if (insert_size >= TREE_MIN)
+    {
+        tree_insert(new_bp);
+        return;
+    }
+    if (insert_size == MIN_BLOCK)
+    {
+        // a mini block has room for the next ptr only; the prev ptr goes in its header
+        char *old_head = get_ptr(get_root(0));
+        set_miniprev(new_bp, NULL);
+        set_ptr(new_bp, old_head);
+        if (old_head != NULL)
+        {
+            set_miniprev(old_head, new_bp);
+        }
+        set_ptr(get_root(0), new_bp);
+        *class_mask |= 1;
+        return;
+    }
+
     // choose root
     int root_index = pick_root(insert_size);
-    char *insert_root = root_array[root_index];
+    char *insert_root = get_root(root_index);
+    char *old_first = get_ptr(insert_root);
 
-    // store ptr in the root
-    char *old_prev = get_ptr(insert_root);
+    set_ptr(insert_root, new_bp);       // set root points to new_bp
+    set_ptr(new_bp, insert_root);       // set new_bp prev points to root
+    set_ptr(new_bp + WSIZE, old_first); // set new_bp next points to old first block
+    if (old_first != NULL)
+    {
+        set_ptr(old_first, new_bp); // set old first block prev points to new_bp
+    }
+    *class_mask |= (uint64_t)1 << root_index;
+}
 
-    // if root is empty, insert new block as first free block
-    if (old_prev == NULL)
+static void reset_free(char *bp)
+{
+    if (get_size(get_header(bp)) >= TREE_MIN)
     {
-        set_ptr(insert_root, new_bp);
-        set_ptr(new_bp, insert_root);
-        set_ptr(new_bp + WSIZE, NULL);
+        tree_remove(bp);
         return;
-
-        // printf("insert free block %p success\n", new_bp);
-        // printf("insert in Root: %d\n", root_index);
     }
-    else
+    if (get_size(get_header(bp)) == MIN_BLOCK)
     {
-        size_t new_size = get_size(get_header(new_bp));
-        size_t old_size = get_size(get_header(old_prev));
-
-        // sort free block by size each insertion
-        // if new block is smaller than old block, insert before old block
-        if (new_size <= old_size)
+        // not listed, e.g. fresh from extend_heap
+        if (!(*(uint64_t *)get_header(bp) & MINI_FREE))
         {
-            set_ptr(insert_root, new_bp);      // set root points to new_bp
-            set_ptr(new_bp, insert_root);      // set new_bp prev points to root
-            set_ptr(new_bp + WSIZE, old_prev); // set new_bp next points to old_prev
-            set_ptr(old_prev, new_bp);         // set old_prev points to new_bp
+            return;
         }
-        // if new block is bigger than old block, insert after old block
-        else if (new_size > old_size)
+        char *prev = get_miniprev(bp);
+        char *next = get_ptr(bp);
+        set_ptr(prev == NULL ? get_root(0) : prev, next);
+        if (next != NULL)
         {
-            char *old_next = old_prev + WSIZE;
-            char *old_nextblk = get_ptr(old_next);
-
-            set_ptr(old_next, new_bp); // set old_next prev points to new_bp
-            set_ptr(new_bp, old_prev); // set new_bp prev points to old_next
-            set_ptr(new_bp + WSIZE, NULL);
-
-            if (old_nextblk != NULL)
-            {
-                set_ptr(new_bp + WSIZE, old_nextblk); // set new_bp next points to old_next
-                set_ptr(old_nextblk, new_bp);         // set old_next points to new_bp
-            }
+            set_miniprev(next, prev);
         }
-        // printf("insert free block %p success\n", new_bp);
+        // back to a plain header, so the size bits hold the size again
+        put(get_header(bp), pack(MIN_BLOCK, get_prevbits(get_header(bp))));
+        if (get_ptr(get_root(0)) == NULL)
+        {
+            *class_mask &= ~(uint64_t)1;
+        }
+        return;
     }
-}
 
-static void reset_free(char *bp)
-{
     char *prev = get_ptr(bp);
     char *next = get_ptr(bp + WSIZE);
 
     // identify root
     int root_index = pick_root(get_size(get_header(bp)));
-    char *root = root_array[root_index];
+    char *root = get_root(root_index);
 
     if (prev == 0 && next == 0)
     {
@@ -362,6 +681,11 @@ static void reset_free(char *bp)
             set_ptr(next, root); // set prevptr of next blocl points to root
         }
         set_ptr(root, next); // set root points to next block
+        if (next == NULL)
+        {
+            // the class is empty now
+            *class_mask &= ~((uint64_t)1 << root_index);
+        }
     }
 
     else // if node is in the middle of list
@@ -379,10 +703,10 @@ static void *extend_heap(size_t words)
 {
     char *bp;
     size_t size = align(words); // align size
-    // make sure size is at least 4 words
-    if (size < WSIZE * 4)
+    // make sure size is at least a mini block
+    if (size < MIN_BLOCK)
     {
-        size = WSIZE * 4;
+        size = MIN_BLOCK;
     }
 
     if ((bp = mm_sbrk(size)) == (void *)-1)
@@ -391,74 +715,85 @@ static void *extend_heap(size_t words)
     }
 
     /* Initialize free block header/footer & update the epilogue header */
-    put(get_header(bp), pack(size, 0)); /* Free block header */
-    set_ptr(bp, NULL);                  /* Free block prev ptr */
-    set_ptr(bp + WSIZE, NULL);          /* Free block next ptr */
-
-    put(get_footer(bp), pack(size, 0)); /* Free block footer */
+    /* Free block header, taking the old epilogue's prev bits */
+    put(get_header(bp), pack(size, get_prevbits(get_header(bp))));
+    set_ptr(bp, NULL); /* Free block prev ptr */
+    if (size > MIN_BLOCK)
+    {
+        set_ptr(bp + WSIZE, NULL);          /* Free block next ptr */
+        put(get_footer(bp), pack(size, 0)); /* Free block footer */
+    }
 
-    put(get_header(get_nextblk(bp)), pack(0, 3)); /* New epilogue header */
+    /* New epilogue header */
+    put(get_header(get_nextblk(bp)), pack(0, ALLOC | (size == MIN_BLOCK ? PREV_MINI : 0)));
 
     // printf("extend heap by %zu success\n", words);
 
-    mm_checkheap(__LINE__);
+    // not checked here: the new block may follow a free one until the caller allocates it
     return bp;
 }
 
 static void *find_free_list(size_t require_size)
 {
+    if (require_size >= TREE_MIN)
+    {
+        return tree_best_fit(require_size);
+    }
 
     // pick root based on size
     int root_index = pick_root(require_size);
-    char *root;
-    char *iter;
-    // iterate from root_index to 8
-    // printf("attempt to find freeblk for size %zu from root %d\n", require_size, root_index);
-    for (int i = root_index; i < 9; i++)
-    {
-        root = root_array[i];
-        iter = get_ptr(root);
-        // iterating from root
-        while (iter != NULL)
+
+    // the first non-empty class whose every block fits: its head will do
+    int first = class_fits(root_index, require_size) ? root_index : root_index + 1;
+    uint64_t candidates = first < NUM_CLASSES ? *class_mask & (~(uint64_t)0 << first) : 0;
+    if (candidates != 0)
+    {
+        return get_ptr(get_root(__builtin_ctzll(candidates)));
+    }
+
+    // none: some blocks of the request's own class may still be big enough
+    if (first != root_index)
+    {
+        for (char *iter = get_ptr(get_root(root_index)); iter != NULL; iter = get_ptr(iter + WSIZE))
         {
             if (get_size(get_header(iter)) >= require_size)
             {
                 return iter;
             }
-            iter = get_ptr(iter + WSIZE);
         }
     }
 
-    // printf("no free list found\n");
-    return NULL; // No fit
+    // every block in the tree is bigger than a list class
+    return tree_best_fit(require_size);
 }
 
 // helper function
-// given ptr of free block & required size
-// if free block has at least 4*WSIZE extra space after allocated, split
+// given ptr of free block & required block size
+// if free block has at least MIN_BLOCK extra space after allocated, split
 // if not, allocate the whole block
-static void allocate(char *bp, size_t requested_size)
+static void allocate(char *bp, size_t allocate_size)
 {
     // get total size of free block
     size_t total_size = get_size(get_header(bp));
-    size_t remain_size = total_size - requested_size - DSIZE;
-    size_t allocate_size = requested_size + DSIZE;
+    size_t remain_size = total_size - allocate_size;
+
+    reset_free(bp); // reset prev&next ptr in the block
 
     // if free block is big enough, split
-    if (remain_size >= WSIZE * 4)
+    if (remain_size >= MIN_BLOCK)
     {
-        reset_free(bp); // reset prev&next ptr in the block
-        // update size & alloc bit of header & footer in allocated block
-        put(get_header(bp), pack(allocate_size, 1));
-        put(bp + allocate_size - DSIZE, pack(allocate_size, 1));
+        // update size & alloc bit of header in allocated block; no footer
+        put(get_header(bp), pack(allocate_size, ALLOC | get_prevbits(get_header(bp))));
 
         char *remainblk = bp + allocate_size;
 
         // update size & alloc bit of header & footer in remaining block
-        put(get_header(remainblk), pack(remain_size, 0));
-        put(get_footer(remainblk), pack(remain_size, 0));
-        set_ptr(remainblk, NULL); // reset prev&next ptr in the block
-        set_ptr(remainblk + WSIZE, NULL);
+        put(get_header(remainblk), pack(remain_size, PREV_ALLOC | (allocate_size == MIN_BLOCK ? PREV_MINI : 0)));
+        if (remain_size > MIN_BLOCK)
+        {
+            put(get_footer(remainblk), pack(remain_size, 0));
+        }
+        set_prevmini(get_header(get_nextblk(remainblk)), remain_size == MIN_BLOCK);
 
         // printf("split %p success! \ntotal_size: %zu\nallocate_size: %zu\nremain_size: %zu \nnew free blk: %p\n", (void *)bp, total_size, allocate_size, remain_size, remainblk);
 
@@ -468,10 +803,9 @@ static void allocate(char *bp, size_t requested_size)
     }
     else
     {
-        reset_free(bp); // reset prev&next ptr in the block
-        // if not, allocate the whole block
-        put(get_header(bp), pack(total_size, 1));
-        put(get_footer(bp), pack(total_size, 1));
+        // if not, allocate the whole block, and tell the next block
+        put(get_header(bp), pack(total_size, ALLOC | get_prevbits(get_header(bp))));
+        set_prevalloc(get_header(get_nextblk(bp)));
     }
 }
 
@@ -481,23 +815,27 @@ static void allocate(char *bp, size_t requested_size)
 
 bool mm_init(void)
 {
-    // Create an empty heap
-    if ((heap_listp = mm_sbrk(12 * WSIZE)) == (void *)-1)
+    // Create an empty heap: class heads, bitmap, tree root, padding, prologue and epilogue
+    if ((heap_listp = mm_sbrk((NUM_CLASSES + 6) * WSIZE)) == (void *)-1)
     {
         return false;
     }
     // initialize free list root array
-    for (int i = 0; i < 9; i++)
+    root_array = heap_listp;
+    for (int i = 0; i < NUM_CLASSES; i++)
     {
-        root_array[i] = heap_listp + i * WSIZE;
-        put(root_array[i], 0);
+        put(get_root(i), 0);
     }
+    class_mask = (uint64_t *)(heap_listp + NUM_CLASSES * WSIZE);
+    *class_mask = 0;
+    tree_root = heap_listp + (NUM_CLASSES + 1) * WSIZE;
+    set_ptr(tree_root, NULL);
 
-    // Initialize heap space
-    put(heap_listp + 9 * WSIZE, 0);               // Alignment block
-    put(heap_listp + 10 * WSIZE, pack(DSIZE, 1)); // Prologue header
-    put(heap_listp + 11 * WSIZE, pack(DSIZE, 1)); // Prologue footer
-    put(heap_listp + 12 * WSIZE, pack(0, 3));     // Epilogue header
+    // Initialize heap space; the first block's payload lands 16-byte aligned
+    char *prologue = heap_listp + (NUM_CLASSES + 3) * WSIZE;
+    put(prologue, pack(DSIZE, 1));         // Prologue header
+    put(prologue + WSIZE, pack(DSIZE, 1)); // Prologue footer
+    put(prologue + 2 * WSIZE, pack(0, ALLOC | PREV_ALLOC)); // Epilogue header
 
     // Extend the empty heap by 512 bytes
     char *bp = extend_heap(512);
@@ -525,28 +863,32 @@ void *malloc(size_t size)
     }
 
     char *bp;
-    size_t align_side = align(size); // align size
+    // an allocated block is its header and the payload
+    size_t total_size = align(size + WSIZE);
+    if (total_size < MIN_BLOCK)
+    {
+        total_size = MIN_BLOCK;
+    }
 
     // search free list for a fit
-    bp = find_free_list(align_side + DSIZE);
+    bp = find_free_list(total_size);
     if (bp != NULL)
     {
-        allocate(bp, align_side);
+        allocate(bp, total_size);
         // printf("malloc success! addr: %p, size: %zu\n\n", (void *)bp, size);
         mm_checkheap(__LINE__);
         return bp;
     }
 
     // no fit found, extend heap
-    size_t total_size = align_side + DSIZE;
-    bp = extend_heap(total_size); // add DSIZE for header & footer
+    bp = extend_heap(total_size);
     if (bp == NULL)
     {
         return NULL;
     }
-    // allocate(bp, align_side);
-    put(get_header(bp), pack(total_size, 1));
-    put(get_footer(bp), pack(total_size, 1));
+    // allocate(bp, total_size);
+    put(get_header(bp), pack(total_size, ALLOC | get_prevbits(get_header(bp))));
+    set_prevalloc(get_header(get_nextblk(bp)));
 
     // printf("malloc success! addr: %p, size: %zu\n\n", (void *)bp, size);
 
@@ -578,16 +920,19 @@ void free(void *ptr)
 
     // printf("attempt to free %p, size: %zu\n", ptr, block_size);
 
-    // update size & alloc bit of header & footer
-    put(curr_header, pack(block_size, 0));
-    put(get_footer(ptr), pack(block_size, 0));
+    // update size & alloc bit of header
+    put(curr_header, pack(block_size, get_prevbits(curr_header)));
 
-    // each time free, set next blk's prevalloc bit to 1
-    set_prevalloc(next_blk - 8);
+    // each time free, clear next blk's prevalloc bit
+    clear_prevalloc(get_header(next_blk));
 
-    // clear out prev & next block
+    // clear out prev & next block, and give the block a footer; a mini block has neither
     set_ptr(ptr, NULL);
-    set_ptr(ptr + WSIZE, NULL);
+    if (block_size > MIN_BLOCK)
+    {
+        set_ptr(ptr + WSIZE, NULL);
+        put(get_footer(ptr), pack(block_size, 0));
+    }
 
     // coalesce & insert free block into free list
     char *coalece_block = coalesce(ptr);
@@ -611,8 +956,9 @@ void *realloc(void *oldptr, size_t size)
         return oldptr;
     }
 
-    size_t oldsize = get_size(get_header(oldptr));
-    if (oldsize == size + DSIZE)
+    // payload of the old block: everything but its header
+    size_t oldsize = get_size(get_header(oldptr)) - WSIZE;
+    if (oldsize == size)
     {
         // printf("realloc same size, return oldptr\n");
         return oldptr;
@@ -628,14 +974,7 @@ void *realloc(void *oldptr, size_t size)
 
     // copy data from old block to new block
     // if new block is smaller than old block, copy small size bytes
-    if (size < oldsize - DSIZE)
-    {
-        mm_memcpy(newptr, oldptr, size);
-    }
-    else if (size > oldsize - DSIZE)
-    {
-        mm_memcpy(newptr, oldptr, oldsize);
-    }
+    mm_memcpy(newptr, oldptr, size < oldsize ? size : oldsize);
 
     free(oldptr);
     return newptr;
@@ -689,15 +1028,79 @@ static inline bool is_epilogue(char *bp)
     return (get_size(get_header(bp)) == 0) && (get_alloc(get_header(bp)) == 1);
 }
 
+// check_tree: in-order walk of the tree checking order, heights, balance
+// and that every node is a large free block; prev is the last node visited
+static bool check_tree(char *node, char **prev, int line_number)
+{
+    if (node == NULL)
+    {
+        return true;
+    }
+    if (!check_tree(tree_left(node), prev, line_number))
+    {
+        return false;
+    }
+    if (!in_heap(node) || get_alloc(get_header(node)) || get_size(get_header(node)) < TREE_MIN)
+    {
+        printf("Warning: tree node %p is not a large free block at line %d\n", node, line_number);
+        return false;
+    }
+    if (*prev != NULL && !tree_less(*prev, node))
+    {
+        printf("Warning: tree out of order at %p at line %d\n", node, line_number);
+        return false;
+    }
+    if ((tree_left(node) != NULL && tree_parent(tree_left(node)) != node) ||
+        (tree_right(node) != NULL && tree_parent(tree_right(node)) != node))
+    {
+        printf("Warning: tree parent link broken below %p at line %d\n", node, line_number);
+        return false;
+    }
+    uint64_t left = tree_height(tree_left(node));
+    uint64_t right = tree_height(tree_right(node));
+    if (tree_height(node) != (left > right ? left : right) + 1 || left > right + 1 || right > left + 1)
+    {
+        printf("Warning: tree unbalanced at %p at line %d\n", node, line_number);
+        return false;
+    }
+    *prev = node;
+    return check_tree(tree_right(node), prev, line_number);
+}
+
 bool mm_checkheap(int line_number)
 {
 #ifdef DEBUG
     // Write code to check heap invariants here
     // IMPLEMENT THIS
-    for (int i = 0; i < 9; i++)
+    for (int i = 0; i < NUM_CLASSES; i++)
     {
-        for (char *curr = get_ptr(root_array[i]); in_heap(curr) && !is_epilogue(curr); curr = get_ptr(curr + WSIZE))
+        // check the bitmap against the list
+        bool non_empty = get_ptr(get_root(i)) != NULL;
+        if (non_empty != (bool)((*class_mask >> i) & 1))
+        {
+            printf("Warning: bitmap disagrees with class %d at line %d\n", i, line_number);
+            return false;
+        }
+        // class 0 holds mini blocks, linked through their first word and header
+        char *mini_prev = NULL;
+        for (char *curr = get_ptr(get_root(i)); in_heap(curr) && !is_epilogue(curr); curr = get_ptr(i == 0 ? curr : curr + WSIZE))
         {
+            // mini blocks have no footer
+            if (i == 0)
+            {
+                if (get_alloc(get_header(curr)) || !(*(uint64_t *)get_header(curr) & MINI_FREE))
+                {
+                    printf("Warning: %p in the mini list is not a free mini block at line %d\n", curr, line_number);
+                    return false;
+                }
+                if (get_miniprev(curr) != mini_prev)
+                {
+                    printf("Warning: prev ptr of mini block %p is wrong at line %d\n", curr, line_number);
+                    return false;
+                }
+                mini_prev = curr;
+                continue;
+            }
 
             // check header & footer size consistency
             size_t head_size = get_size(get_header(curr));
@@ -728,6 +1131,39 @@ bool mm_checkheap(int line_number)
             }
         }
     }
+    char *prev = NULL;
+    if (!check_tree(get_ptr(tree_root), &prev, line_number))
+    {
+        return false;
+    }
+    // walk the heap: every prev alloc & prev mini bit must match the block before it
+    bool prev_alloc = true; // the prologue
+    bool prev_mini = false;
+    for (char *curr = heap_listp + (NUM_CLASSES + 6) * WSIZE; ; curr = get_nextblk(curr))
+    {
+        if (get_prevalloc(get_header(curr)) != prev_alloc)
+        {
+            printf("Warning: prev alloc bit of %p is wrong at line %d\n", curr, line_number);
+            return false;
+        }
+        if ((bool)(get_prevbits(get_header(curr)) & PREV_MINI) != prev_mini)
+        {
+            printf("Warning: prev mini bit of %p is wrong at line %d\n", curr, line_number);
+            return false;
+        }
+        if (is_epilogue(curr))
+        {
+            break;
+        }
+        bool alloc = get_alloc(get_header(curr));
+        if (!alloc && !prev_alloc)
+        {
+            printf("Warning: free blocks before %p escaped coalescing at line %d\n", curr, line_number);
+            return false;
+        }
+        prev_alloc = alloc;
+        prev_mini = get_size(get_header(curr)) == MIN_BLOCK;
+    }
 #endif // DEBUG
     return true;
 }